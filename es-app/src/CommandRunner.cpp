@@ -0,0 +1,252 @@
+#include "CommandRunner.h"
+#include "Log.h"
+#include "Metrics.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+// how long a command gets to exit after SIGTERM, before SIGKILL
+#define KILL_GRACE_MS 1000
+
+
+std::string CommandResult::firstLine() const {
+    return output.substr(0, output.find('\n'));
+}
+
+std::vector<std::string> CommandResult::lines() const {
+    std::vector<std::string> res;
+    size_t start = 0;
+    while (start < output.size()) {
+        size_t end = output.find('\n', start);
+        if (end == std::string::npos)
+            end = output.size();
+        res.push_back(output.substr(start, end - start));
+        start = end + 1;
+    }
+    return res;
+}
+
+void CommandFuture::cancel() const {
+    if (mCancelled)
+        *mCancelled = true;
+}
+
+
+CommandRunner *CommandRunner::instance = NULL;
+
+CommandRunner *CommandRunner::getInstance() {
+    if (CommandRunner::instance == NULL) {
+        CommandRunner::instance = new CommandRunner();
+    }
+    return CommandRunner::instance;
+}
+
+CommandRunner::CommandRunner() {
+    for (int i = 0; i < WORKERS; i++)
+        mWorkers.create_thread(boost::bind(&CommandRunner::runWorker, this));
+}
+
+CommandFuture CommandRunner::run(const std::string &command, int timeoutMs) {
+    return enqueue(command, timeoutMs, false);
+}
+
+CommandFuture CommandRunner::change(const std::string &command, int timeoutMs) {
+    return enqueue(command, timeoutMs, true);
+}
+
+CommandFuture CommandRunner::enqueue(const std::string &command, int timeoutMs, bool invalidates) {
+    Job job;
+    job.command = command;
+    job.timeoutMs = timeoutMs;
+    job.invalidates = invalidates;
+    job.cancelled = std::make_shared<std::atomic<bool>>(false);
+    job.promise = std::make_shared<boost::promise<CommandResult>>();
+
+    CommandFuture future;
+    future.mFuture = boost::shared_future<CommandResult>(job.promise->get_future());
+    future.mCancelled = job.cancelled;
+
+    {
+        boost::mutex::scoped_lock lock(mMutex);
+        mJobs.push_back(job);
+    }
+    mCondition.notify_one();
+
+    return future;
+}
+
+CommandFuture CommandRunner::query(const std::string &command, int ttlMs, int timeoutMs) {
+    static Metrics::Counter &reused = Metrics::counter("commands.queries_reused");
+
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    {
+        boost::mutex::scoped_lock lock(mMutex);
+        auto it = mQueries.find(command);
+        if (it != mQueries.end() && now < it->second.expires) {
+            const CommandFuture &cached = it->second.future;
+            // a cancelled or failed run isn't worth remembering
+            if (!cached.isReady() || (!cached.get().cancelled && !cached.get().timedOut)) {
+                reused.add();
+                return cached;
+            }
+        }
+    }
+
+    CommandFuture future = run(command, timeoutMs);
+
+    boost::mutex::scoped_lock lock(mMutex);
+    CachedQuery &cached = mQueries[command];
+    cached.future = future;
+    cached.expires = now + std::chrono::milliseconds(ttlMs);
+    return future;
+}
+
+void CommandRunner::invalidate() {
+    boost::mutex::scoped_lock lock(mMutex);
+    mQueries.clear();
+}
+
+void CommandRunner::runWorker() {
+    while (true) {
+        Job job;
+        {
+            boost::mutex::scoped_lock lock(mMutex);
+            while (mJobs.empty())
+                mCondition.wait(lock);
+
+            job = mJobs.front();
+            mJobs.pop_front();
+        }
+
+        CommandResult result = execute(job.command, job.timeoutMs, job.cancelled.get());
+        // before anyone waiting on it can query again
+        if (job.invalidates)
+            invalidate();
+        job.promise->set_value(result);
+    }
+}
+
+CommandResult CommandRunner::execute(const std::string &command, int timeoutMs, const std::atomic<bool> *cancelled) {
+    static Metrics::Counter &started = Metrics::counter("commands.started");
+    static Metrics::Counter &killed = Metrics::counter("commands.killed");
+
+    CommandResult result;
+    LOG(LogInfo) << "Launching " << command;
+
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0) {
+        LOG(LogError) << "Cannot create a pipe for " << command;
+        return result;
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+
+    // a group of its own, so the scripts it starts are killed along with it
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    sigset_t signals;
+    sigemptyset(&signals);
+    posix_spawnattr_setsigmask(&attr, &signals);
+    sigaddset(&signals, SIGPIPE);
+    posix_spawnattr_setsigdefault(&attr, &signals);
+    posix_spawnattr_setpgroup(&attr, 0);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+
+    char *argv[] = {(char *) "sh", (char *) "-c", (char *) command.c_str(), NULL};
+    pid_t pid;
+    const int error = posix_spawn(&pid, "/bin/sh", &actions, &attr, argv, environ);
+
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    close(fds[1]);
+
+    if (error != 0) {
+        LOG(LogError) << "Cannot launch " << command << ": " << strerror(error);
+        close(fds[0]);
+        return result;
+    }
+    started.add();
+
+    const std::chrono::steady_clock::time_point deadline =
+            std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+
+    // read until it closes its output, checking for cancellation every 100ms
+    char buffer[1024];
+    while (true) {
+        if (cancelled != NULL && *cancelled) {
+            result.cancelled = true;
+            break;
+        }
+        if (timeoutMs > 0 && std::chrono::steady_clock::now() >= deadline) {
+            result.timedOut = true;
+            break;
+        }
+
+        struct pollfd pfd = {fds[0], POLLIN, 0};
+        const int ready = poll(&pfd, 1, 100);
+        if (ready < 0 && errno != EINTR)
+            break;
+        if (ready <= 0)
+            continue;
+
+        const ssize_t count = read(fds[0], buffer, sizeof(buffer));
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0)
+            break;
+        result.output.append(buffer, count);
+    }
+    close(fds[0]);
+
+    // the output is closed, but it may still be running: wait for it against the same deadline
+    int status = 0;
+    bool exited = false;
+    while (!result.cancelled && !result.timedOut) {
+        const pid_t waited = waitpid(pid, &status, WNOHANG);
+        if (waited == pid) {
+            exited = true;
+            break;
+        }
+        if (waited < 0 && errno != EINTR)
+            return result;
+
+        if (cancelled != NULL && *cancelled)
+            result.cancelled = true;
+        else if (timeoutMs > 0 && std::chrono::steady_clock::now() >= deadline)
+            result.timedOut = true;
+        else
+            usleep(20 * 1000);
+    }
+
+    if (!exited) {
+        LOG(LogWarning) << (result.cancelled ? "Cancelled " : "Timed out, killing ") << command;
+        killed.add();
+        kill(-pid, SIGTERM);
+        for (int waited = 0; waitpid(pid, &status, WNOHANG) == 0; waited += 50) {
+            if (waited >= KILL_GRACE_MS) {
+                kill(-pid, SIGKILL);
+                waitpid(pid, &status, 0);
+                break;
+            }
+            usleep(50 * 1000);
+        }
+        return result;
+    }
+
+    if (WIFEXITED(status))
+        result.exitCode = WEXITSTATUS(status);
+    if (result.exitCode != 0)
+        LOG(LogWarning) << "Error executing " << command << " (exit code " << result.exitCode << ")";
+    return result;
+}
@@ -0,0 +1,105 @@
+#ifndef COMMAND_RUNNER
+#define COMMAND_RUNNER
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/thread.hpp>
+
+
+struct CommandResult {
+    CommandResult() : exitCode(-1), timedOut(false), cancelled(false) {}
+
+    int exitCode; // -1 if it couldn't be started or was killed
+    std::string output; // stdout
+    bool timedOut;
+    bool cancelled;
+
+    bool succeeded() const { return exitCode == 0; }
+
+    // without the line break, empty if there was no output
+    std::string firstLine() const;
+    std::vector<std::string> lines() const;
+};
+
+// A command started by CommandRunner. Copies share the same command.
+class CommandFuture {
+public:
+    bool valid() const { return mFuture.valid(); }
+    bool isReady() const { return mFuture.is_ready(); }
+
+    // waits for the command to end
+    const CommandResult &get() const { return mFuture.get(); }
+
+    // kills the command, get() then returns a cancelled result
+    void cancel() const;
+
+private:
+    friend class CommandRunner;
+
+    boost::shared_future<CommandResult> mFuture;
+    std::shared_ptr<std::atomic<bool>> mCancelled;
+};
+
+// Runs shell commands on worker threads of its own, so the UI thread never waits on a script.
+// Commands are spawned with posix_spawn in a process group of their own, their output is read
+// through a pipe and the whole group is killed when they time out or are cancelled.
+// Read-only queries are cached for a while: the menus ask for the same things every time they open.
+class CommandRunner {
+public:
+    static CommandRunner *getInstance();
+
+    static const int DEFAULT_TIMEOUT_MS = 30 * 1000;
+
+    // timeoutMs <= 0 waits for as long as it takes
+    CommandFuture run(const std::string &command, int timeoutMs = DEFAULT_TIMEOUT_MS);
+
+    // the same command asked for again within ttlMs gets the same result, running or finished
+    CommandFuture query(const std::string &command, int ttlMs, int timeoutMs = DEFAULT_TIMEOUT_MS);
+
+    // for a command changing the system: the cached queries are forgotten once it ended
+    CommandFuture change(const std::string &command, int timeoutMs = DEFAULT_TIMEOUT_MS);
+
+    // after something changed the system: the queries run again
+    void invalidate();
+
+    // on the calling thread
+    static CommandResult execute(const std::string &command, int timeoutMs,
+                                 const std::atomic<bool> *cancelled = NULL);
+
+private:
+    static const int WORKERS = 2;
+
+    struct Job {
+        std::string command;
+        int timeoutMs;
+        bool invalidates;
+        std::shared_ptr<std::atomic<bool>> cancelled;
+        std::shared_ptr<boost::promise<CommandResult>> promise;
+    };
+
+    struct CachedQuery {
+        CommandFuture future;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    static CommandRunner *instance;
+
+    CommandRunner();
+
+    CommandFuture enqueue(const std::string &command, int timeoutMs, bool invalidates);
+
+    void runWorker();
+
+    boost::mutex mMutex; // guards the queue and the cache
+    boost::condition_variable mCondition;
+    std::deque<Job> mJobs;
+    std::map<std::string, CachedQuery> mQueries;
+    boost::thread_group mWorkers;
+};
+
+#endif
@@ -1,8 +1,11 @@
 #include <openssl/md5.h>
+#include <algorithm>
 
 #include "FileData.h"
 #include "SystemData.h"
 #include "Log.h"
+#include "Metrics.h"
+#include "Util.h"
 
 extern std::vector<std::string> mameBioses;
 extern std::vector<std::string> mameDevices;
@@ -50,7 +53,8 @@ std::string removeParenthesis(const std::string& str)
 
 
 FileData::FileData(FileType type, const fs::path& path, SystemData* system)
-	: mType(type), mPath(path), mSystem(system), mParent(NULL), metadata(type == GAME ? GAME_METADATA : FOLDER_METADATA) // metadata is REALLY set in the constructor!
+	: mType(type), mPath(path), mSystem(system), mParent(NULL), metadata(type == GAME ? GAME_METADATA : FOLDER_METADATA), // metadata is REALLY set in the constructor!
+	mSortKeysRevision(0), mSortComparator(NULL), mSortAscending(true)
 {
 	// metadata needs at least a name field (since that's what getName() will return)
 	if(metadata.get("name").empty())
@@ -78,25 +82,32 @@ void FileData::updateMd5Hash() {
 	MD5_CTX context;
 	MD5_Init(&context);
 
+	static Metrics::Counter& filesHashed = Metrics::counter("hash.files");
+	static Metrics::Counter& bytesHashed = Metrics::counter("hash.bytes");
+	static Metrics::Counter& hashFailures = Metrics::counter("hash.failures");
+
 	FILE *fp = fopen(mPath.c_str(), "rb");
 	if (fp == NULL) {
-		printf ("%s can't be opened.\n", mPath.c_str());
+		hashFailures.add();
+		LOG(LogDebug) << "Can't hash \"" << mPath.generic_string() << "\", it can't be opened";
 		return;
 	}
 
 	int bytes = 0;
+	unsigned long long total = 0;
 	unsigned char data[1024];
-	while ((bytes = fread(data, 1, 1024, fp)) != 0)
-			MD5_Update(&context, data, bytes);
+	while ((bytes = fread(data, 1, 1024, fp)) != 0) {
+		MD5_Update(&context, data, bytes);
+		total += bytes;
+	}
 
 	fclose(fp);
 
 	unsigned char digest[MD5_DIGEST_LENGTH];
 	MD5_Final(digest, &context);
 
-	for (int i = 0; i < MD5_DIGEST_LENGTH; i++)
-	  printf("%02x", digest[i]);
-	printf (" %s\n", mPath.c_str());
+	filesHashed.add();
+	bytesHashed.add(total);
 
 	static const char hexchars[] = "0123456789abcdef";
 	std::string result;
@@ -112,6 +123,7 @@ void FileData::updateMd5Hash() {
 	}
 
 	metadata.set("hash", result);
+	LOG(LogDebug) << result << " " << mPath.generic_string();
 }
 
 std::string FileData::getCleanName() const
@@ -198,6 +210,7 @@ void FileData::addChild(FileData* file)
 {
 	assert(mType == FOLDER);
 	assert(file->getParent() == NULL);
+	mSortCache.clear();
 
 	mChildren.push_back(file);
 	file->mParent = this;
@@ -206,6 +219,7 @@ void FileData::addChild(FileData* file)
 void FileData::addAlreadyExisitingChild(FileData* file)
 {
 	assert(mType == FOLDER);
+	mSortCache.clear();
 	mChildren.push_back(file);
 }
 
@@ -213,6 +227,7 @@ void FileData::addAlreadyExisitingChild(FileData* file)
 void FileData::removeAlreadyExisitingChild(FileData* file)
 {
 	assert(mType == FOLDER);
+	mSortCache.clear();
 	for(auto it = mChildren.begin(); it != mChildren.end(); it++)
 	{
 		if(*it == file)
@@ -229,12 +244,14 @@ void FileData::removeChild(FileData* file)
 {
 	assert(mType == FOLDER);
 	assert(file->getParent() == this);
+	mSortCache.clear();
 
 	for(auto it = mChildren.begin(); it != mChildren.end(); it++)
 	{
 		if(*it == file)
 		{
 			mChildren.erase(it);
+			file->mParent = NULL; // so deleting it afterwards doesn't unlink it twice
 			return;
 		}
 	}
@@ -255,9 +272,62 @@ void FileData::lazyPopulate(const std::vector<std::string>& searchExtensions, Sy
 	populateFolder(this, searchExtensions, systemData);
 }
 
+const FileData::SortKeys& FileData::getSortKeys() const
+{
+	if(mSortKeysRevision == metadata.getRevision())
+		return mSortKeys;
+
+	mSortKeys.name = strToUpper(metadata.get("name"));
+	if(metadata.getType() == GAME_METADATA)
+	{
+		mSortKeys.developer = strToUpper(metadata.get("developer"));
+		mSortKeys.genre = strToUpper(metadata.get("genre"));
+		mSortKeys.rating = metadata.getFloat("rating");
+		mSortKeys.playCount = metadata.getInt("playcount");
+		mSortKeys.players = metadata.getInt("players");
+
+		boost::posix_time::ptime lastPlayed = metadata.getTime("lastplayed");
+		if(lastPlayed.is_special())
+			mSortKeys.lastPlayed = 0;
+		else
+			mSortKeys.lastPlayed = (lastPlayed - boost::posix_time::ptime(boost::gregorian::date(1970, 1, 1))).total_seconds();
+	}else{
+		mSortKeys.developer.clear();
+		mSortKeys.genre.clear();
+		mSortKeys.rating = 0;
+		mSortKeys.playCount = 0;
+		mSortKeys.players = 0;
+		mSortKeys.lastPlayed = 0;
+	}
+
+	mSortKeysRevision = metadata.getRevision();
+	return mSortKeys;
+}
+
+unsigned long FileData::getChildrenRevisions() const
+{
+	// revisions only grow, so the sum changes whenever any child metadata changes
+	unsigned long sum = 0;
+	for(auto it = mChildren.begin(); it != mChildren.end(); it++)
+		sum += (*it)->metadata.getRevision();
+	return sum;
+}
+
 void FileData::sort(ComparisonFunction& comparator, bool ascending)
 {
-	std::sort(mChildren.begin(), mChildren.end(), comparator);
+	// reuse the ordering from the last sort with this comparator if nothing changed since
+	const unsigned long revisions = getChildrenRevisions();
+	auto cached = mSortCache.find(&comparator);
+	if(cached != mSortCache.end() && cached->second.revisions == revisions)
+	{
+		mChildren = cached->second.children;
+	}else{
+		std::sort(mChildren.begin(), mChildren.end(), comparator);
+
+		SortCacheEntry& entry = mSortCache[&comparator];
+		entry.revisions = revisions;
+		entry.children = mChildren;
+	}
 
 	for(auto it = mChildren.begin(); it != mChildren.end(); it++)
 	{
@@ -267,6 +337,9 @@ void FileData::sort(ComparisonFunction& comparator, bool ascending)
 
 	if(!ascending)
 		std::reverse(mChildren.begin(), mChildren.end());
+
+	mSortComparator = &comparator;
+	mSortAscending = ascending;
 }
 
 void FileData::sort(const SortType& type)
@@ -274,6 +347,25 @@ void FileData::sort(const SortType& type)
 	sort(*type.comparisonFunction, type.ascending);
 }
 
+int FileData::resortChild(FileData* child)
+{
+	auto it = std::find(mChildren.begin(), mChildren.end(), child);
+	if(it == mChildren.end())
+		return -1;
+	if(mSortComparator == NULL)
+		return it - mChildren.begin();
+
+	// the other children are still in order, a binary search finds the new place
+	mChildren.erase(it);
+	ComparisonFunction* comparator = mSortComparator;
+	if(mSortAscending)
+		it = std::upper_bound(mChildren.begin(), mChildren.end(), child, comparator);
+	else
+		it = std::upper_bound(mChildren.begin(), mChildren.end(), child,
+			[comparator](const FileData* a, const FileData* b) { return comparator(b, a); });
+	return mChildren.insert(it, child) - mChildren.begin();
+}
+
 void FileData::populateFolder(FileData* folder, const std::vector<std::string>& searchExtensions, SystemData* systemData)
 {
 	const fs::path& folderPath = folder->getPath();
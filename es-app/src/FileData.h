@@ -1,7 +1,9 @@
 #pragma once
 
 #include <vector>
+#include <map>
 #include <string>
+#include <ctime>
 #include <boost/filesystem.hpp>
 #include "MetaData.h"
 
@@ -75,6 +77,24 @@ public:
 	void sort(ComparisonFunction& comparator, bool ascending = true);
 	void sort(const SortType& type);
 
+	// Moves child to where the last sort() of this folder puts it, once its sort keys changed.
+	// Returns the new index of child, -1 if it is not a child of this folder.
+	int resortChild(FileData* child);
+
+	// Values the comparators in FileSorts work on, computed once from the metadata
+	// and rebuilt when the metadata revision changes.
+	struct SortKeys
+	{
+		std::string name; // upper case
+		std::string developer; // upper case
+		std::string genre; // upper case
+		float rating;
+		int playCount;
+		int players;
+		time_t lastPlayed;
+	};
+	const SortKeys& getSortKeys() const;
+
 	static void populateFolder(FileData* folder, const std::vector<std::string>& searchExtensions = std::vector<std::string>(), SystemData* systemData = nullptr);
 	static void populateRecursiveFolder(FileData* folder, const std::vector<std::string>& searchExtensions = std::vector<std::string>(), SystemData* systemData = nullptr);
 
@@ -89,4 +109,19 @@ private:
 	FileData* mParent;
 	std::vector<FileData*> mChildren;
 
+	mutable SortKeys mSortKeys;
+	mutable unsigned int mSortKeysRevision;
+
+	// ascending orderings of mChildren already computed, per comparator
+	struct SortCacheEntry
+	{
+		unsigned long revisions; // sum of the children metadata revisions when sorted
+		std::vector<FileData*> children;
+	};
+	std::map<ComparisonFunction*, SortCacheEntry> mSortCache;
+
+	// last sort applied to mChildren, NULL until sorted
+	ComparisonFunction* mSortComparator;
+	bool mSortAscending;
+	unsigned long getChildrenRevisions() const;
 };
@@ -23,22 +23,10 @@ namespace FileSorts
   }
 
 	//returns if file1 should come before file2
+	//all comparators work on the precomputed FileData::SortKeys
 	bool compareFileName(const FileData* file1, const FileData* file2)
 	{
-		std::string name1 = file1->getName();
-		std::string name2 = file2->getName();
-
-		//min of name1/name2 .length()s
-		unsigned int count = name1.length() > name2.length() ? name2.length() : name1.length();
-		for(unsigned int i = 0; i < count; i++)
-		{
-			if(toupper(name1[i]) != toupper(name2[i]))
-			{
-				return toupper(name1[i]) < toupper(name2[i]);
-			}
-		}
-
-		return name1.length() < name2.length();
+		return file1->getSortKeys().name < file2->getSortKeys().name;
 	}
 
 	bool compareRating(const FileData* file1, const FileData* file2)
@@ -46,7 +34,7 @@ namespace FileSorts
 		//only games have rating metadata
 		if(file1->metadata.getType() == GAME_METADATA && file2->metadata.getType() == GAME_METADATA)
 		{
-			return file1->metadata.getFloat("rating") < file2->metadata.getFloat("rating");
+			return file1->getSortKeys().rating < file2->getSortKeys().rating;
 		}
 
 		return false;
@@ -57,7 +45,7 @@ namespace FileSorts
 		//only games have playcount metadata
 		if(file1->metadata.getType() == GAME_METADATA && file2->metadata.getType() == GAME_METADATA)
 		{
-			return (file1)->metadata.getInt("playcount") < (file2)->metadata.getInt("playcount");
+			return file1->getSortKeys().playCount < file2->getSortKeys().playCount;
 		}
 
 		return false;
@@ -68,7 +56,7 @@ namespace FileSorts
 		//only games have lastplayed metadata
 		if(file1->metadata.getType() == GAME_METADATA && file2->metadata.getType() == GAME_METADATA)
 		{
-			return (file1)->metadata.getTime("lastplayed") < (file2)->metadata.getTime("lastplayed");
+			return file1->getSortKeys().lastPlayed < file2->getSortKeys().lastPlayed;
 		}
 
 		return false;
@@ -76,10 +64,10 @@ namespace FileSorts
 
 	bool compareNumberPlayers(const FileData* file1, const FileData* file2)
 	{
-		//only games have lastplayed metadata
+		//only games have players metadata
 		if(file1->metadata.getType() == GAME_METADATA && file2->metadata.getType() == GAME_METADATA)
 		{
-			return (file1)->metadata.getInt("players") < (file2)->metadata.getInt("players");
+			return file1->getSortKeys().players < file2->getSortKeys().players;
 		}
 
 		return false;
@@ -90,18 +78,7 @@ namespace FileSorts
 		//only games have developper metadata
 		if(file1->metadata.getType() == GAME_METADATA && file2->metadata.getType() == GAME_METADATA)
 		{
-			std::string dev1 = file1->metadata.get("developer");
-			std::string dev2 = file2->metadata.get("developer");
-
-		//min of dev1/dev2 .length()s
-		unsigned int count = dev1.length() > dev2.length() ? dev2.length() : dev1.length();
-		for(unsigned int i = 0; i < count; i++)
-		{
-			if(toupper(dev1[i]) != toupper(dev2[i]))
-			{
-				return toupper(dev1[i]) < toupper(dev2[i]);
-			}
-		}
+			return file1->getSortKeys().developer < file2->getSortKeys().developer;
 		}
 
 		return false;
@@ -112,18 +89,7 @@ namespace FileSorts
 		//only games have genre metadata
 		if(file1->metadata.getType() == GAME_METADATA && file2->metadata.getType() == GAME_METADATA)
 		{
-			std::string genre1 = file1->metadata.get("genre");
-			std::string genre2 = file2->metadata.get("genre");
-
-		//min of genre1/genre2 .length()s
-		unsigned int count = genre1.length() > genre2.length() ? genre2.length() : genre1.length();
-		for(unsigned int i = 0; i < count; i++)
-		{
-			if(toupper(genre1[i]) != toupper(genre2[i]))
-			{
-				return toupper(genre1[i]) < toupper(genre2[i]);
-			}
-		}
+			return file1->getSortKeys().genre < file2->getSortKeys().genre;
 		}
 
 		return false;
@@ -3,47 +3,109 @@
 #include "LobbyData.h"
 #include "Lobby.h"
 #include "views/ViewController.h"
+#include <set>
 
 
 LobbyData::LobbyData(std::vector<SystemData*>* systems) : SystemData("lobby", std::string("Lobby"), std::string("lobby")) {
   msystems = systems;
 
-  LobbyThread::getInstance()->subscribeStartedPlaying([this](Session *session) { this->addPlayer(session); });
-  LobbyThread::getInstance()->subscribeStoppedPlaying([this](Session *session) { this->removePlayer(session); });
+  LobbyThread::getInstance()->subscribeStartedPlaying([this](const std::shared_ptr<const Session>& session) { this->addPlayer(session); });
+  LobbyThread::getInstance()->subscribeStoppedPlaying([this](const std::shared_ptr<const Session>& session) { this->removePlayer(session); });
+  SystemData::subscribeLoaded([this](SystemData* system) { this->onSystemLoaded(system); });
 }
 
 void LobbyData::refreshRootFolder() {
 }
 
-void LobbyData::addPlayer(Session *session) {
+void LobbyData::addPlayer(const std::shared_ptr<const Session>& session) {
+  unsigned int added = 0;
+
   for(auto system = msystems->begin(); system != msystems->end(); system ++) {
-    std::vector<FileData*> games = (*system)->getRootFolder()->getFilesRecursive(GAME);
-    for(auto game = games.begin(); game != games.end(); game++) {
-      if ((*game)->metadata.get("hash").compare(session->gameHash) == 0) {
-        // FIXME: A clone won't get metadata updates from its parent!
-        auto clone = (*game)->clone();
-        clone->metadata.set("peer", session->peer);
-        mRootFolder->addChild(clone);
-      }
+    if ((*system)->getGameCount() == 0)
+      continue;
+
+    // never block the UI on a system that isn't loaded, its games are matched once the loader is done with it
+    if (!(*system)->isLoaded()) {
+      PendingPlayer& pending = mPendingPlayers[session->hostId];
+      pending.session = session;
+      pending.systems.insert(*system);
+      (*system)->loadAsync(false);
+      continue;
     }
+
+    added += addGames(session, *system);
   }
-  mRootFolder->sort(FileSorts::SortTypes.at(0));
 
-  ViewController::get()->reloadGameListView(this);
+  if (added > 0) {
+    mRootFolder->sort(FileSorts::SortTypes.at(0));
+    ViewController::get()->reloadGameListView(this);
+  }
 }
 
-void LobbyData::removePlayer(Session *session) {
-  std::cerr << "/* removePlayer */" << '\n';
-  std::vector<FileData*> games = mRootFolder->getFilesRecursive(GAME);
+void LobbyData::onSystemLoaded(SystemData* system) {
+  unsigned int added = 0;
+
+  for(auto player = mPendingPlayers.begin(); player != mPendingPlayers.end(); ) {
+    if (player->second.systems.erase(system) > 0)
+      added += addGames(player->second.session, system);
+
+    if (player->second.systems.empty())
+      player = mPendingPlayers.erase(player);
+    else
+      player++;
+  }
+
+  if (added > 0) {
+    mRootFolder->sort(FileSorts::SortTypes.at(0));
+    ViewController::get()->reloadGameListView(this);
+  }
+}
+
+unsigned int LobbyData::addGames(const std::shared_ptr<const Session>& session, SystemData* system) {
+  const std::set<std::string> hashes(session->gameHashes.begin(), session->gameHashes.end());
+  std::vector<FileData*>& clones = mPlayerGames[session->hostId];
+  unsigned int added = 0;
+
+  std::vector<FileData*> games = system->getRootFolder()->getFilesRecursive(GAME);
   for(auto game = games.begin(); game != games.end(); game++) {
-    std::cerr << (*game)->metadata.get("peer") << std::endl;
-    if ((*game)->metadata.get("peer").compare(session->peer) == 0) {
-      mRootFolder->removeAlreadyExisitingChild((*game));
+    if (hashes.find((*game)->metadata.get("hash")) != hashes.end()) {
+      // FIXME: A clone won't get metadata updates from its parent!
+      auto clone = (*game)->clone();
+      clone->metadata.set("peer", session->peer);
+      mRootFolder->addChild(clone);
+      clones.push_back(clone);
+      added++;
     }
   }
+  return added;
+}
+
+void LobbyData::removePlayer(const std::shared_ptr<const Session>& session) {
+  LOG_SUB(LogLobby, LogDebug) << "Removing the games of " << session->peer;
+
+  // by host rather than address, several instances can run behind one address
+  mPendingPlayers.erase(session->hostId);
+
+  auto player = mPlayerGames.find(session->hostId);
+  if (player == mPlayerGames.end())
+    return;
+
+  // the clones were added with addChild, they belong to the lobby
+  std::vector<FileData*> clones;
+  clones.swap(player->second);
+  mPlayerGames.erase(player);
+
+  for(auto game = clones.begin(); game != clones.end(); game++) {
+    mRootFolder->removeChild((*game));
+  }
   mRootFolder->sort(FileSorts::SortTypes.at(0));
 
+  // the old view still points at the clones until it is replaced
   ViewController::get()->reloadGameListView(this);
+
+  for(auto game = clones.begin(); game != clones.end(); game++) {
+    delete (*game);
+  }
 }
 
 bool LobbyData::hasAnyThumbnails() const {
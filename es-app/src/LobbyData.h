@@ -2,6 +2,7 @@
 
 #include "SystemData.h"
 #include "Lobby.h"
+#include <set>
 
 
 class LobbyData : public SystemData
@@ -14,10 +15,21 @@ public:
   bool allowFavoriting() const override;
 
 private:
-  void addPlayer(Session *session);
-  void removePlayer(Session *session);
+  // called on the UI thread, from LobbyThread::processEvents
+  void addPlayer(const std::shared_ptr<const Session>& session);
+  void removePlayer(const std::shared_ptr<const Session>& session);
+  void onSystemLoaded(SystemData* system);
+  // clones the games of system the session plays, returns how many were added
+  unsigned int addGames(const std::shared_ptr<const Session>& session, SystemData* system);
 
   std::vector<SystemData*>* msystems;
+  std::map<uint64_t, std::vector<FileData*> > mPlayerGames; // clones added for each host
+
+  struct PendingPlayer {
+    std::shared_ptr<const Session> session;
+    std::set<SystemData*> systems; // queued for loading, matched once loaded
+  };
+  std::map<uint64_t, PendingPlayer> mPendingPlayers;
 
   void refreshRootFolder();
   void onLobbyChange();
@@ -60,7 +60,7 @@ const std::vector<MetaDataDecl>& getMDDByType(MetaDataListType type)
 
 
 MetaDataList::MetaDataList(MetaDataListType type)
-	: mType(type), mWasChanged(false)
+	: mType(type), mWasChanged(false), mRevision(1)
 {
 	const std::vector<MetaDataDecl>& mdd = getMDD();
 	for(auto iter = mdd.begin(); iter != mdd.end(); iter++)
@@ -121,6 +121,7 @@ void MetaDataList::set(const std::string& key, const std::string& value)
 {
 	mMap[key] = value;
 	mWasChanged = true;
+	mRevision++;
 }
 
 void MetaDataList::setTime(const std::string& key, const boost::posix_time::ptime& time)
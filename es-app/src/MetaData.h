@@ -81,6 +81,9 @@ public:
 	bool wasChanged() const;
 	void resetChangedFlag();
 
+	// incremented on every set(), lets caches derived from the metadata detect changes
+	inline unsigned int getRevision() const { return mRevision; }
+
 	inline MetaDataListType getType() const { return mType; }
 	inline const std::vector<MetaDataDecl>& getMDD() const { return getMDDByType(getType()); }
 
@@ -88,4 +91,5 @@ private:
 	MetaDataListType mType;
 	std::map<std::string, std::string> mMap;
 	bool mWasChanged;
+	unsigned int mRevision;
 };
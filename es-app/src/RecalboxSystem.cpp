@@ -10,6 +10,7 @@
 #include "Settings.h"
 #include "Log.h"
 #include "HttpReq.h"
+#include "CommandRunner.h"
 
 #include "AudioManager.h"
 #include "VolumeControl.h"
@@ -20,6 +21,10 @@
 #include <boost/algorithm/string/replace.hpp>
 #include <fstream>
 
+// how long read-only answers are reused, anything changing the system forgets them
+#define QUERY_TTL_MS (60 * 1000)
+#define BLUETOOTH_TIMEOUT_MS (60 * 1000)
+
 
 RecalboxSystem::RecalboxSystem() {
 }
@@ -34,6 +39,23 @@ RecalboxSystem *RecalboxSystem::getInstance() {
     return RecalboxSystem::instance;
 }
 
+std::string RecalboxSystem::getSettingCommand(const std::string &arguments) {
+    return Settings::getInstance()->getString("RecalboxSettingScript") + " " + arguments;
+}
+
+// changes the system, so what was asked before may not be true anymore once it ended
+CommandFuture RecalboxSystem::runSettingCommand(const std::string &arguments, int timeoutMs) {
+    return CommandRunner::getInstance()->change(getSettingCommand(arguments), timeoutMs);
+}
+
+std::vector<CommandFuture> RecalboxSystem::prefetchSystemSettings() {
+    std::vector<CommandFuture> queries;
+    queries.push_back(CommandRunner::getInstance()->query(getSettingCommand("storage list"), QUERY_TTL_MS));
+    queries.push_back(CommandRunner::getInstance()->query(getSettingCommand("storage current"), QUERY_TTL_MS));
+    queries.push_back(CommandRunner::getInstance()->query(getSettingCommand("getRootPassword"), QUERY_TTL_MS));
+    return queries;
+}
+
 unsigned long RecalboxSystem::getFreeSpaceGB(std::string mountpoint) {
     struct statvfs fiData;
     const char *fnPath = mountpoint.c_str();
@@ -93,9 +115,8 @@ std::string RecalboxSystem::getVersion() {
     return "";
 }
 
-bool RecalboxSystem::setAudioOutputDevice(std::string device) {
+CommandFuture RecalboxSystem::setAudioOutputDevice(std::string device) {
     int commandValue = -1;
-    int returnValue = false;
 
     if (device == "auto") {
         commandValue = 0;
@@ -105,131 +126,52 @@ bool RecalboxSystem::setAudioOutputDevice(std::string device) {
         commandValue = 2;
     } else {
         LOG(LogWarning) << "Unable to find audio output device to use !";
+        return CommandFuture();
     }
 
-    if (commandValue != -1) {
-        std::ostringstream oss;
-        oss << "amixer cset numid=3 " << commandValue;
-        std::string command = oss.str();
-        LOG(LogInfo) << "Launching " << command;
-        if (system(command.c_str())) {
-            LOG(LogWarning) << "Error executing " << command;
-            returnValue = false;
-        } else {
-            LOG(LogInfo) << "Audio output device set to : " << device;
-            returnValue = true;
-        }
-    }
-    return returnValue;
+    LOG(LogInfo) << "Setting audio output device to : " << device;
+    std::ostringstream oss;
+    oss << "amixer cset numid=3 " << commandValue;
+    return CommandRunner::getInstance()->run(oss.str());
 }
 
 
-bool RecalboxSystem::setOverscan(bool enable) {
-
-    std::ostringstream oss;
-    oss << Settings::getInstance()->getString("RecalboxSettingScript") << " " << "overscan";
-    if (enable) {
-        oss << " " << "enable";
-    } else {
-        oss << " " << "disable";
-    }
-    std::string command = oss.str();
-    LOG(LogInfo) << "Launching " << command;
-    if (system(command.c_str())) {
-        LOG(LogWarning) << "Error executing " << command;
-        return false;
-    } else {
-        LOG(LogInfo) << "Overscan set to : " << enable;
-        return true;
-    }
-
+CommandFuture RecalboxSystem::setOverscan(bool enable) {
+    LOG(LogInfo) << "Setting overscan to : " << enable;
+    return runSettingCommand(enable ? "overscan enable" : "overscan disable", CommandRunner::DEFAULT_TIMEOUT_MS);
 }
 
-bool RecalboxSystem::setOverclock(std::string mode) {
-    if (mode != "") {
-        std::ostringstream oss;
-        oss << Settings::getInstance()->getString("RecalboxSettingScript") << " "
-            << "overclock" << " " << mode;
-        std::string command = oss.str();
-        LOG(LogInfo) << "Launching " << command;
-        if (system(command.c_str())) {
-            LOG(LogWarning) << "Error executing " << command;
-            return false;
-        } else {
-            LOG(LogInfo) << "Overclocking set to " << mode;
-            return true;
-        }
-    }
+CommandFuture RecalboxSystem::setOverclock(std::string mode) {
+    if (mode == "")
+        return CommandFuture();
 
-    return false;
+    LOG(LogInfo) << "Setting overclocking to " << mode;
+    return runSettingCommand("overclock " + mode, CommandRunner::DEFAULT_TIMEOUT_MS);
 }
 
 
-std::pair<std::string, int> RecalboxSystem::updateSystem() {
+CommandFuture RecalboxSystem::updateSystem() {
     std::string updatecommand = Settings::getInstance()->getString("UpdateCommand");
-    FILE *pipe = popen(updatecommand.c_str(), "r");
-    char line[1024];
-    if (pipe == NULL) {
-        return std::pair<std::string, int>(std::string("Cannot call update command"), -1);
-    }
-    if (fgets(line, 1024, pipe)) {
-        strtok(line, "\n");
-    }
-    int exitCode = pclose(pipe) / 256;
-    if (strlen(line) == 0) {
-        return std::pair<std::string, int>(std::string("Cannot call update command"), exitCode);
-    } else {
-        return std::pair<std::string, int>(std::string(line), exitCode);
-    }
+    // downloads can take a while, no timeout
+    return CommandRunner::getInstance()->change(updatecommand, 0);
 }
 
-bool RecalboxSystem::canUpdate() {
-    std::ostringstream oss;
-    oss << Settings::getInstance()->getString("RecalboxSettingScript") << " " << "canupdate";
-    std::string command = oss.str();
-    LOG(LogInfo) << "Launching " << command;
-    if (system(command.c_str()) == 0) {
-        LOG(LogInfo) << "Can update ";
-        return true;
-    } else {
-        LOG(LogInfo) << "Cannot update ";
-        return false;
-    }
+CommandFuture RecalboxSystem::canUpdate() {
+    return CommandRunner::getInstance()->query(getSettingCommand("canupdate"), QUERY_TTL_MS);
 }
 
-bool RecalboxSystem::enableWifi(std::string ssid, std::string key) {
+CommandFuture RecalboxSystem::enableWifi(std::string ssid, std::string key) {
     std::ostringstream oss;
     boost::replace_all(ssid, "\"", "\\\"");
     boost::replace_all(key, "\"", "\\\"");
-    oss << Settings::getInstance()->getString("RecalboxSettingScript") << " "
-        << "wifi" << " "
+    oss << "wifi" << " "
         << "enable" << " \""
         << ssid << "\" \"" << key << "\"";
-    std::string command = oss.str();
-    LOG(LogInfo) << "Launching " << command;
-    if (system(command.c_str()) == 0) {
-        LOG(LogInfo) << "Wifi enabled ";
-        return true;
-    } else {
-        LOG(LogInfo) << "Cannot enable wifi ";
-        return false;
-    }
+    return runSettingCommand(oss.str(), CommandRunner::DEFAULT_TIMEOUT_MS);
 }
 
-bool RecalboxSystem::disableWifi() {
-    std::ostringstream oss;
-    oss << Settings::getInstance()->getString("RecalboxSettingScript") << " "
-        << "wifi" << " "
-        << "disable";
-    std::string command = oss.str();
-    LOG(LogInfo) << "Launching " << command;
-    if (system(command.c_str()) == 0) {
-        LOG(LogInfo) << "Wifi disabled ";
-        return true;
-    } else {
-        LOG(LogInfo) << "Cannot disable wifi ";
-        return false;
-    }
+CommandFuture RecalboxSystem::disableWifi() {
+    return runSettingCommand("wifi disable", CommandRunner::DEFAULT_TIMEOUT_MS);
 }
 
 
@@ -302,101 +244,44 @@ std::string RecalboxSystem::getIpAdress() {
 }
 
 std::vector<std::string> *RecalboxSystem::scanBluetooth() {
-    std::vector<std::string> *res = new std::vector<std::string>();
-    std::ostringstream oss;
-    oss << Settings::getInstance()->getString("RecalboxSettingScript") << " " << "hcitoolscan";
-    FILE *pipe = popen(oss.str().c_str(), "r");
-    char line[1024];
-
-    if (pipe == NULL) {
+    CommandResult result = CommandRunner::execute(getSettingCommand("hcitoolscan"), BLUETOOTH_TIMEOUT_MS);
+    if (result.exitCode == -1) {
         return NULL;
     }
 
-    while (fgets(line, 1024, pipe)) {
-        strtok(line, "\n");
-        res->push_back(std::string(line));
-    }
-    pclose(pipe);
-
-    return res;
+    return new std::vector<std::string>(result.lines());
 }
 
 bool RecalboxSystem::pairBluetooth(std::string &controller) {
-    std::ostringstream oss;
-    oss << Settings::getInstance()->getString("RecalboxSettingScript") << " " << "hiddpair" << " " << controller;
-    int exitcode = system(oss.str().c_str());
-    return exitcode == 0;
+    return runSettingCommand("hiddpair " + controller, BLUETOOTH_TIMEOUT_MS).get().succeeded();
 }
 
 std::vector<std::string> RecalboxSystem::getAvailableStorageDevices() {
-
-    std::vector<std::string> res;
-    std::ostringstream oss;
-    oss << Settings::getInstance()->getString("RecalboxSettingScript") << " " << "storage list";
-    FILE *pipe = popen(oss.str().c_str(), "r");
-    char line[1024];
-
-    if (pipe == NULL) {
-        return res;
-    }
-
-    while (fgets(line, 1024, pipe)) {
-        strtok(line, "\n");
-        res.push_back(std::string(line));
-    }
-    pclose(pipe);
-
-    return res;
+    CommandFuture query = CommandRunner::getInstance()->query(getSettingCommand("storage list"), QUERY_TTL_MS);
+    return query.get().lines();
 }
 
 std::string RecalboxSystem::getCurrentStorage() {
-
-    std::ostringstream oss;
-    oss << Settings::getInstance()->getString("RecalboxSettingScript") << " " << "storage current";
-    FILE *pipe = popen(oss.str().c_str(), "r");
-    char line[1024];
-
-    if (pipe == NULL) {
+    CommandFuture query = CommandRunner::getInstance()->query(getSettingCommand("storage current"), QUERY_TTL_MS);
+    const CommandResult &result = query.get();
+    if (result.exitCode == -1) {
         return "";
     }
-
-    if (fgets(line, 1024, pipe)) {
-        strtok(line, "\n");
-        pclose(pipe);
-        return std::string(line);
+    if (result.output.empty()) {
+        return "INTERNAL";
     }
-    return "INTERNAL";
+    return result.firstLine();
 }
 
-bool RecalboxSystem::setStorage(std::string selected) {
-    std::ostringstream oss;
-    oss << Settings::getInstance()->getString("RecalboxSettingScript") << " " << "storage" << " " << selected;
-    int exitcode = system(oss.str().c_str());
-    return exitcode == 0;
+CommandFuture RecalboxSystem::setStorage(std::string selected) {
+    return runSettingCommand("storage " + selected, CommandRunner::DEFAULT_TIMEOUT_MS);
 }
 
-bool RecalboxSystem::forgetBluetoothControllers() {
-    std::ostringstream oss;
-    oss << Settings::getInstance()->getString("RecalboxSettingScript") << " " << "forgetBT";
-    int exitcode = system(oss.str().c_str());
-    return exitcode == 0;
+CommandFuture RecalboxSystem::forgetBluetoothControllers() {
+    return runSettingCommand("forgetBT", CommandRunner::DEFAULT_TIMEOUT_MS);
 }
 
 std::string RecalboxSystem::getRootPassword() {
-
-    std::ostringstream oss;
-    oss << Settings::getInstance()->getString("RecalboxSettingScript") << " " << "getRootPassword";
-    FILE *pipe = popen(oss.str().c_str(), "r");
-    char line[1024];
-
-    if (pipe == NULL) {
-        return "";
-    }
-
-    if (fgets(line, 1024, pipe)) {
-        strtok(line, "\n");
-        pclose(pipe);
-        return std::string(line);
-    }
-    return oss.str().c_str();
+    CommandFuture query = CommandRunner::getInstance()->query(getSettingCommand("getRootPassword"), QUERY_TTL_MS);
+    return query.get().firstLine();
 }
@@ -3,8 +3,12 @@
 
 #include <string>
 #include "Window.h"
+#include "CommandRunner.h"
 
 
+// Commands go through CommandRunner: they time out instead of hanging the UI forever, and the
+// read-only ones are cached for a minute, until a command changes something.
+// The ones changing the system return as soon as they are started, show a GuiLoading until they end.
 class RecalboxSystem {
 public:
 
@@ -21,19 +25,23 @@ public:
     std::string getVersion();
     std::string getRootPassword();
 
-    bool setAudioOutputDevice(std::string device);
+    // not valid() for an unknown device
+    CommandFuture setAudioOutputDevice(std::string device);
 
-    bool setOverscan(bool enable);
+    CommandFuture setOverscan(bool enable);
 
-    bool setOverclock(std::string mode);
+    // not valid() without a mode
+    CommandFuture setOverclock(std::string mode);
 
-    std::pair<std::string, int> updateSystem();
+    // the first line of the output says what happened
+    CommandFuture updateSystem();
 
-    bool canUpdate();
+    // succeeded() if an update is available
+    CommandFuture canUpdate();
 
-    bool enableWifi(std::string ssid, std::string key);
+    CommandFuture enableWifi(std::string ssid, std::string key);
 
-    bool disableWifi();
+    CommandFuture disableWifi();
 
     bool reboot();
 
@@ -47,15 +55,19 @@ public:
 
     std::vector<std::string> *scanBluetooth();
 
+    // waits for the pairing, from a GuiLoading thread
     bool pairBluetooth(std::string &basic_string);
 
     std::vector<std::string> getAvailableStorageDevices();
 
     std::string getCurrentStorage();
 
-    bool setStorage(std::string basic_string);
+    CommandFuture setStorage(std::string basic_string);
 
-    bool forgetBluetoothControllers();
+    CommandFuture forgetBluetoothControllers();
+
+    // starts what the system settings menu asks for, so opening it only waits for what isn't ready
+    std::vector<CommandFuture> prefetchSystemSettings();
 
 private:
     static RecalboxSystem *instance;
@@ -64,6 +76,10 @@ private:
 
     bool halt(bool reboot, bool fast);
 
+    std::string getSettingCommand(const std::string &arguments);
+
+    CommandFuture runSettingCommand(const std::string &arguments, int timeoutMs);
+
 };
 
 #endif
@@ -5,10 +5,12 @@
 #include <utility>
 #include <stdlib.h>
 #include <SDL_joystick.h>
+#include <SDL_timer.h>
 #include <lua.hpp>
 
 #include "Renderer.h"
 #include "AudioManager.h"
+#include "Sound.h"
 #include "VolumeControl.h"
 #include "Log.h"
 #include "InputManager.h"
@@ -25,6 +27,17 @@
 
 
 std::vector<SystemData*> SystemData::sSystemVector;
+std::map<std::string, SystemData::GameCounts> SystemData::sCountCache;
+boost::mutex SystemData::sCountCacheMutex;
+boost::thread SystemData::sLoaderThread;
+boost::mutex SystemData::sLoaderMutex;
+boost::condition_variable SystemData::sLoaderCondition;
+boost::condition_variable SystemData::sLoadedCondition;
+std::deque<SystemData*> SystemData::sLoadQueue;
+SystemData* SystemData::sLoadingSystem = NULL;
+bool SystemData::sLoaderRunning = false;
+std::vector<SystemData*> SystemData::sLoadedSystems;
+std::vector<SystemLoadedFunction> SystemData::sLoadedCallbacks;
 
 namespace fs = boost::filesystem;
 
@@ -38,6 +51,10 @@ SystemData::SystemData(std::string name, std::string fullName, std::string theme
 	mRootFolder = new FileData(FOLDER, mStartPath, this);
 	mRootFolder->metadata.set("name", mFullName);
 
+	mLoaded = true;
+	mLoading = false;
+	mLastVisit = 0;
+
 	mIsFavorite = false;
 	mPlatformIds.push_back(PlatformIds::PLATFORM_IGNORE);
 
@@ -72,13 +89,27 @@ SystemData::SystemData(std::string name, std::string fullName, std::string start
 	mRootFolder = new FileData(FOLDER, mStartPath, this);
 	mRootFolder->metadata.set("name", mFullName);
 
-	if(!Settings::getInstance()->getBool("ParseGamelistOnly"))
-		populateFolder(mRootFolder);
+	mLoaded = false;
+	mLoading = false;
+	mLastVisit = 0;
 
-	if(!Settings::getInstance()->getBool("IgnoreGamelist"))
-		parseGamelist(this);
+	// in lazy mode, only systems without a cached count (never seen before), with favorites (the
+	// favorites system is built from them at boot) or that had no games (they'd be dropped without
+	// ever being scanned again, missing roms added since) are populated right away
+	bool cached = false;
+	{
+		boost::mutex::scoped_lock lock(sCountCacheMutex);
+		auto it = sCountCache.find(mName);
+		if(it != sCountCache.end())
+		{
+			mCachedCounts = it->second;
+			cached = true;
+		}
+	}
+
+	if(!Settings::getInstance()->getBool("LazyLoading") || !cached || mCachedCounts.games == 0 || mCachedCounts.favorites > 0)
+		populate();
 
-	mRootFolder->sort(FileSorts::SortTypes.at(0));
 	mIsFavorite = false;
 	loadTheme();
 }
@@ -96,7 +127,14 @@ SystemData::SystemData(std::string name, std::string fullName, std::string launc
 	mRootFolder = new FileData(FOLDER, mStartPath, this);
 	mRootFolder->metadata.set("name", mFullName);
 
+	mLoaded = true;
+	mLoading = false;
+	mLastVisit = 0;
+
 	for(auto system = systems->begin(); system != systems->end(); system ++){
+		// already loaded at boot, unless the count cache is out of date
+		if((*system)->getFavoritesCount() > 0)
+			(*system)->ensureLoaded();
 		std::vector<FileData*> favorites = (*system)->getFavorites();
 		for(auto favorite = favorites.begin(); favorite != favorites.end(); favorite++){
 			mRootFolder->addAlreadyExisitingChild((*favorite));
@@ -113,10 +151,283 @@ SystemData::SystemData(std::string name, std::string fullName, std::string launc
 
 SystemData::~SystemData()
 {
-	updateGamelist(this);
+	cancelLoad();
+
+	if(isLoaded())
+		updateGamelist(this);
 	delete mRootFolder;
 }
 
+void SystemData::populate()
+{
+	if(!Settings::getInstance()->getBool("ParseGamelistOnly"))
+		populateFolder(mRootFolder);
+
+	if(!Settings::getInstance()->getBool("IgnoreGamelist"))
+		parseGamelist(this);
+
+	mRootFolder->sort(FileSorts::SortTypes.at(0));
+
+	storeCounts();
+	mLoaded.store(true, std::memory_order_release);
+}
+
+void SystemData::touch()
+{
+	mLastVisit = SDL_GetTicks();
+}
+
+void SystemData::loadAsync(bool first)
+{
+	touch();
+
+	if(isLoaded())
+		return;
+
+	boost::mutex::scoped_lock lock(sLoaderMutex);
+	if(sLoadingSystem == this)
+		return;
+
+	if(mLoading)
+	{
+		// still waiting, it only ever moves forward
+		if(!first)
+			return;
+
+		// scrolled back to it, it goes first again
+		sLoadQueue.erase(std::find(sLoadQueue.begin(), sLoadQueue.end(), this));
+	}else{
+		LOG(LogDebug) << "Queueing system \"" << mName << "\" for background loading";
+		mLoading = true;
+	}
+
+	if(first)
+		sLoadQueue.push_front(this);
+	else
+		sLoadQueue.push_back(this);
+
+	if(!sLoaderRunning)
+	{
+		sLoaderRunning = true;
+		sLoaderThread = boost::thread(&SystemData::runLoader);
+	}
+	sLoaderCondition.notify_one();
+}
+
+void SystemData::cancelLoad()
+{
+	boost::mutex::scoped_lock lock(sLoaderMutex);
+
+	auto it = std::find(sLoadQueue.begin(), sLoadQueue.end(), this);
+	if(it != sLoadQueue.end())
+	{
+		sLoadQueue.erase(it);
+		mLoading = false;
+	}
+
+	while(sLoadingSystem == this)
+		sLoadedCondition.wait(lock);
+}
+
+void SystemData::ensureLoaded()
+{
+	touch();
+
+	if(isLoaded())
+		return;
+
+	// not worth waiting for the loader to get to it, it may be busy with another system
+	cancelLoad();
+
+	if(!isLoaded())
+	{
+		populate();
+
+		boost::mutex::scoped_lock lock(sLoaderMutex);
+		sLoadedSystems.push_back(this);
+	}
+}
+
+void SystemData::runLoader()
+{
+	boost::mutex::scoped_lock lock(sLoaderMutex);
+	while(true)
+	{
+		while(sLoaderRunning && sLoadQueue.empty())
+			sLoaderCondition.wait(lock);
+
+		if(!sLoaderRunning)
+			break;
+
+		SystemData* system = sLoadQueue.front();
+		sLoadQueue.pop_front();
+		sLoadingSystem = system;
+
+		lock.unlock();
+		LOG(LogDebug) << "Loading system \"" << system->mName << "\" in background";
+		system->populate();
+		lock.lock();
+
+		system->mLoading = false;
+		sLoadingSystem = NULL;
+		sLoadedSystems.push_back(system);
+		sLoadedCondition.notify_all();
+	}
+}
+
+void SystemData::subscribeLoaded(SystemLoadedFunction callback)
+{
+	sLoadedCallbacks.push_back(callback);
+}
+
+void SystemData::processLoaded()
+{
+	std::vector<SystemData*> loaded;
+	{
+		boost::mutex::scoped_lock lock(sLoaderMutex);
+		loaded.swap(sLoadedSystems);
+	}
+
+	for(auto system = loaded.begin(); system != loaded.end(); system++)
+	{
+		for(auto callback = sLoadedCallbacks.begin(); callback != sLoadedCallbacks.end(); callback++)
+			(*callback)(*system);
+	}
+}
+
+void SystemData::stopLoader()
+{
+	{
+		boost::mutex::scoped_lock lock(sLoaderMutex);
+		if(!sLoaderRunning)
+			return;
+
+		sLoaderRunning = false;
+		for(auto it = sLoadQueue.begin(); it != sLoadQueue.end(); it++)
+			(*it)->mLoading = false;
+		sLoadQueue.clear();
+		sLoadedSystems.clear();
+	}
+	sLoaderCondition.notify_one();
+
+	// after the system it is loading, if any
+	sLoaderThread.join();
+}
+
+bool SystemData::canUnload() const
+{
+	if(!isLoaded() || mIsFavorite)
+		return false;
+
+	{
+		boost::mutex::scoped_lock lock(sLoaderMutex);
+		if(mLoading)
+			return false;
+	}
+
+	// favorites are referenced by the favorites system, keep those trees alive
+	return getFavoritesCount() == 0;
+}
+
+void SystemData::unload()
+{
+	if(!isLoaded())
+		return;
+
+	LOG(LogInfo) << "Releasing games of idle system \"" << mName << "\"";
+	updateGamelist(this);
+	storeCounts();
+	mLoaded.store(false, std::memory_order_release);
+	mRootFolder->clear();
+}
+
+std::vector<SystemData*> SystemData::releaseIdleSystems(SystemData* current)
+{
+	std::vector<SystemData*> released;
+	if(!Settings::getInstance()->getBool("LazyLoading"))
+		return released;
+
+	const unsigned int now = SDL_GetTicks();
+	const unsigned int maxIdle = (unsigned int)Settings::getInstance()->getInt("LazyReleaseTime");
+	for(auto it = sSystemVector.begin(); it != sSystemVector.end(); it++)
+	{
+		SystemData* system = *it;
+		if(system == current)
+			continue;
+
+		if(system->canUnload() && now - system->mLastVisit > maxIdle)
+		{
+			system->unload();
+			released.push_back(system);
+		}
+	}
+	return released;
+}
+
+void SystemData::storeCounts()
+{
+	GameCounts counts;
+	counts.games = mRootFolder->getFilesRecursive(GAME).size();
+	counts.favorites = mRootFolder->getFavoritesRecursive(GAME).size();
+	counts.hidden = mRootFolder->getHiddenRecursive(GAME).size();
+
+	boost::mutex::scoped_lock lock(sCountCacheMutex);
+	mCachedCounts = counts;
+	sCountCache[mName] = counts;
+}
+
+SystemData::GameCounts SystemData::getCachedCounts() const
+{
+	boost::mutex::scoped_lock lock(sCountCacheMutex);
+	return mCachedCounts;
+}
+
+void SystemData::loadCountCache()
+{
+	boost::mutex::scoped_lock lock(sCountCacheMutex);
+	sCountCache.clear();
+
+	std::string path = getHomePath() + "/.emulationstation/es_gamecounts.cfg";
+	if(!fs::exists(path))
+		return;
+
+	pugi::xml_document doc;
+	pugi::xml_parse_result result = doc.load_file(path.c_str());
+	if(!result)
+	{
+		LOG(LogError) << "Could not parse game count cache file!\n   " << result.description();
+		return;
+	}
+
+	for(pugi::xml_node node = doc.child("gameCounts").child("system"); node; node = node.next_sibling("system"))
+	{
+		GameCounts counts;
+		counts.games = node.attribute("games").as_uint();
+		counts.favorites = node.attribute("favorites").as_uint();
+		counts.hidden = node.attribute("hidden").as_uint();
+		sCountCache[node.attribute("name").as_string()] = counts;
+	}
+}
+
+void SystemData::saveCountCache()
+{
+	boost::mutex::scoped_lock lock(sCountCacheMutex);
+
+	pugi::xml_document doc;
+	pugi::xml_node root = doc.append_child("gameCounts");
+	for(auto it = sCountCache.begin(); it != sCountCache.end(); it++)
+	{
+		pugi::xml_node node = root.append_child("system");
+		node.append_attribute("name").set_value(it->first.c_str());
+		node.append_attribute("games").set_value(it->second.games);
+		node.append_attribute("favorites").set_value(it->second.favorites);
+		node.append_attribute("hidden").set_value(it->second.hidden);
+	}
+
+	std::string path = getHomePath() + "/.emulationstation/es_gamecounts.cfg";
+	doc.save_file(path.c_str());
+}
+
 
 std::string strreplace(std::string str, const std::string& replace, const std::string& with)
 {
@@ -211,6 +522,7 @@ void SystemData::launchGame(Window* window, FileData* game)
 
 	AudioManager::getInstance()->deinit();
 	VolumeControl::getInstance()->deinit();
+	Settings::getInstance()->flush();
 
 	window->deinit();
 
@@ -346,7 +658,7 @@ SystemData * createSystem(pugi::xml_node * systemsNode, int index ){
                     platformIds,
 										themeFolder,
 										systemEmulators);
-	if(newSys->getRootFolder()->getChildren().size() == 0)
+	if(newSys->getGameCount() == 0)
 	{
 		LOG(LogWarning) << "System \"" << name << "\" has no games! Ignoring it.";
 		delete newSys;
@@ -390,6 +702,8 @@ bool SystemData::loadConfig()
 		return false;
 	}
 
+	loadCountCache();
+
 	// THE CREATION OF EACH SYSTEM
 	boost::asio::io_service ioService;
 	boost::thread_group threadpool;
@@ -423,15 +737,21 @@ bool SystemData::loadConfig()
 	ioService.stop();
 	threadpool.join_all();
 
+	saveCountCache();
+	ThemeData::logCacheStats();
+
 	return true;
 }
 
 bool deleteSystem(SystemData * system){
 	delete system;
+	return true;
 }
 
 void SystemData::deleteSystems()
 {
+	stopLoader();
+
 	if(sSystemVector.size()) {
 		// THE DELETION OF EACH SYSTEM
 		boost::asio::io_service ioService;
@@ -461,6 +781,8 @@ void SystemData::deleteSystems()
 		ioService.stop();
 		threadpool.join_all();
 		sSystemVector.clear();
+
+		saveCountCache();
 	}
 }
 
@@ -515,16 +837,22 @@ bool SystemData::hasGamelist() const
 
 unsigned int SystemData::getGameCount() const
 {
+	if(!isLoaded())
+		return getCachedCounts().games;
 	return mRootFolder->getFilesRecursive(GAME).size();
 }
 
 unsigned int SystemData::getFavoritesCount() const
 {
+	if(!isLoaded())
+		return getCachedCounts().favorites;
 	return mRootFolder->getFavoritesRecursive(GAME).size();
 }
 
 unsigned int SystemData::getHiddenCount() const
 {
+	if(!isLoaded())
+		return getCachedCounts().hidden;
 	return mRootFolder->getHiddenRecursive(GAME).size();
 }
 
@@ -541,6 +869,7 @@ void SystemData::loadTheme()
 	{
 		mTheme->loadFile(path);
 		mHasFavorites = mTheme->getHasFavoritesInTheme();
+		Sound::preloadTheme(mTheme);
 	} catch(ThemeException& e)
 	{
 		LOG(LogError) << e.what();
@@ -549,6 +878,7 @@ void SystemData::loadTheme()
 }
 
 void SystemData::refreshRootFolder() {
+  ensureLoaded();
   mRootFolder->clear();
   populateFolder(mRootFolder);
   mRootFolder->sort(FileSorts::SortTypes.at(0));
@@ -2,12 +2,19 @@
 
 #include <vector>
 #include <string>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <boost/thread.hpp>
 #include "FileData.h"
 #include "Window.h"
 #include "MetaData.h"
 #include "PlatformId.h"
 #include "ThemeData.h"
 
+class SystemData;
+typedef std::function<void(SystemData* system)> SystemLoadedFunction;
+
 class SystemData
 {
 public:
@@ -46,6 +53,18 @@ public:
 	unsigned int getFavoritesCount() const;
 	unsigned int getHiddenCount() const;
 
+	// Lazy loading ("LazyLoading" setting): the game tree is only scanned and parsed
+	// when the system is first needed. Until then counts come from the count cache.
+	inline bool isLoaded() const { return mLoaded.load(std::memory_order_acquire); }
+	// queue it for the loader thread, ahead of the systems highlighted before, or behind everything
+	// already queued if not first
+	void loadAsync(bool first = true);
+	void ensureLoaded(); // block until the game tree is available
+	void unload(); // save the gamelist and free the game tree
+	bool canUnload() const;
+	void touch();
+	inline unsigned int getLastVisit() const { return mLastVisit; }
+
 	void launchGame(Window* window, FileData* game);
 
 	static void deleteSystems();
@@ -55,6 +74,14 @@ public:
 	static std::vector<SystemData*> sSystemVector;
 	static int getSystemIndex(std::string name);
 
+	// Frees the game trees of lazily loaded systems not visited for "LazyReleaseTime" ms.
+	// Returns the released systems so their views can be dropped.
+	static std::vector<SystemData*> releaseIdleSystems(SystemData* current);
+
+	// The callbacks run on the UI thread, from processLoaded(), for every system loaded since the last call.
+	static void subscribeLoaded(SystemLoadedFunction callback);
+	static void processLoaded(); // UI thread, once per frame
+
 	inline std::vector<SystemData*>::const_iterator getIterator() const { return std::find(sSystemVector.begin(), sSystemVector.end(), this); };
 	inline std::vector<SystemData*>::const_reverse_iterator getRevIterator() const { return std::find(sSystemVector.rbegin(), sSystemVector.rend(), this); };
 
@@ -101,6 +128,45 @@ private:
 	bool mIsFavorite;
 
 	void populateFolder(FileData* folder);
+	void populate(); // scan, parse gamelist and sort; may run on the loader thread
+
+	// set with release ordering once the loader thread is done with the tree, so the thread that
+	// sees it set also sees the tree
+	std::atomic<bool> mLoaded;
+	bool mLoading; // queued or being populated, guarded by sLoaderMutex
+	unsigned int mLastVisit;
+
+	// takes it out of the loader queue, or waits for the loader thread to be done with it
+	void cancelLoad();
+
+	// one loader thread for every system, the most recently highlighted system goes first
+	static boost::thread sLoaderThread;
+	static boost::mutex sLoaderMutex;
+	static boost::condition_variable sLoaderCondition; // something was queued, or stopLoader()
+	static boost::condition_variable sLoadedCondition; // the loader thread finished a system
+	static std::deque<SystemData*> sLoadQueue;
+	static SystemData* sLoadingSystem;
+	static bool sLoaderRunning;
+	static std::vector<SystemData*> sLoadedSystems; // not yet seen by processLoaded(), guarded by sLoaderMutex
+	static std::vector<SystemLoadedFunction> sLoadedCallbacks; // UI thread only
+	static void runLoader();
+	static void stopLoader();
+
+	struct GameCounts
+	{
+		unsigned int games;
+		unsigned int favorites;
+		unsigned int hidden;
+	};
+	GameCounts mCachedCounts; // guarded by sCountCacheMutex, written by the loader thread
+	void storeCounts();
+	GameCounts getCachedCounts() const;
+
+	// persisted to ~/.emulationstation/es_gamecounts.cfg so lazy systems can be shown at boot
+	static std::map<std::string, GameCounts> sCountCache;
+	static boost::mutex sCountCacheMutex;
+	static void loadCountCache();
+	static void saveCountCache();
 
 	std::map<std::string, std::vector<std::string> *> *mEmulators;
 
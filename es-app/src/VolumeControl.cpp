@@ -2,6 +2,12 @@
 
 #include "Log.h"
 #include <math.h>
+#include <vector>
+
+#if defined(__linux__)
+	#include <errno.h>
+	#include <poll.h>
+#endif
 
 #if defined(__linux__)
     #ifdef _RPI_
@@ -16,7 +22,7 @@ std::weak_ptr<VolumeControl> VolumeControl::sInstance;
 
 
 VolumeControl::VolumeControl()
-	: originalVolume(0), internalVolume(0)
+	: originalVolume(0), internalVolume(0), mPendingVolume(-1), mExternalVolume(-1), mKnownVolume(-1), mNextListener(0)
 #if defined (__APPLE__)
     #warning TODO: Not implemented for MacOS yet!!!
 #elif defined(__linux__)
@@ -25,6 +31,9 @@ VolumeControl::VolumeControl()
 	, mixerHandle(nullptr), endpointVolume(nullptr)
 #endif
 {
+#if defined(__linux__)
+	mWakePipe[0] = mWakePipe[1] = -1;
+#endif
 	init();
 
 	//get original volume levels for system
@@ -132,6 +141,20 @@ void VolumeControl::init()
 		{
 			LOG(LogError) << "VolumeControl::init() - Failed to open ALSA mixer!";
 		}
+
+		if (mixerHandle != nullptr)
+		{
+			{
+				boost::mutex::scoped_lock lock(mMixerMutex);
+				mKnownVolume = readVolume();
+			}
+
+			//wait for changes made by anything else
+			if (pipe(mWakePipe) == 0)
+				mEventThread = boost::thread(&VolumeControl::runEvents, this);
+			else
+				LOG(LogError) << "VolumeControl::init() - Failed to create the event thread pipe!";
+		}
 	}
 #elif defined(WIN32) || defined(_WIN32)
 	//get windows version information
@@ -210,10 +233,26 @@ void VolumeControl::init()
 
 void VolumeControl::deinit()
 {
+	//the last value set may not have been written yet
+	update();
+
 	//deinitialize audio mixer interface
 #if defined (__APPLE__)
     #warning TODO: Not implemented for MacOS yet!!!
 #elif defined(__linux__)
+	if (mEventThread.joinable()) {
+		char stop = 0;
+		if (write(mWakePipe[1], &stop, 1) != 1)
+			LOG(LogError) << "VolumeControl::deinit() - Failed to stop the event thread!";
+		mEventThread.join();
+	}
+	for (int i = 0; i < 2; i++) {
+		if (mWakePipe[i] != -1) {
+			close(mWakePipe[i]);
+			mWakePipe[i] = -1;
+		}
+	}
+
 	if (mixerHandle != nullptr) {
 		snd_mixer_detach(mixerHandle, mixerCard);
 		snd_mixer_free(mixerHandle);
@@ -235,6 +274,130 @@ void VolumeControl::deinit()
 }
 
 int VolumeControl::getVolume() const
+{
+	//not written yet, but that's what it will be
+	const int pending = mPendingVolume;
+	if (pending != -1)
+		return pending;
+
+	boost::mutex::scoped_lock lock(mMixerMutex);
+	return readVolume();
+}
+
+void VolumeControl::setVolume(int volume)
+{
+	//clamp to 0-100 range
+	if (volume < 0)
+	{
+		volume = 0;
+	}
+	if (volume > 100)
+	{
+		volume = 100;
+	}
+	//store values in internal variables
+	internalVolume = volume;
+	mPendingVolume = volume;
+}
+
+void VolumeControl::update()
+{
+	const int pending = mPendingVolume.exchange(-1);
+	if (pending != -1)
+	{
+		boost::mutex::scoped_lock lock(mMixerMutex);
+		if (pending != mKnownVolume)
+		{
+			writeVolume(pending);
+			//what the mixer rounded it to, so the event it sends back isn't taken for someone else's change
+			mKnownVolume = readVolume();
+		}
+	}
+
+	const int external = mExternalVolume.exchange(-1);
+	if (external != -1)
+	{
+		LOG(LogDebug) << "VolumeControl::update() - Volume changed to " << external;
+		internalVolume = external;
+
+		//a listener may remove itself
+		std::vector<std::function<void(int)>> listeners;
+		for (auto it = mListeners.begin(); it != mListeners.end(); it++)
+			listeners.push_back(it->second);
+		for (auto it = listeners.begin(); it != listeners.end(); it++)
+			(*it)(external);
+	}
+}
+
+int VolumeControl::addListener(const std::function<void(int)>& listener)
+{
+	const int id = mNextListener++;
+	mListeners[id] = listener;
+	return id;
+}
+
+void VolumeControl::removeListener(int id)
+{
+	mListeners.erase(id);
+}
+
+#if defined(__linux__)
+void VolumeControl::runEvents()
+{
+	std::vector<struct pollfd> fds;
+	while (true)
+	{
+		int count;
+		{
+			boost::mutex::scoped_lock lock(mMixerMutex);
+			count = snd_mixer_poll_descriptors_count(mixerHandle);
+			if (count < 0)
+				count = 0;
+			fds.resize(count + 1);
+			count = snd_mixer_poll_descriptors(mixerHandle, &fds[1], count);
+			if (count < 0)
+				count = 0;
+		}
+		fds[0].fd = mWakePipe[0];
+		fds[0].events = POLLIN;
+		fds[0].revents = 0;
+
+		if (poll(&fds[0], count + 1, -1) < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			LOG(LogError) << "VolumeControl::runEvents() - Failed to wait for mixer events!";
+			return;
+		}
+
+		//deinit()
+		if (fds[0].revents != 0)
+			return;
+
+		boost::mutex::scoped_lock lock(mMixerMutex);
+		unsigned short revents = 0;
+		snd_mixer_poll_descriptors_revents(mixerHandle, &fds[1], count, &revents);
+		if (revents & (POLLERR | POLLHUP | POLLNVAL))
+		{
+			LOG(LogError) << "VolumeControl::runEvents() - Lost the mixer!";
+			return;
+		}
+		if (revents & POLLIN)
+		{
+			snd_mixer_handle_events(mixerHandle);
+
+			const int volume = readVolume();
+			if (volume != mKnownVolume)
+			{
+				mKnownVolume = volume;
+				mExternalVolume = volume;
+			}
+		}
+	}
+}
+#endif
+
+int VolumeControl::readVolume() const
 {
 	int volume = 0;
 
@@ -319,19 +482,8 @@ int VolumeControl::getVolume() const
 	return volume;
 }
 
-void VolumeControl::setVolume(int volume)
+void VolumeControl::writeVolume(int volume)
 {
-	//clamp to 0-100 range
-	if (volume < 0)
-	{
-		volume = 0;
-	}
-	if (volume > 100)
-	{
-		volume = 100;
-	}
-	//store values in internal variables
-	internalVolume = volume;
 #if defined (__APPLE__)
     #warning TODO: Not implemented for MacOS yet!!!
 #elif defined(__linux__)
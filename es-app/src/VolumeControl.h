@@ -1,7 +1,11 @@
 #pragma once
 
+#include <atomic>
+#include <functional>
+#include <map>
 #include <memory>
 #include <stdint.h>
+#include <boost/thread.hpp>
 
 #if defined (__APPLE__)
     #warning TODO: Not implemented for MacOS yet!!!
@@ -18,6 +22,9 @@
 
 /*!
 Singleton pattern. Call getInstance() to get an object.
+The mixer stays open between init() and deinit(). setVolume() only records the value, update() writes
+the latest one once per frame, so a slider held down doesn't hammer the mixer. On Linux a thread
+waits for mixer events, and volume changes made by anything else reach the listeners in update().
 */
 class VolumeControl
 {
@@ -39,6 +46,25 @@ class VolumeControl
 	int originalVolume;
 	int internalVolume;
 
+	std::atomic<int> mPendingVolume; // -1 if there is nothing to write
+	std::atomic<int> mExternalVolume; // -1 if nothing changed it
+	int mKnownVolume; // what the mixer was at last, guarded by mMixerMutex
+	mutable boost::mutex mMixerMutex; // the mixer handle isn't thread safe
+
+	std::map<int, std::function<void(int)>> mListeners;
+	int mNextListener;
+
+#if defined(__linux__)
+	boost::thread mEventThread;
+	int mWakePipe[2]; // written to stop the event thread
+
+	void runEvents();
+#endif
+
+	// mMixerMutex held
+	int readVolume() const;
+	void writeVolume(int volume);
+
 	static std::weak_ptr<VolumeControl> sInstance;
 
 	VolumeControl();
@@ -54,5 +80,12 @@ public:
 	int getVolume() const;
 	void setVolume(int volume);
 
+	// UI thread, once per frame
+	void update();
+
+	// called from update() with the new volume when something else changed it
+	int addListener(const std::function<void(int)>& listener);
+	void removeListener(int id);
+
 	~VolumeControl();
 };
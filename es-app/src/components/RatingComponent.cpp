@@ -108,11 +108,18 @@ void RatingComponent::render(const Eigen::Affine3f& parentTrans)
 	glVertexPointer(2, GL_FLOAT, sizeof(Vertex), &mVertices[0].pos);
 	glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), &mVertices[0].tex);
 	
-	mFilledTexture->bind();
-	glDrawArrays(GL_TRIANGLES, 0, 6);
+	// the stars may still be rasterizing
+	if(mFilledTexture->isInitialized())
+	{
+		mFilledTexture->bind();
+		glDrawArrays(GL_TRIANGLES, 0, 6);
+	}
 
-	mUnfilledTexture->bind();
-	glDrawArrays(GL_TRIANGLES, 6, 6);
+	if(mUnfilledTexture->isInitialized())
+	{
+		mUnfilledTexture->bind();
+		glDrawArrays(GL_TRIANGLES, 6, 6);
+	}
 
 	glDisableClientState(GL_VERTEX_ARRAY);
 	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
@@ -150,14 +157,14 @@ void RatingComponent::applyTheme(const std::shared_ptr<ThemeData>& theme, const
 		return;
 
 	bool imgChanged = false;
-	if(properties & PATH && elem->has("filledPath"))
+	if(properties & PATH && elem->has(ThemeProperty::FILLED_PATH))
 	{
-		mFilledTexture = TextureResource::get(elem->get<std::string>("filledPath"), true);
+		mFilledTexture = TextureResource::get(elem->get<std::string>(ThemeProperty::FILLED_PATH), true);
 		imgChanged = true;
 	}
-	if(properties & PATH && elem->has("unfilledPath"))
+	if(properties & PATH && elem->has(ThemeProperty::UNFILLED_PATH))
 	{
-		mUnfilledTexture = TextureResource::get(elem->get<std::string>("unfilledPath"), true);
+		mUnfilledTexture = TextureResource::get(elem->get<std::string>(ThemeProperty::UNFILLED_PATH), true);
 		imgChanged = true;
 	}
 
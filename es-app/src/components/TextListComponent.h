@@ -12,11 +12,12 @@
 #include <string>
 #include <memory>
 #include <functional>
+#include <algorithm>
 
 struct TextListData
 {
 	unsigned int colorId;
-	std::shared_ptr<TextCache> textCache;
+	std::weak_ptr<TextCache> textCache; // owned by the list's cache ring, expires when evicted
 };
 
 //A graphical list. Supports multiple colors for rows and scrolling.
@@ -31,9 +32,10 @@ protected:
 	using IList<TextListData, T>::getTransform;
 	using IList<TextListData, T>::mSize;
 	using IList<TextListData, T>::mCursor;
-    using typename IList<TextListData, T>::Entry;
+	using IList<TextListData, T>::mScrollVelocity;
 
 public:
+	using typename IList<TextListData, T>::Entry;
 	using IList<TextListData, T>::size;
 	using IList<TextListData, T>::isScrolling;
 	using IList<TextListData, T>::stopScrolling;
@@ -61,15 +63,13 @@ public:
 	inline void setFont(const std::shared_ptr<Font>& font)
 	{
 		mFont = font;
-		for(auto it = mEntries.begin(); it != mEntries.end(); it++)
-			it->data.textCache.reset();
+		clearTextCaches();
 	}
 
 	inline void setUppercase(bool uppercase) 
 	{
 		mUppercase = true;
-		for(auto it = mEntries.begin(); it != mEntries.end(); it++)
-			it->data.textCache.reset();
+		clearTextCaches();
 	}
 
 	inline void setSelectorColor(unsigned int color) { mSelectorColor = color; }
@@ -104,6 +104,27 @@ private:
 	std::shared_ptr<Sound> mScrollSound;
 	static const unsigned int COLOR_ID_COUNT = 2;
 	unsigned int mColors[COLOR_ID_COUNT];
+
+	// Text caches only exist for the rows around the visible window: they are owned by this
+	// LRU ring, sized for one screen plus CACHE_MARGIN rows on each side, so memory stays
+	// flat whatever the list size. Rows ahead of the scroll direction are prebuilt on the
+	// render thread, PREFETCH_PER_FRAME at a time: Font::getGlyph uploads missing glyphs to
+	// GL textures and its glyph map has no locking, so layout can't move to another thread.
+	// Entries keep their own name, it is the displayed label (with favorite/hidden icons),
+	// not a copy of the FileData name.
+	static const int CACHE_MARGIN = 8;
+	static const int PREFETCH_PER_FRAME = 2;
+
+	struct CacheSlot
+	{
+		std::shared_ptr<TextCache> cache;
+		unsigned int lastUsed;
+	};
+	std::vector<CacheSlot> mCacheRing;
+	unsigned int mFrame;
+
+	std::shared_ptr<TextCache> getTextCache(Entry& entry, bool build = true);
+	void clearTextCaches();
 };
 
 template <typename T>
@@ -123,6 +144,50 @@ TextListComponent<T>::TextListComponent(Window* window) :
 	mSelectedColor = 0;
 	mColors[0] = 0x0000FFFF;
 	mColors[1] = 0x00FF00FF;
+	mFrame = 1;
+}
+
+template <typename T>
+std::shared_ptr<TextCache> TextListComponent<T>::getTextCache(Entry& entry, bool build)
+{
+	std::shared_ptr<TextCache> cache = entry.data.textCache.lock();
+	if(cache)
+	{
+		for(auto it = mCacheRing.begin(); it != mCacheRing.end(); it++)
+		{
+			if(it->cache == cache)
+			{
+				it->lastUsed = mFrame;
+				break;
+			}
+		}
+		return cache;
+	}
+
+	if(!build || mCacheRing.empty())
+		return cache;
+
+	cache = std::shared_ptr<TextCache>(mFont->buildTextCache(mUppercase ? strToUpper(entry.name) : entry.name, 0, 0, 0x000000FF));
+	entry.data.textCache = cache;
+
+	// replace the least recently used slot, its row will rebuild its cache if it comes back into view
+	auto lru = std::min_element(mCacheRing.begin(), mCacheRing.end(),
+		[](const CacheSlot& a, const CacheSlot& b) { return a.lastUsed < b.lastUsed; });
+	lru->cache = cache;
+	lru->lastUsed = mFrame;
+	return cache;
+}
+
+template <typename T>
+void TextListComponent<T>::clearTextCaches()
+{
+	for(auto it = mEntries.begin(); it != mEntries.end(); it++)
+		it->data.textCache.reset();
+	for(auto it = mCacheRing.begin(); it != mCacheRing.end(); it++)
+	{
+		it->cache.reset();
+		it->lastUsed = 0;
+	}
 }
 
 template <typename T>
@@ -157,6 +222,14 @@ void TextListComponent<T>::render(const Eigen::Affine3f& parentTrans)
 	if(listCutoff > size())
 		listCutoff = size();
 
+	mFrame++;
+	if(mCacheRing.size() != (unsigned int)(screenCount + CACHE_MARGIN * 2))
+	{
+		clearTextCaches();
+		CacheSlot empty = { nullptr, 0 };
+		mCacheRing.assign(screenCount + CACHE_MARGIN * 2, empty);
+	}
+
 	// draw selector bar
 	if(startEntry < listCutoff)
 	{
@@ -180,10 +253,8 @@ void TextListComponent<T>::render(const Eigen::Affine3f& parentTrans)
 		else
 			color = mColors[entry.data.colorId];
 
-		if(!entry.data.textCache)
-			entry.data.textCache = std::unique_ptr<TextCache>(font->buildTextCache(mUppercase ? strToUpper(entry.name) : entry.name, 0, 0, 0x000000FF));
-
-		entry.data.textCache->setColor(color);
+		std::shared_ptr<TextCache> textCache = getTextCache(entry);
+		textCache->setColor(color);
 
 		Eigen::Vector3f offset(0, y, 0);
 
@@ -193,12 +264,12 @@ void TextListComponent<T>::render(const Eigen::Affine3f& parentTrans)
 			offset[0] = mHorizontalMargin;
 			break;
 		case ALIGN_CENTER:
-			offset[0] = (mSize.x() - entry.data.textCache->metrics.size.x()) / 2;
+			offset[0] = (mSize.x() - textCache->metrics.size.x()) / 2;
 			if(offset[0] < 0)
 				offset[0] = 0;
 			break;
 		case ALIGN_RIGHT:
-			offset[0] = (mSize.x() - entry.data.textCache->metrics.size.x());
+			offset[0] = (mSize.x() - textCache->metrics.size.x());
 			offset[0] -= mHorizontalMargin;
 			if(offset[0] < 0)
 				offset[0] = 0;
@@ -212,13 +283,28 @@ void TextListComponent<T>::render(const Eigen::Affine3f& parentTrans)
 		drawTrans.translate(offset);
 		Renderer::setMatrix(drawTrans);
 
-		font->renderTextCache(entry.data.textCache.get());
+		font->renderTextCache(textCache.get());
 		
 		y += entrySize;
 	}
 
 	Renderer::popClipRect();
 
+	// keep the rows ahead of the scroll direction warm, building a few new ones per frame
+	const int dir = mScrollVelocity < 0 ? -1 : 1;
+	int built = 0;
+	for(int i = 0; i < CACHE_MARGIN; i++)
+	{
+		int index = (dir > 0) ? listCutoff + i : startEntry - 1 - i;
+		if(index < 0 || index >= size())
+			break;
+
+		Entry& entry = mEntries.at((unsigned int)index);
+		bool build = built < PREFETCH_PER_FRAME && entry.data.textCache.expired();
+		if(getTextCache(entry, build) && build)
+			built++;
+	}
+
 	listRenderTitleOverlay(trans);
 
 	GuiComponent::renderChildren(trans);
@@ -326,26 +412,26 @@ void TextListComponent<T>::applyTheme(const std::shared_ptr<ThemeData>& theme, c
 	using namespace ThemeFlags;
 	if(properties & COLOR)
 	{
-		if(elem->has("selectorColor"))
-			setSelectorColor(elem->get<unsigned int>("selectorColor"));
-		if(elem->has("selectedColor"))
-			setSelectedColor(elem->get<unsigned int>("selectedColor"));
-		if(elem->has("primaryColor"))
-			setColor(0, elem->get<unsigned int>("primaryColor"));
-		if(elem->has("secondaryColor"))
-			setColor(1, elem->get<unsigned int>("secondaryColor"));
+		if(elem->has(ThemeProperty::SELECTOR_COLOR))
+			setSelectorColor(elem->get<unsigned int>(ThemeProperty::SELECTOR_COLOR));
+		if(elem->has(ThemeProperty::SELECTED_COLOR))
+			setSelectedColor(elem->get<unsigned int>(ThemeProperty::SELECTED_COLOR));
+		if(elem->has(ThemeProperty::PRIMARY_COLOR))
+			setColor(0, elem->get<unsigned int>(ThemeProperty::PRIMARY_COLOR));
+		if(elem->has(ThemeProperty::SECONDARY_COLOR))
+			setColor(1, elem->get<unsigned int>(ThemeProperty::SECONDARY_COLOR));
 	}
 
 	setFont(Font::getFromTheme(elem, properties, mFont));
 	
-	if(properties & SOUND && elem->has("scrollSound"))
-		setSound(Sound::get(elem->get<std::string>("scrollSound")));
+	if(properties & SOUND && elem->has(ThemeProperty::SCROLL_SOUND))
+		setSound(Sound::get(elem->get<std::string>(ThemeProperty::SCROLL_SOUND)));
 
 	if(properties & ALIGNMENT)
 	{
-		if(elem->has("alignment"))
+		if(elem->has(ThemeProperty::ALIGNMENT))
 		{
-			const std::string& str = elem->get<std::string>("alignment");
+			const std::string& str = elem->get<std::string>(ThemeProperty::ALIGNMENT);
 			if(str == "left")
 				setAlignment(ALIGN_LEFT);
 			else if(str == "center")
@@ -355,15 +441,15 @@ void TextListComponent<T>::applyTheme(const std::shared_ptr<ThemeData>& theme, c
 			else
 				LOG(LogError) << "Unknown TextListComponent alignment \"" << str << "\"!";
 		}
-		if(elem->has("horizontalMargin"))
+		if(elem->has(ThemeProperty::HORIZONTAL_MARGIN))
 		{
-			mHorizontalMargin = elem->get<float>("horizontalMargin") * (this->mParent ? this->mParent->getSize().x() : (float)Renderer::getScreenWidth());
+			mHorizontalMargin = elem->get<float>(ThemeProperty::HORIZONTAL_MARGIN) * (this->mParent ? this->mParent->getSize().x() : (float)Renderer::getScreenWidth());
 		}
 	}
 
-	if(properties & FORCE_UPPERCASE && elem->has("forceUppercase"))
-		setUppercase(elem->get<bool>("forceUppercase"));
+	if(properties & FORCE_UPPERCASE && elem->has(ThemeProperty::FORCE_UPPERCASE))
+		setUppercase(elem->get<bool>(ThemeProperty::FORCE_UPPERCASE));
 
-	if(properties & LINE_SPACING && elem->has("lineSpacing"))
-		setLineSpacing(elem->get<float>("lineSpacing"));
+	if(properties & LINE_SPACING && elem->has(ThemeProperty::LINE_SPACING))
+		setLineSpacing(elem->get<float>(ThemeProperty::LINE_SPACING));
 }
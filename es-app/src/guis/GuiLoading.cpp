@@ -11,32 +11,51 @@
 #include "Log.h"
 #include "Settings.h"
 #include "RecalboxSystem.h"
+#include "Locale.h"
 
-GuiLoading::GuiLoading(Window *window, const std::function<void*()> &mFunc) : GuiComponent(window), mBusyAnim(window), mFunc(mFunc),mFunc2(NULL) {
+GuiLoading::GuiLoading(Window *window, const std::function<void*()> &mFunc) : GuiComponent(window), mBusyAnim(window), mFunc(mFunc),mFunc2(NULL), mCancelled(false) {
     setSize((float) Renderer::getScreenWidth(), (float) Renderer::getScreenHeight());
     mRunning = true;
     mHandle = new boost::thread(boost::bind(&GuiLoading::threadLoading, this));
     mBusyAnim.setSize(mSize);
 }
 
-GuiLoading::GuiLoading(Window *window, const std::function<void*()> &mFunc, const std::function<void(void *)> &mFunc2) : GuiComponent(window), mBusyAnim(window), mFunc(mFunc),mFunc2(mFunc2) {
+GuiLoading::GuiLoading(Window *window, const std::function<void*()> &mFunc, const std::function<void(void *)> &mFunc2) : GuiComponent(window), mBusyAnim(window), mFunc(mFunc),mFunc2(mFunc2), mCancelled(false) {
     setSize((float) Renderer::getScreenWidth(), (float) Renderer::getScreenHeight());
     mRunning = true;
     mHandle = new boost::thread(boost::bind(&GuiLoading::threadLoading, this));
     mBusyAnim.setSize(mSize);
 }
 
+GuiLoading::GuiLoading(Window *window, const std::vector<CommandFuture> &commands, const std::function<void()> &done) : GuiComponent(window), mBusyAnim(window), mHandle(NULL), mFunc(NULL), mFunc2(NULL), result(NULL), mCommands(commands), mDone(done), mCancelled(false) {
+    setSize((float) Renderer::getScreenWidth(), (float) Renderer::getScreenHeight());
+    mRunning = true;
+    mBusyAnim.setSize(mSize);
+}
+
 GuiLoading::~GuiLoading() {
     mRunning = false;
-    mHandle->join();
+    if (mHandle != NULL) {
+        mHandle->join();
+        delete mHandle;
+    }
 }
 
 bool GuiLoading::input(InputConfig *config, Input input) {
+    if (!mCommands.empty() && config->isMappedTo("b", input) && input.value != 0) {
+        for (auto it = mCommands.begin(); it != mCommands.end(); it++)
+            it->cancel();
+        mCancelled = true;
+        return true;
+    }
     return false;
 }
 
 std::vector<HelpPrompt> GuiLoading::getHelpPrompts() {
-    return std::vector<HelpPrompt>();
+    std::vector<HelpPrompt> prompts;
+    if (!mCommands.empty())
+        prompts.push_back(HelpPrompt("b", _("CANCEL")));
+    return prompts;
 }
 
 void GuiLoading::render(const Eigen::Affine3f &parentTrans) {
@@ -56,6 +75,22 @@ void GuiLoading::update(int deltaTime) {
     GuiComponent::update(deltaTime);
     mBusyAnim.update(deltaTime);
 
+    if (mCancelled) {
+        delete this;
+        return;
+    }
+
+    if (mHandle == NULL) {
+        for (auto it = mCommands.begin(); it != mCommands.end(); it++) {
+            if (it->valid() && !it->isReady())
+                return;
+        }
+        mRunning = false;
+        mDone();
+        delete this;
+        return;
+    }
+
     if (!mRunning) {
         if(mFunc2 != NULL)
             mFunc2(result);
@@ -9,6 +9,7 @@
 #include "GuiComponent.h"
 #include "components/MenuComponent.h"
 #include "components/BusyComponent.h"
+#include "CommandRunner.h"
 
 
 #include <boost/thread.hpp>
@@ -17,6 +18,9 @@ class GuiLoading  : public GuiComponent {
 public:
     GuiLoading(Window *window, const std::function<void *()> &mFunc, const std::function<void(void *)> &mFunc2);
     GuiLoading(Window *window, const std::function<void *()> &mFunc);
+    // waits for commands that are already running, without a thread of its own; b cancels them.
+    // Commands that aren't valid() are skipped.
+    GuiLoading(Window *window, const std::vector<CommandFuture> &commands, const std::function<void()> &done);
 
     virtual ~GuiLoading();
 
@@ -32,10 +36,14 @@ private:
     BusyComponent mBusyAnim;
     boost::thread *mHandle;
     bool mRunning;
-    const std::function<void*()>& mFunc;
-    const std::function<void(void *)>& mFunc2;
+    std::function<void*()> mFunc;
+    std::function<void(void *)> mFunc2;
     void threadLoading();
     void * result;
+
+    std::vector<CommandFuture> mCommands;
+    std::function<void()> mDone;
+    bool mCancelled;
 };
 
 
@@ -106,8 +106,10 @@ GuiMenu::GuiMenu(Window *window) : GuiComponent(window), mMenu(window, _("MAIN M
         });
     }
     if (RecalboxConf::getInstance()->get("system.es.menu") != "bartop") {
-      addEntry(_("SYSTEM SETTINGS").c_str(), 0x777777FF, true,
-                 [this] {
+      // the scripts behind it run while the menu is browsed, they are only waited for if still running
+      RecalboxSystem::getInstance()->prefetchSystemSettings();
+
+      auto openSystemSettings = [this] {
                      Window *window = mWindow;
 
                      auto s = new GuiSettings(mWindow, _("SYSTEM SETTINGS").c_str());
@@ -234,22 +236,31 @@ GuiMenu::GuiMenu(Window *window) : GuiComponent(window), mMenu(window, _("MAIN M
                      }
 
                      s->addSaveFunc([overclock_choice, window, language_choice, language, optionsStorage, selectedStorage] {
+                         std::vector<CommandFuture> commands;
                          if (optionsStorage->changed()) {
-                             RecalboxSystem::getInstance()->setStorage(optionsStorage->getSelected());
+                             commands.push_back(RecalboxSystem::getInstance()->setStorage(optionsStorage->getSelected()));
                          }
 
                          if (Settings::getInstance()->getString("Overclock") != overclock_choice->getSelected()) {
                              Settings::getInstance()->setString("Overclock", overclock_choice->getSelected());
-                             RecalboxSystem::getInstance()->setOverclock(overclock_choice->getSelected());
+                             commands.push_back(RecalboxSystem::getInstance()->setOverclock(overclock_choice->getSelected()));
                          }
                          if (language != language_choice->getSelected()) {
                              RecalboxConf::getInstance()->set("system.language",
                                                               language_choice->getSelected());
                              RecalboxConf::getInstance()->saveRecalboxConf();
                          }
+                         if (!commands.empty()) {
+                             window->pushGui(new GuiLoading(window, commands, [] {}));
+                         }
                      });
                      mWindow->pushGui(s);
 
+                 };
+      addEntry(_("SYSTEM SETTINGS").c_str(), 0x777777FF, true,
+                 [this, openSystemSettings] {
+                     mWindow->pushGui(new GuiLoading(mWindow, RecalboxSystem::getInstance()->prefetchSystemSettings(),
+                                                     openSystemSettings));
                  });
     }
 
@@ -446,10 +457,13 @@ GuiMenu::GuiMenu(Window *window) : GuiComponent(window), mMenu(window, _("MAIN M
                      auto overscan_enabled = std::make_shared<SwitchComponent>(mWindow);
                      overscan_enabled->setState(Settings::getInstance()->getBool("Overscan"));
                      s->addWithLabel(_("OVERSCAN"), overscan_enabled);
-                     s->addSaveFunc([overscan_enabled] {
+                     Window *window = mWindow;
+                     s->addSaveFunc([overscan_enabled, window] {
                          if (Settings::getInstance()->getBool("Overscan") != overscan_enabled->getState()) {
                              Settings::getInstance()->setBool("Overscan", overscan_enabled->getState());
-                             RecalboxSystem::getInstance()->setOverscan(overscan_enabled->getState());
+                             std::vector<CommandFuture> commands;
+                             commands.push_back(RecalboxSystem::getInstance()->setOverscan(overscan_enabled->getState()));
+                             window->pushGui(new GuiLoading(window, commands, [] {}));
                          }
                      });
                      // screensaver time
@@ -522,7 +536,28 @@ GuiMenu::GuiMenu(Window *window) : GuiComponent(window), mMenu(window, _("MAIN M
                          Settings::getInstance()->setString("TransitionStyle", transition_style->getSelected());
                      });
 
-                     // theme set
+                     // gamelist view style, "automatic" picks detailed for systems with thumbnails
+                     auto view_style = std::make_shared<OptionListComponent<std::string> >(mWindow,
+                                                                                           _("GAMELIST VIEW"),
+                                                                                           false);
+                     std::vector<std::string> viewStyles;
+                     viewStyles.push_back("automatic");
+                     viewStyles.push_back("basic");
+                     viewStyles.push_back("detailed");
+                     viewStyles.push_back("grid");
+                     for (auto it = viewStyles.begin(); it != viewStyles.end(); it++)
+                         view_style->add(*it, *it, Settings::getInstance()->getString("GamelistViewStyle") == *it);
+                     s->addWithLabel(_("GAMELIST VIEW"), view_style);
+                     s->addSaveFunc([view_style] {
+                         if (Settings::getInstance()->getString("GamelistViewStyle") == view_style->getSelected())
+                             return;
+
+                         Settings::getInstance()->setString("GamelistViewStyle", view_style->getSelected());
+                         ViewController::get()->reloadAll();
+                     });
+
+                     // theme set, rescanned in case one was installed since startup
+                     ThemeData::refreshThemeSets();
                      auto themeSets = ThemeData::getThemeSets();
 
                      if (!themeSets.empty()) {
@@ -560,6 +595,14 @@ GuiMenu::GuiMenu(Window *window) : GuiComponent(window), mMenu(window, _("MAIN M
                  // volume
                  auto volume = std::make_shared<SliderComponent>(mWindow, 0.f, 100.f, 1.f, "%");
                  volume->setValue((float) VolumeControl::getInstance()->getVolume());
+                 // heard while sliding, written once per frame at most
+                 volume->setSlideCallback([](float value) {
+                     VolumeControl::getInstance()->setVolume((int) round(value));
+                 });
+                 // follows changes made by anything else meanwhile
+                 int volumeListener = VolumeControl::getInstance()->addListener([volume](int value) {
+                     volume->setValue((float) value);
+                 });
                  s->addWithLabel(_("SYSTEM VOLUME"), volume);
 
                  // disable sounds
@@ -580,8 +623,10 @@ GuiMenu::GuiMenu(Window *window) : GuiComponent(window), mMenu(window, _("MAIN M
                  if (RecalboxConf::getInstance()->get("system.es.menu") != "bartop") {
 		   s->addWithLabel(_("OUTPUT DEVICE"), output_list);
                  }
-                 s->addSaveFunc([output_list, currentDevice, sounds_enabled, volume] {
+                 Window *window = mWindow;
+                 s->addSaveFunc([output_list, currentDevice, sounds_enabled, volume, volumeListener, window] {
 
+                     VolumeControl::getInstance()->removeListener(volumeListener);
                      VolumeControl::getInstance()->setVolume((int) round(volume->getValue()));
                      RecalboxConf::getInstance()->set("audio.volume",
                                                       std::to_string((int) round(volume->getValue())));
@@ -592,7 +637,10 @@ GuiMenu::GuiMenu(Window *window) : GuiComponent(window), mMenu(window, _("MAIN M
                          AudioManager::getInstance()->stopMusic();
                      if (currentDevice != output_list->getSelected()) {
                          RecalboxConf::getInstance()->set("audio.device", output_list->getSelected());
-                         RecalboxSystem::getInstance()->setAudioOutputDevice(output_list->getSelected());
+                         CommandFuture command = RecalboxSystem::getInstance()->setAudioOutputDevice(output_list->getSelected());
+                         if (command.valid()) {
+                             window->pushGui(new GuiLoading(window, std::vector<CommandFuture>(1, command), [] {}));
+                         }
                      }
                      RecalboxConf::getInstance()->saveRecalboxConf();
                  });
@@ -635,18 +683,21 @@ GuiMenu::GuiMenu(Window *window) : GuiComponent(window), mMenu(window, _("MAIN M
                              if (baseSSID != newSSID
                                  || baseKEY != newKey
                                  || !baseEnabled) {
-                                 if (RecalboxSystem::getInstance()->enableWifi(newSSID, newKey)) {
-                                     window->pushGui(
-						     new GuiMsgBox(window, _("WIFI ENABLED"))
-                                     );
-                                 } else {
-                                     window->pushGui(
-						     new GuiMsgBox(window, _("WIFI CONFIGURATION ERROR"))
-                                     );
-                                 }
+                                 CommandFuture command = RecalboxSystem::getInstance()->enableWifi(newSSID, newKey);
+                                 window->pushGui(new GuiLoading(window, std::vector<CommandFuture>(1, command), [window, command] {
+                                     if (command.get().succeeded()) {
+                                         window->pushGui(
+						         new GuiMsgBox(window, _("WIFI ENABLED"))
+                                         );
+                                     } else {
+                                         window->pushGui(
+						         new GuiMsgBox(window, _("WIFI CONFIGURATION ERROR"))
+                                         );
+                                     }
+                                 }));
                              }
                          } else if (baseEnabled) {
-                             RecalboxSystem::getInstance()->disableWifi();
+                             window->pushGui(new GuiLoading(window, std::vector<CommandFuture>(1, RecalboxSystem::getInstance()->disableWifi()), [] {}));
                          }
                      });
                      mWindow->pushGui(s);
@@ -901,9 +952,11 @@ void GuiMenu::createConfigInput() {
     row.elements.clear();
 
     row.makeAcceptInputHandler([window, this, s] {
-        RecalboxSystem::getInstance()->forgetBluetoothControllers();
-        window->pushGui(new GuiMsgBox(window,
-                                      _("CONTROLLERS LINKS HAVE BEEN DELETED."), _("OK")));
+        std::vector<CommandFuture> commands(1, RecalboxSystem::getInstance()->forgetBluetoothControllers());
+        window->pushGui(new GuiLoading(window, commands, [window] {
+            window->pushGui(new GuiMsgBox(window,
+                                          _("CONTROLLERS LINKS HAVE BEEN DELETED."), _("OK")));
+        }));
     });
     row.addElement(
             std::make_shared<TextComponent>(window, _("FORGET BLUETOOTH CONTROLLERS"), Font::get(FONT_SIZE_MEDIUM),
@@ -8,6 +8,7 @@
 #include "components/ButtonComponent.h"
 #include "components/ScraperSearchComponent.h"
 #include "components/MenuComponent.h" // for makeButtonGrid
+#include "scrapers/BulkScraper.h"
 #include "guis/GuiMsgBox.h"
 #include "Locale.h"
 
@@ -29,6 +30,7 @@ GuiScraperMulti::GuiScraperMulti(Window* window, const std::queue<ScraperSearchP
 	mCurrentGame = 0;
 	mTotalSuccessful = 0;
 	mTotalSkipped = 0;
+	mTotalResumed = 0;
 
 	// set up grid
 	mTitle = std::make_shared<TextComponent>(mWindow, _("SCRAPING IN PROGRESS"), Font::get(FONT_SIZE_LARGE), 0x555555FF, ALIGN_CENTER);
@@ -40,12 +42,18 @@ GuiScraperMulti::GuiScraperMulti(Window* window, const std::queue<ScraperSearchP
 	mSubtitle = std::make_shared<TextComponent>(mWindow, _("subtitle text"), Font::get(FONT_SIZE_SMALL), 0x888888FF, ALIGN_CENTER);
 	mGrid.setEntry(mSubtitle, Vector2i(0, 2), false, true);
 
-	mSearchComp = std::make_shared<ScraperSearchComponent>(mWindow, 
-		approveResults ? ScraperSearchComponent::ALWAYS_ACCEPT_MATCHING_CRC : ScraperSearchComponent::ALWAYS_ACCEPT_FIRST_RESULT);
-	mSearchComp->setAcceptCallback(std::bind(&GuiScraperMulti::acceptResult, this, std::placeholders::_1));
-	mSearchComp->setSkipCallback(std::bind(&GuiScraperMulti::skip, this));
-	mSearchComp->setCancelCallback(std::bind(&GuiScraperMulti::finish, this));
-	mGrid.setEntry(mSearchComp, Vector2i(0, 3), mSearchComp->getSearchType() != ScraperSearchComponent::ALWAYS_ACCEPT_FIRST_RESULT, true);
+	if(approveResults)
+	{
+		mSearchComp = std::make_shared<ScraperSearchComponent>(mWindow, ScraperSearchComponent::ALWAYS_ACCEPT_MATCHING_CRC);
+		mSearchComp->setAcceptCallback(std::bind(&GuiScraperMulti::acceptResult, this, std::placeholders::_1));
+		mSearchComp->setSkipCallback(std::bind(&GuiScraperMulti::skip, this));
+		mSearchComp->setCancelCallback(std::bind(&GuiScraperMulti::finish, this));
+		mGrid.setEntry(mSearchComp, Vector2i(0, 3), true, true);
+	}else{
+		mBulkScraper = std::unique_ptr<BulkScraper>(new BulkScraper(mSearchQueue));
+		mBulkStatus = std::make_shared<TextComponent>(mWindow, "", Font::get(FONT_SIZE_MEDIUM), 0x777777FF, ALIGN_CENTER);
+		mGrid.setEntry(mBulkStatus, Vector2i(0, 3), false, true);
+	}
 
 	std::vector< std::shared_ptr<ButtonComponent> > buttons;
 
@@ -70,14 +78,17 @@ GuiScraperMulti::GuiScraperMulti(Window* window, const std::queue<ScraperSearchP
 	setSize(Renderer::getScreenWidth() * 0.95f, Renderer::getScreenHeight() * 0.849f);
 	setPosition((Renderer::getScreenWidth() - mSize.x()) / 2, (Renderer::getScreenHeight() - mSize.y()) / 2);
 
-	doNextSearch();
+	if(mBulkScraper)
+		updateBulkProgress();
+	else
+		doNextSearch();
 }
 
 GuiScraperMulti::~GuiScraperMulti()
 {
 	// view type probably changed (basic -> detailed)
 	for(auto it = SystemData::sSystemVector.begin(); it != SystemData::sSystemVector.end(); it++)
-		ViewController::get()->reloadGameListView(*it, false);
+		ViewController::get()->reloadExistingGameListView(*it);
 }
 
 void GuiScraperMulti::onSizeChanged()
@@ -91,6 +102,45 @@ void GuiScraperMulti::onSizeChanged()
 	mGrid.setSize(mSize);
 }
 
+void GuiScraperMulti::update(int deltaTime)
+{
+	GuiComponent::update(deltaTime);
+
+	if(!mBulkScraper)
+		return;
+
+	mBulkScraper->update();
+	if(mBulkScraper->isDone())
+	{
+		finish();
+		return;
+	}
+
+	updateBulkProgress();
+}
+
+void GuiScraperMulti::updateBulkProgress()
+{
+	const FileData* game = mBulkScraper->getLastStarted();
+	if(game != NULL)
+		mSystem->setText(strToUpper(game->getSystem()->getFullName()));
+
+	char strbuf[256];
+	snprintf(strbuf, 256, _("GAME %i OF %i").c_str(), std::min(mBulkScraper->getProcessed() + 1, mBulkScraper->getTotal()), mBulkScraper->getTotal());
+
+	std::stringstream ss;
+	ss << strbuf;
+	if(game != NULL)
+		ss << " - " << strToUpper(game->getPath().filename().string());
+	mSubtitle->setText(ss.str());
+
+	ss.str("");
+	ss << mBulkScraper->getSearching() << " " << _("SEARCHING") << ", " << mBulkScraper->getDownloading() << " " << _("DOWNLOADING");
+	if(mBulkScraper->getResumed() > 0)
+		ss << ", " << mBulkScraper->getResumed() << " " << _("ALREADY SCRAPED");
+	mBulkStatus->setText(ss.str());
+}
+
 void GuiScraperMulti::doNextSearch()
 {
 	if(mSearchQueue.empty())
@@ -137,8 +187,17 @@ void GuiScraperMulti::skip()
 
 void GuiScraperMulti::finish()
 {
+	if(mBulkScraper)
+	{
+		mBulkScraper->stop();
+		mTotalSuccessful = mBulkScraper->getSuccessful();
+		mTotalSkipped = mBulkScraper->getSkipped();
+		mTotalResumed = mBulkScraper->getResumed();
+		mBulkScraper.reset();
+	}
+
 	std::stringstream ss;
-	if(mTotalSuccessful == 0)
+	if(mTotalSuccessful == 0 && mTotalResumed == 0)
 	{
 		ss << _("WE CAN'T FIND ANY SYSTEMS!\n"
 			"CHECK THAT YOUR PATHS ARE CORRECT IN THE SYSTEMS CONFIGURATION FILE, AND "
@@ -155,6 +214,11 @@ void GuiScraperMulti::finish()
 	    snprintf(strbuf, 256, ngettext("%i GAME SKIPPED.", "%i GAMES SKIPPED.", mTotalSkipped).c_str(), mTotalSkipped);
 	    ss << "\n" << strbuf;
 	  }
+
+	  if(mTotalResumed > 0) {
+	    snprintf(strbuf, 256, ngettext("%i GAME ALREADY SCRAPED BY A PREVIOUS RUN.", "%i GAMES ALREADY SCRAPED BY A PREVIOUS RUN.", mTotalResumed).c_str(), mTotalResumed);
+	    ss << "\n" << strbuf;
+	  }
 	}
 
 	mWindow->pushGui(new GuiMsgBox(mWindow, ss.str(), 
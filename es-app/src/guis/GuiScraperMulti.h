@@ -7,6 +7,7 @@
 
 #include <queue>
 
+class BulkScraper;
 class ScraperSearchComponent;
 class TextComponent;
 
@@ -17,12 +18,14 @@ public:
 	virtual ~GuiScraperMulti();
 
 	void onSizeChanged() override;
+	void update(int deltaTime) override;
 	std::vector<HelpPrompt> getHelpPrompts() override;
 
 private:
 	void acceptResult(const ScraperSearchResult& result);
 	void skip();
 	void doNextSearch();
+	void updateBulkProgress();
 	
 	void finish();
 
@@ -30,8 +33,12 @@ private:
 	unsigned int mCurrentGame;
 	unsigned int mTotalSuccessful;
 	unsigned int mTotalSkipped;
+	unsigned int mTotalResumed; // scraped by an interrupted earlier run, not scraped again
 	std::queue<ScraperSearchParams> mSearchQueue;
 
+	// unattended scraping runs many games at once, only approved scraping goes one by one through mSearchComp
+	std::unique_ptr<BulkScraper> mBulkScraper;
+
 	NinePatchComponent mBackground;
 	ComponentGrid mGrid;
 
@@ -39,5 +46,6 @@ private:
 	std::shared_ptr<TextComponent> mSystem;
 	std::shared_ptr<TextComponent> mSubtitle;
 	std::shared_ptr<ScraperSearchComponent> mSearchComp;
+	std::shared_ptr<TextComponent> mBulkStatus;
 	std::shared_ptr<ComponentGrid> mButtonGrid;
 };
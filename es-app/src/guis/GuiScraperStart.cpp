@@ -78,6 +78,8 @@ std::queue<ScraperSearchParams> GuiScraperStart::getSearches(std::vector<SystemD
 	std::queue<ScraperSearchParams> queue;
 	for(auto sys = systems.begin(); sys != systems.end(); sys++)
 	{
+		// a lazy system may not have been scanned yet
+		(*sys)->ensureLoaded();
 		std::vector<FileData*> games = (*sys)->getRootFolder()->getFilesRecursive(GAME);
 		for(auto game = games.begin(); game != games.end(); game++)
 		{
@@ -23,9 +23,13 @@
 #include "Locale.h"
 #include <boost/algorithm/string.hpp>
 #include "resources/Font.h"
+#include "resources/TextureLoader.h"
+#include "HttpThread.h"
+#include "ThreadPool.h"
 #include "RecalboxSystem.h"
 #include "FileSorts.h"
 #include "Lobby.h"
+#include "Metrics.h"
 
 
 #ifdef WIN32
@@ -71,6 +75,14 @@ bool parseArgs(int argc, char* argv[], unsigned int* width, unsigned int* height
 			Settings::getInstance()->setBool("Debug", true);
 			Settings::getInstance()->setBool("HideConsole", false);
 			Log::setReportingLevel(LogDebug);
+		}else if(strcmp(argv[i], "--log-level") == 0)
+		{
+			if(i >= argc - 1 || !Log::setReportingLevels(argv[i + 1]))
+			{
+				std::cerr << "Invalid log level supplied.";
+				return false;
+			}
+			i++; // skip the levels
 		}else if(strcmp(argv[i], "--windowed") == 0)
 		{
 			Settings::getInstance()->setBool("Windowed", true);
@@ -101,6 +113,8 @@ bool parseArgs(int argc, char* argv[], unsigned int* width, unsigned int* height
 				"--no-exit			don't show the exit option in the menu\n"
 				"--hide-systemview		show only gamelist view, no system view\n"
 				"--debug				more logging, show console on Windows\n"
+				"--log-level [levels]		error, warning, info or debug, per subsystem with\n"
+				"				e.g. lobby=debug,scraper=warning\n"
 				"--windowed			not fullscreen, should be used with --resolution\n"
 				"--vsync [1/on or 0/off]		turn vsync on or off (default is on)\n"
 				"--help, -h			summon a sentient, angry tuba\n\n"
@@ -358,6 +372,18 @@ int main(int argc, char* argv[])
 			}
 		}
 
+		// players appearing or leaving the lobby
+		LobbyThread::getInstance()->processEvents();
+
+		// systems the loader thread finished
+		SystemData::processLoaded();
+
+		// music loaded in the background
+		AudioManager::getInstance()->update();
+
+		// the volume slider's last value, and changes made outside
+		VolumeControl::getInstance()->update();
+
 		if(window.isSleeping())
 		{
 			lastTime = SDL_GetTicks();
@@ -376,8 +402,6 @@ int main(int argc, char* argv[])
 		window.update(deltaTime);
 		window.render();
 		Renderer::swapBuffers();
-
-		Log::flush();
 	}
 
 	// Clean ready flag
@@ -387,8 +411,13 @@ int main(int argc, char* argv[])
 		delete window.peekGui();
 
 	window.renderShutdownScreen();
+	Settings::getInstance()->flush();
+	TextureLoader::getInstance()->stop();
+	ThreadPool::shutdown();
 	SystemData::deleteSystems();
+	HttpThread::shutdown();
 	window.deinit();
+	Metrics::log();
 	LOG(LogInfo) << "EmulationStation cleanly shutting down.";
 
 	return 0;
@@ -0,0 +1,329 @@
+#include "scrapers/BulkScraper.h"
+#include "scrapers/LocalDatabaseScraper.h"
+#include "Gamelist.h"
+#include "Log.h"
+#include "Settings.h"
+#include "platform.h"
+#include <SDL.h>
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <fstream>
+
+BulkScraper::BulkScraper(const std::queue<ScraperSearchParams>& searches) :
+	mProgressMatches(false), mSuccessful(0), mSkipped(0), mResumed(0), mLastStarted(NULL), mLastCommit(0)
+{
+	mSearchHost = Settings::getInstance()->getString("Scraper");
+	mOffline = mSearchHost == LOCAL_DATABASE_SCRAPER;
+
+	// local lookups finish within the frame they are started in, there is no server to be polite to
+	mMaxSearches = mOffline ? OFFLINE_SEARCHES : std::max(Settings::getInstance()->getInt("ScraperMaxSearches"), 1);
+	mMaxDownloads = std::max(Settings::getInstance()->getInt("ScraperMaxDownloads"), 1);
+	mRequestsPerSecond = (float)std::max(Settings::getInstance()->getInt("ScraperRequestsPerSecond"), 1);
+
+	std::set<std::string> systems;
+	std::queue<ScraperSearchParams> queue = searches;
+	while(!queue.empty())
+	{
+		systems.insert(queue.front().system->getName());
+		queue.pop();
+	}
+
+	mRunKey = mSearchHost + ":";
+	for(auto it = systems.begin(); it != systems.end(); it++)
+		mRunKey += (it == systems.begin() ? "" : ",") + *it;
+
+	loadProgress();
+
+	queue = searches;
+	while(!queue.empty())
+	{
+		const ScraperSearchParams& params = queue.front();
+		if(mDoneGames.find(params.game->getPath().generic_string()) != mDoneGames.end())
+		{
+			mResumed++;
+		}else{
+			std::unique_ptr<Job> job(new Job());
+			job->params = params;
+			job->attempts = 0;
+			job->retryAt = 0;
+			job->hasResult = false;
+			mPending.push_back(std::move(job));
+		}
+		queue.pop();
+	}
+
+	mTotal = mPending.size();
+
+	if(mResumed > 0)
+		LOG_SUB(LogScraper, LogInfo) << "BulkScraper: resuming, skipping " << mResumed << " games scraped by a previous run";
+}
+
+BulkScraper::~BulkScraper()
+{
+	commit();
+}
+
+void BulkScraper::stop()
+{
+	commit();
+
+	mPending.clear();
+	mRetries.clear();
+	mSearching.clear();
+	mResolving.clear();
+}
+
+void BulkScraper::update()
+{
+	updateSearches();
+	updateResolves();
+	startJobs();
+
+	// large offline runs complete hundreds of games per frame, don't rewrite the gamelists for every batch
+	if(mCompleted.size() >= BATCH_SIZE && SDL_GetTicks() - mLastCommit >= MIN_COMMIT_INTERVAL)
+		commit();
+
+	if(isDone())
+	{
+		commit();
+
+		// everything went through, the next run starts from scratch
+		if(boost::filesystem::exists(getProgressPath()))
+			boost::filesystem::remove(getProgressPath());
+	}
+}
+
+void BulkScraper::startJobs()
+{
+	const unsigned int now = SDL_GetTicks();
+
+	// retries come first, they were queued before anything still pending
+	// one that can't start yet (no slot, no token for its host) doesn't hold back the others
+	auto it = mRetries.begin();
+	while(it != mRetries.end() && it->first <= now)
+	{
+		if(mResolving.size() >= mMaxDownloads && mSearching.size() >= mMaxSearches)
+			break;
+
+		std::unique_ptr<Job>& job = it->second;
+		if(job->hasResult)
+		{
+			if(mResolving.size() >= mMaxDownloads || !takeToken(getHost(job->result.imageUrl)))
+			{
+				it++;
+				continue;
+			}
+
+			startResolve(job);
+		}else{
+			if(mSearching.size() >= mMaxSearches || (!mOffline && !takeToken(mSearchHost)))
+			{
+				it++;
+				continue;
+			}
+
+			job->search = startScraperSearch(job->params);
+			mSearching.push_back(std::move(job));
+		}
+		it = mRetries.erase(it);
+	}
+
+	while(!mPending.empty() && mSearching.size() < mMaxSearches && (mOffline || takeToken(mSearchHost)))
+	{
+		std::unique_ptr<Job>& job = mPending.front();
+		job->search = startScraperSearch(job->params);
+		mLastStarted = job->params.game;
+		mSearching.push_back(std::move(job));
+		mPending.pop_front();
+	}
+}
+
+void BulkScraper::updateSearches()
+{
+	auto it = mSearching.begin();
+	while(it != mSearching.end())
+	{
+		std::unique_ptr<Job>& job = *it;
+		AsyncHandleStatus status = job->search->status();
+		if(status == ASYNC_IN_PROGRESS)
+		{
+			it++;
+			continue;
+		}
+
+		if(status == ASYNC_ERROR)
+		{
+			retry(job, job->search->getStatusString());
+		}else if(job->search->getResults().empty())
+		{
+			complete(job, false);
+		}else{
+			job->result = job->search->getResults().front();
+			job->hasResult = true;
+			job->search.reset();
+
+			if(job->result.imageUrl.empty())
+				complete(job, true);
+			else // the download waits in the retry queue until a slot and a token are free, ahead of the retries
+				mRetries.insert(std::make_pair(0u, std::move(job)));
+		}
+
+		it = mSearching.erase(it);
+	}
+}
+
+void BulkScraper::startResolve(std::unique_ptr<Job>& job)
+{
+	job->resolve = resolveMetaDataAssets(job->result, job->params);
+	mResolving.push_back(std::move(job));
+}
+
+void BulkScraper::updateResolves()
+{
+	auto it = mResolving.begin();
+	while(it != mResolving.end())
+	{
+		std::unique_ptr<Job>& job = *it;
+		AsyncHandleStatus status = job->resolve->status();
+		if(status == ASYNC_IN_PROGRESS)
+		{
+			it++;
+			continue;
+		}
+
+		if(status == ASYNC_ERROR)
+		{
+			retry(job, job->resolve->getStatusString());
+		}else{
+			job->result = job->resolve->getResult();
+			complete(job, true);
+		}
+
+		it = mResolving.erase(it);
+	}
+}
+
+void BulkScraper::retry(std::unique_ptr<Job>& job, const std::string& error)
+{
+	job->search.reset();
+	job->resolve.reset();
+	job->attempts++;
+
+	if(job->attempts >= MAX_ATTEMPTS)
+	{
+		LOG_SUB(LogScraper, LogWarning) << "BulkScraper: giving up on \"" << job->params.game->getPath().generic_string() << "\": " << error;
+
+		// not recorded as done, so the next run tries again
+		mSkipped++;
+		job.reset();
+		return;
+	}
+
+	LOG_SUB(LogScraper, LogInfo) << "BulkScraper: retrying \"" << job->params.game->getPath().generic_string() << "\" (" << error << ")";
+	job->retryAt = SDL_GetTicks() + (RETRY_DELAY << (job->attempts - 1));
+	const unsigned int retryAt = job->retryAt;
+	mRetries.insert(std::make_pair(retryAt, std::move(job)));
+}
+
+void BulkScraper::complete(std::unique_ptr<Job>& job, bool success)
+{
+	job->search.reset();
+	job->resolve.reset();
+
+	if(success)
+		mSuccessful++;
+	else
+		mSkipped++;
+
+	job->hasResult = success;
+	mCompleted.push_back(std::move(job));
+}
+
+void BulkScraper::commit()
+{
+	if(mCompleted.empty())
+		return;
+
+	std::set<SystemData*> systems;
+	std::ofstream progress(getProgressPath(), std::ios_base::out | (mProgressMatches ? std::ios_base::app : std::ios_base::trunc));
+	if(!mProgressMatches)
+	{
+		progress << mRunKey << "\n";
+		mProgressMatches = true;
+	}
+
+	for(auto it = mCompleted.begin(); it != mCompleted.end(); it++)
+	{
+		Job& job = **it;
+		if(job.hasResult)
+		{
+			job.params.game->metadata.merge(job.result.mdl);
+			systems.insert(job.params.system);
+		}
+
+		const std::string path = job.params.game->getPath().generic_string();
+		mDoneGames.insert(path);
+		progress << path << "\n";
+	}
+
+	// one gamelist write per system and batch instead of one per game
+	for(auto it = systems.begin(); it != systems.end(); it++)
+		updateGamelist(*it);
+
+	mCompleted.clear();
+	mLastCommit = SDL_GetTicks();
+}
+
+bool BulkScraper::takeToken(const std::string& host)
+{
+	const unsigned int now = SDL_GetTicks();
+
+	auto it = mBuckets.find(host);
+	if(it == mBuckets.end())
+	{
+		TokenBucket bucket;
+		bucket.tokens = mRequestsPerSecond; // allow a full burst to start with
+		bucket.lastRefill = now;
+		it = mBuckets.insert(std::make_pair(host, bucket)).first;
+	}
+
+	TokenBucket& bucket = it->second;
+	bucket.tokens = std::min(mRequestsPerSecond, bucket.tokens + (now - bucket.lastRefill) * mRequestsPerSecond / 1000.0f);
+	bucket.lastRefill = now;
+
+	if(bucket.tokens < 1.0f)
+		return false;
+
+	bucket.tokens -= 1.0f;
+	return true;
+}
+
+std::string BulkScraper::getHost(const std::string& url)
+{
+	size_t start = url.find("://");
+	start = (start == std::string::npos) ? 0 : start + 3;
+
+	return url.substr(start, url.find('/', start) - start);
+}
+
+std::string BulkScraper::getProgressPath()
+{
+	return getHomePath() + "/.emulationstation/scraper_progress.txt";
+}
+
+void BulkScraper::loadProgress()
+{
+	std::ifstream progress(getProgressPath());
+
+	// left by a run with another scraper or other systems, it is replaced on the first commit
+	std::string line;
+	if(!std::getline(progress, line) || line != mRunKey)
+		return;
+
+	mProgressMatches = true;
+	while(std::getline(progress, line))
+	{
+		if(!line.empty())
+			mDoneGames.insert(line);
+	}
+}
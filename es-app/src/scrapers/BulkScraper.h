@@ -0,0 +1,106 @@
+#pragma once
+
+#include "scrapers/Scraper.h"
+#include <deque>
+#include <list>
+#include <map>
+#include <set>
+
+// Scrapes a whole queue of games without user interaction, always accepting the first result.
+// Keeps up to ScraperMaxSearches searches and ScraperMaxDownloads asset downloads in flight at once,
+// limited per host to ScraperRequestsPerSecond (except for the local database scraper). Failed games are retried with exponential backoff.
+// Results are merged into the metadata and written to the gamelists in batches. Games already
+// done are recorded in a progress file, so an interrupted run picks up where it stopped. The file
+// belongs to one scraper and set of systems, a run with other parameters starts from scratch.
+// Not thread safe, update() is meant to be called once per frame.
+class BulkScraper
+{
+public:
+	BulkScraper(const std::queue<ScraperSearchParams>& searches);
+	~BulkScraper();
+
+	void update();
+
+	// commits what is done and drops everything in flight
+	void stop();
+
+	inline bool isDone() const { return mPending.empty() && mRetries.empty() && mSearching.empty() && mResolving.empty(); }
+
+	inline unsigned int getTotal() const { return mTotal; }
+	inline unsigned int getProcessed() const { return mSuccessful + mSkipped; }
+	inline unsigned int getSuccessful() const { return mSuccessful; }
+	inline unsigned int getSkipped() const { return mSkipped; }
+	inline unsigned int getResumed() const { return mResumed; } // done by an earlier run, not part of getTotal()
+	inline unsigned int getSearching() const { return mSearching.size(); }
+	inline unsigned int getDownloading() const { return mResolving.size(); }
+
+	// the game whose search was started last, NULL if none
+	inline const FileData* getLastStarted() const { return mLastStarted; }
+
+private:
+	static const int MAX_ATTEMPTS = 3;
+	static const unsigned int RETRY_DELAY = 2000; // ms, doubled on every attempt
+	static const unsigned int BATCH_SIZE = 16;
+	static const unsigned int MIN_COMMIT_INTERVAL = 2000; // ms
+	static const unsigned int OFFLINE_SEARCHES = 256; // per frame, the local database scraper is not throttled
+
+	struct Job
+	{
+		ScraperSearchParams params;
+		int attempts;
+		unsigned int retryAt;
+
+		bool hasResult;
+		ScraperSearchResult result;
+
+		std::unique_ptr<ScraperSearchHandle> search;
+		std::unique_ptr<MDResolveHandle> resolve;
+	};
+
+	struct TokenBucket
+	{
+		float tokens;
+		unsigned int lastRefill;
+	};
+
+	void startJobs();
+	void updateSearches();
+	void updateResolves();
+
+	void startResolve(std::unique_ptr<Job>& job);
+	void retry(std::unique_ptr<Job>& job, const std::string& error);
+	void complete(std::unique_ptr<Job>& job, bool success);
+
+	// writes finished results to the metadata, the gamelists and the progress file
+	void commit();
+
+	bool takeToken(const std::string& host);
+	static std::string getHost(const std::string& url);
+
+	static std::string getProgressPath();
+	void loadProgress();
+	std::string mRunKey; // first line of the progress file: the scraper and the systems scraped
+	bool mProgressMatches; // the progress file is ours, append to it
+
+	std::deque< std::unique_ptr<Job> > mPending;
+	std::multimap< unsigned int, std::unique_ptr<Job> > mRetries; // by retryAt, also downloads waiting for a slot
+	std::list< std::unique_ptr<Job> > mSearching;
+	std::list< std::unique_ptr<Job> > mResolving;
+	std::vector< std::unique_ptr<Job> > mCompleted;
+
+	std::set<std::string> mDoneGames;
+	std::map<std::string, TokenBucket> mBuckets;
+
+	std::string mSearchHost;
+	bool mOffline;
+	unsigned int mMaxSearches;
+	unsigned int mMaxDownloads;
+	float mRequestsPerSecond;
+
+	unsigned int mTotal;
+	unsigned int mSuccessful;
+	unsigned int mSkipped;
+	unsigned int mResumed;
+	const FileData* mLastStarted;
+	unsigned int mLastCommit;
+};
@@ -105,7 +105,7 @@ void thegamesdb_generate_scraper_requests(const ScraperSearchParams& params, std
 				path += "&platform=";
 				path += HttpReq::urlEncode(mapIt->second);
 			}else{
-				LOG(LogWarning) << "TheGamesDB scraper warning - no support for platform " << getPlatformName(*platformIt);
+				LOG_SUB(LogScraper, LogWarning) << "TheGamesDB scraper warning - no support for platform " << getPlatformName(*platformIt);
 			}
 
 			requests.push(std::unique_ptr<ScraperRequest>(new TheGamesDBRequest(results, path)));
@@ -125,7 +125,7 @@ void TheGamesDBRequest::process(const std::unique_ptr<HttpReq>& req, std::vector
 		ss << "GamesDBRequest - Error parsing XML. \n\t" << parseResult.description() << "";
 		std::string err = ss.str();
 		setError(err);
-		LOG(LogError) << err;
+		LOG_SUB(LogScraper, LogError) << err;
 		return;
 	}
 
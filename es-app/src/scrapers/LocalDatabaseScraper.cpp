@@ -0,0 +1,392 @@
+#include "scrapers/LocalDatabaseScraper.h"
+#include "Log.h"
+#include "Settings.h"
+#include "platform.h"
+#include "pugixml/pugixml.hpp"
+#include <boost/crc.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <algorithm>
+#include <cstring>
+
+namespace fs = boost::filesystem;
+
+// order of the strings stored for every record
+enum RecordField
+{
+	FIELD_NAME,
+	FIELD_DESC,
+	FIELD_GENRE,
+	FIELD_DEVELOPER,
+	FIELD_PUBLISHER,
+	FIELD_PLAYERS,
+	FIELD_RELEASEDATE,
+	FIELD_IMAGE,
+	FIELD_COUNT
+};
+
+static const char* const fieldNames[FIELD_COUNT] = { "name", "desc", "genre", "developer", "publisher", "players", "releasedate", "image" };
+
+static const char INDEX_MAGIC[4] = { 'E', 'S', 'D', 'B' };
+static const uint32_t INDEX_VERSION = 1;
+
+void localdatabase_generate_scraper_requests(const ScraperSearchParams& params, std::queue< std::unique_ptr<ScraperRequest> >& requests,
+	std::vector<ScraperSearchResult>& results)
+{
+	ScraperSearchResult result;
+	if(LocalDatabase::getInstance()->find(params.game, result))
+		results.push_back(result);
+}
+
+static bool parseMd5(const std::string& hex, unsigned char* md5)
+{
+	if(hex.size() != 32)
+		return false;
+
+	for(int i = 0; i < 16; i++)
+	{
+		char byte[3] = { hex[i * 2], hex[i * 2 + 1], 0 };
+		char* end;
+		md5[i] = (unsigned char)strtoul(byte, &end, 16);
+		if(*end != '\0')
+			return false;
+	}
+
+	return true;
+}
+
+static bool parseCrc(const std::string& hex, uint32_t& crc)
+{
+	if(hex.empty() || hex.size() > 8)
+		return false;
+
+	char* end;
+	crc = (uint32_t)strtoul(hex.c_str(), &end, 16);
+	return *end == '\0';
+}
+
+// collects games while importing, the strings of a game are shared by all of its roms
+class IndexBuilder
+{
+public:
+	IndexBuilder() : mGameOffset(0) {}
+
+	void beginGame(const std::string* fields)
+	{
+		mGameOffset = (uint32_t)mBlob.size();
+		for(int i = 0; i < FIELD_COUNT; i++)
+			mBlob.insert(mBlob.end(), fields[i].c_str(), fields[i].c_str() + fields[i].size() + 1);
+	}
+
+	void addRom(const std::string& md5, const std::string& crc)
+	{
+		Record record;
+		memset(&record, 0, sizeof(record));
+		record.offset = mGameOffset;
+
+		const bool hasMd5 = parseMd5(md5, record.md5);
+		if(!hasMd5)
+			memset(record.md5, 0, sizeof(record.md5));
+
+		if(!parseCrc(crc, record.crc))
+			record.crc = 0;
+
+		if(hasMd5 || record.crc != 0)
+			mRecords.push_back(record);
+	}
+
+	size_t size() const { return mRecords.size(); }
+
+	bool write(const std::string& path)
+	{
+		std::sort(mRecords.begin(), mRecords.end(), [](const Record& a, const Record& b) { return memcmp(a.md5, b.md5, 16) < 0; });
+
+		// write to a temporary file first so an interrupted import can't leave a broken index
+		const std::string tmpPath = path + ".tmp";
+		std::ofstream file(tmpPath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+
+		const uint32_t count = (uint32_t)mRecords.size();
+		file.write(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+		file.write((const char*)&INDEX_VERSION, sizeof(INDEX_VERSION));
+		file.write((const char*)&count, sizeof(count));
+		if(count > 0)
+			file.write((const char*)mRecords.data(), count * sizeof(Record));
+		if(!mBlob.empty())
+			file.write(mBlob.data(), mBlob.size());
+		file.close();
+
+		if(file.fail())
+			return false;
+
+		boost::system::error_code ec;
+		fs::rename(tmpPath, path, ec);
+		return !ec;
+	}
+
+private:
+	struct Record
+	{
+		unsigned char md5[16];
+		uint32_t crc;
+		uint32_t offset;
+	};
+
+	std::vector<Record> mRecords;
+	std::vector<char> mBlob;
+	uint32_t mGameOffset;
+};
+
+static void importLogiqx(const pugi::xml_node& datafile, IndexBuilder& builder)
+{
+	for(pugi::xml_node game = datafile.first_child(); game; game = game.next_sibling())
+	{
+		if(strcmp(game.name(), "game") != 0 && strcmp(game.name(), "machine") != 0)
+			continue;
+
+		std::string fields[FIELD_COUNT];
+		fields[FIELD_NAME] = game.child("description") ? game.child("description").text().get() : game.attribute("name").as_string();
+		fields[FIELD_GENRE] = game.child("genre").text().get();
+		fields[FIELD_DEVELOPER] = game.child("manufacturer").text().get();
+
+		const std::string year = game.child("year").text().get();
+		if(year.size() == 4)
+			fields[FIELD_RELEASEDATE] = year + "0101T000000";
+
+		builder.beginGame(fields);
+		for(pugi::xml_node rom = game.child("rom"); rom; rom = rom.next_sibling("rom"))
+			builder.addRom(rom.attribute("md5").as_string(), rom.attribute("crc").as_string());
+	}
+}
+
+static void importXml(const pugi::xml_node& root, IndexBuilder& builder)
+{
+	for(pugi::xml_node game = root.child("game"); game; game = game.next_sibling("game"))
+	{
+		std::string fields[FIELD_COUNT];
+		for(int i = 0; i < FIELD_COUNT; i++)
+			fields[i] = game.child(fieldNames[i]).text().get();
+
+		builder.beginGame(fields);
+		builder.addRom(game.child("md5") ? game.child("md5").text().get() : game.child("hash").text().get(), game.child("crc").text().get());
+	}
+}
+
+static void importJson(const boost::property_tree::ptree& root, IndexBuilder& builder)
+{
+	const boost::property_tree::ptree& games = root.get_child("games", root);
+	for(auto it = games.begin(); it != games.end(); it++)
+	{
+		const boost::property_tree::ptree& game = it->second;
+
+		std::string fields[FIELD_COUNT];
+		for(int i = 0; i < FIELD_COUNT; i++)
+			fields[i] = game.get<std::string>(fieldNames[i], "");
+
+		builder.beginGame(fields);
+		builder.addRom(game.get<std::string>("md5", game.get<std::string>("hash", "")), game.get<std::string>("crc", ""));
+	}
+}
+
+bool LocalDatabase::import(const std::string& source, const std::string& index, std::string& error)
+{
+	IndexBuilder builder;
+
+	if(fs::path(source).extension() == ".json")
+	{
+		try
+		{
+			boost::property_tree::ptree root;
+			boost::property_tree::read_json(source, root);
+			importJson(root, builder);
+		}catch(const std::exception& e)
+		{
+			error = e.what();
+			return false;
+		}
+	}else{
+		pugi::xml_document doc;
+		pugi::xml_parse_result parseResult = doc.load_file(source.c_str());
+		if(!parseResult)
+		{
+			error = parseResult.description();
+			return false;
+		}
+
+		pugi::xml_node root = doc.document_element();
+		if(strcmp(root.name(), "datafile") == 0)
+			importLogiqx(root, builder);
+		else
+			importXml(root, builder);
+	}
+
+	if(!builder.write(index))
+	{
+		error = "could not write " + index;
+		return false;
+	}
+
+	LOG_SUB(LogScraper, LogInfo) << "LocalDatabase: imported " << builder.size() << " roms from " << source;
+	return true;
+}
+
+LocalDatabase* LocalDatabase::sInstance = NULL;
+
+LocalDatabase* LocalDatabase::getInstance()
+{
+	if(sInstance == NULL)
+		sInstance = new LocalDatabase();
+
+	return sInstance;
+}
+
+LocalDatabase::LocalDatabase() : mTriedOpen(false), mBlobStart(0)
+{
+}
+
+std::string LocalDatabase::getSourcePath()
+{
+	std::string path = Settings::getInstance()->getString("ScraperDatabase");
+	if(path.empty())
+		path = getHomePath() + "/.emulationstation/scraper_db.xml";
+
+	return path;
+}
+
+bool LocalDatabase::open()
+{
+	mTriedOpen = true;
+
+	const std::string source = getSourcePath();
+	const std::string index = fs::path(source).replace_extension(".idx").string();
+	mSourceDir = fs::path(source).parent_path().string();
+
+	boost::system::error_code ec;
+	const bool hasSource = fs::exists(source, ec);
+	if(!fs::exists(index, ec) || (hasSource && fs::last_write_time(source, ec) > fs::last_write_time(index, ec)))
+	{
+		if(!hasSource)
+		{
+			LOG_SUB(LogScraper, LogWarning) << "LocalDatabase: no database at " << source;
+			return false;
+		}
+
+		std::string error;
+		if(!import(source, index, error))
+		{
+			LOG_SUB(LogScraper, LogError) << "LocalDatabase: could not import " << source << ": " << error;
+			return false;
+		}
+	}
+
+	mFile.open(index, std::ios_base::in | std::ios_base::binary);
+
+	char magic[sizeof(INDEX_MAGIC)];
+	uint32_t version = 0;
+	uint32_t count = 0;
+	mFile.read(magic, sizeof(magic));
+	mFile.read((char*)&version, sizeof(version));
+	mFile.read((char*)&count, sizeof(count));
+	if(!mFile || memcmp(magic, INDEX_MAGIC, sizeof(magic)) != 0 || version != INDEX_VERSION)
+	{
+		LOG_SUB(LogScraper, LogError) << "LocalDatabase: " << index << " is not a valid index, delete it to rebuild it";
+		mFile.close();
+		return false;
+	}
+
+	mRecords.resize(count);
+	if(count > 0)
+		mFile.read((char*)mRecords.data(), count * sizeof(IndexRecord));
+	mBlobStart = mFile.tellg();
+
+	for(uint32_t i = 0; i < count; i++)
+	{
+		if(mRecords[i].crc != 0)
+			mByCrc.push_back(i);
+	}
+	std::sort(mByCrc.begin(), mByCrc.end(), [this](uint32_t a, uint32_t b) { return mRecords[a].crc < mRecords[b].crc; });
+
+	return (bool)mFile;
+}
+
+bool LocalDatabase::find(FileData* game, ScraperSearchResult& result)
+{
+	return find(game->metadata.get("hash"), game->getPath().string(), result);
+}
+
+bool LocalDatabase::find(const std::string& md5, const std::string& romPath, ScraperSearchResult& result)
+{
+	if(!mTriedOpen)
+		open();
+
+	if(mRecords.empty())
+		return false;
+
+	IndexRecord key;
+	if(parseMd5(md5, key.md5))
+	{
+		auto it = std::lower_bound(mRecords.begin(), mRecords.end(), key,
+			[](const IndexRecord& a, const IndexRecord& b) { return memcmp(a.md5, b.md5, 16) < 0; });
+
+		if(it != mRecords.end() && memcmp(it->md5, key.md5, 16) == 0)
+			return readRecord(*it, result);
+	}
+
+	if(mByCrc.empty())
+		return false;
+
+	// CRC only dumps, this costs another read of the rom
+	std::ifstream rom(romPath, std::ios_base::in | std::ios_base::binary);
+	if(!rom)
+		return false;
+
+	boost::crc_32_type crc;
+	char buffer[64 * 1024];
+	while(rom.read(buffer, sizeof(buffer)) || rom.gcount() > 0)
+		crc.process_bytes(buffer, rom.gcount());
+
+	const uint32_t checksum = crc.checksum();
+	auto it = std::lower_bound(mByCrc.begin(), mByCrc.end(), checksum,
+		[this](uint32_t index, uint32_t value) { return mRecords[index].crc < value; });
+
+	if(it != mByCrc.end() && mRecords[*it].crc == checksum)
+		return readRecord(mRecords[*it], result);
+
+	return false;
+}
+
+bool LocalDatabase::readRecord(const IndexRecord& record, ScraperSearchResult& result)
+{
+	mFile.clear();
+	mFile.seekg(mBlobStart + (std::streamoff)record.offset);
+
+	std::string fields[FIELD_COUNT];
+	for(int i = 0; i < FIELD_COUNT; i++)
+		std::getline(mFile, fields[i], '\0');
+
+	if(!mFile)
+		return false;
+
+	// only set what the dump knows about, empty values would overwrite the defaults when merged
+	for(int i = 0; i < FIELD_IMAGE; i++)
+	{
+		if(!fields[i].empty())
+			result.mdl.set(fieldNames[i], fields[i]);
+	}
+
+	const std::string& image = fields[FIELD_IMAGE];
+	if(image.compare(0, 7, "http://") == 0 || image.compare(0, 8, "https://") == 0)
+	{
+		result.imageUrl = image;
+	}else if(!image.empty())
+	{
+		fs::path imagePath(image);
+		if(imagePath.is_relative())
+			imagePath = fs::path(mSourceDir) / imagePath;
+
+		if(fs::exists(imagePath))
+			result.mdl.set("image", imagePath.generic_string());
+	}
+
+	return true;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "scrapers/Scraper.h"
+#include <fstream>
+#include <stdint.h>
+
+#define LOCAL_DATABASE_SCRAPER "Local database"
+
+// Offline scraper: matches games by the MD5 (or CRC32) of their rom against a local metadata dump.
+// Searches complete immediately, no ScraperRequest is queued.
+void localdatabase_generate_scraper_requests(const ScraperSearchParams& params, std::queue< std::unique_ptr<ScraperRequest> >& requests,
+	std::vector<ScraperSearchResult>& results);
+
+// The dump (setting ScraperDatabase, ~/.emulationstation/scraper_db.xml by default) can be:
+//  - a Logiqx XML DAT (No-Intro, Redump...): <datafile><game name=".."><rom md5=".." crc=".."/></game></datafile>
+//  - a gamelist-like XML export: <gameList><game><md5/><crc/><name/><desc/><genre/><developer/><publisher/><players/><releasedate/><image/></game></gameList>
+//  - the same fields as a JSON array of objects (or an object with a "games" array)
+// It is imported once into a compact index next to it (.idx), rebuilt whenever the dump is newer.
+// Relative image paths are relative to the dump, http(s) images are downloaded like any other scraped image.
+class LocalDatabase
+{
+public:
+	static LocalDatabase* getInstance();
+
+	// false if there is no usable database
+	bool find(FileData* game, ScraperSearchResult& result);
+	// by the MD5 in hex (may be empty), falling back to the CRC32 of the rom at romPath
+	bool find(const std::string& md5, const std::string& romPath, ScraperSearchResult& result);
+
+	// (re)builds the index from a dump, returns false and fills error on failure
+	static bool import(const std::string& source, const std::string& index, std::string& error);
+
+private:
+	LocalDatabase();
+
+	static LocalDatabase* sInstance;
+
+	struct IndexRecord
+	{
+		unsigned char md5[16]; // all zeroes for CRC only entries
+		uint32_t crc;
+		uint32_t offset; // of the record's strings, from the start of the string blob
+	};
+
+	bool open();
+	bool readRecord(const IndexRecord& record, ScraperSearchResult& result);
+
+	static std::string getSourcePath();
+
+	bool mTriedOpen;
+	std::string mSourceDir;
+	std::ifstream mFile;
+	std::streamoff mBlobStart;
+
+	std::vector<IndexRecord> mRecords; // sorted by md5
+	std::vector<uint32_t> mByCrc; // indexes into mRecords, sorted by crc
+};
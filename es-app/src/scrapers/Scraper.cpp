@@ -1,16 +1,20 @@
 #include "scrapers/Scraper.h"
 #include "Log.h"
 #include "Settings.h"
+#include "ImageIO.h"
+#include "ThreadPool.h"
 #include <FreeImage.h>
 #include <boost/filesystem.hpp>
 #include <boost/assign.hpp>
 
 #include "GamesDBScraper.h"
 #include "ScreenscraperScraper.h"
+#include "LocalDatabaseScraper.h"
 
 const std::map<std::string, generate_scraper_requests_func> scraper_request_funcs = boost::assign::map_list_of
 	("TheGamesDB", &thegamesdb_generate_scraper_requests)
-	("Screenscraper", &screenscraper_generate_scraper_requests);
+	("Screenscraper", &screenscraper_generate_scraper_requests)
+	(LOCAL_DATABASE_SCRAPER, &localdatabase_generate_scraper_requests);
 
 std::unique_ptr<ScraperSearchHandle> startScraperSearch(const ScraperSearchParams& params)
 {
@@ -109,7 +113,7 @@ void ScraperHttpRequest::update()
 		return;
 
 	// everything else is some sort of error
-	LOG(LogError) << "ScraperHttpRequest network error (status: " << status << ") - " << mReq->getErrorMsg();
+	LOG_SUB(LogScraper, LogError) << "ScraperHttpRequest network error (status: " << status << ") - " << mReq->getErrorMsg();
 	setError(mReq->getErrorMsg());
 }
 
@@ -166,12 +170,24 @@ std::unique_ptr<ImageDownloadHandle> downloadImageAsync(const std::string& url,
 }
 
 ImageDownloadHandle::ImageDownloadHandle(const std::string& url, const std::string& path, int maxWidth, int maxHeight) :
-	mSavePath(path), mMaxWidth(maxWidth), mMaxHeight(maxHeight), mReq(new HttpReq(url))
+	mSavePath(path), mMaxWidth(maxWidth), mMaxHeight(maxHeight),
+	// without resizing the image goes straight to disk, otherwise it stays in memory until resized
+	mReq((maxWidth == 0 && maxHeight == 0) ? new HttpReq(url, path) : new HttpReq(url))
 {
 }
 
 void ImageDownloadHandle::update()
 {
+	if(mResizeJob)
+	{
+		const int status = mResizeJob->status.load(std::memory_order_acquire);
+		if(status == ASYNC_ERROR)
+			setError(mResizeJob->error);
+		else if(status == ASYNC_DONE)
+			setStatus(ASYNC_DONE);
+		return;
+	}
+
 	if(mReq->status() == HttpReq::REQ_IN_PROGRESS)
 		return;
 
@@ -183,31 +199,97 @@ void ImageDownloadHandle::update()
 		return;
 	}
 
-	// download is done, save it to disk
-	std::ofstream stream(mSavePath, std::ios_base::out | std::ios_base::binary);
-	if(stream.bad())
+	// the image has been written to mSavePath by the network thread
+	if(mMaxWidth == 0 && mMaxHeight == 0)
 	{
-		setError("Failed to open image path to write. Permission error? Disk full?");
+		setStatus(ASYNC_DONE);
 		return;
 	}
 
-	const std::string& content = mReq->getContent();
-	stream.write(content.data(), content.length());
-	stream.close();
-	if(stream.bad())
+	// decode, resize and save on a worker, the job outlives us if we get destroyed in the meantime
+	std::shared_ptr<ImageResizeJob> job = std::make_shared<ImageResizeJob>();
+	std::shared_ptr< std::vector<char> > content = std::make_shared< std::vector<char> >(mReq->takeContent());
+	const std::string path = mSavePath;
+	const int maxWidth = mMaxWidth;
+	const int maxHeight = mMaxHeight;
+	mReq.reset();
+
+	mResizeJob = job;
+	ThreadPool::getInstance()->post([job, content, path, maxWidth, maxHeight]
 	{
-		setError("Failed to save image. Disk full?");
-		return;
+		if(resizeImageFromMemory(*content, path, maxWidth, maxHeight))
+		{
+			job->status.store(ASYNC_DONE, std::memory_order_release);
+		}else{
+			job->error = "Error saving resized image. Out of memory? Disk full?";
+			job->status.store(ASYNC_ERROR, std::memory_order_release);
+		}
+	});
+}
+
+// FreeImage_Rescale is a generic (and slow) filter, 24 and 32 bit images go through our own bilinear kernel
+static FIBITMAP* rescaleBitmap(FIBITMAP* image, int width, int height)
+{
+	const unsigned int bpp = FreeImage_GetBPP(image);
+	if(bpp != 24 && bpp != 32)
+		return FreeImage_Rescale(image, width, height, FILTER_BILINEAR);
+
+	FIBITMAP* source = (bpp == 32) ? image : FreeImage_ConvertTo32Bits(image);
+	if(source == NULL)
+		return NULL;
+
+	FIBITMAP* rescaled = FreeImage_Allocate(width, height, 32);
+	if(rescaled != NULL)
+	{
+		ImageIO::resizeBilinear32(FreeImage_GetBits(source), FreeImage_GetWidth(source), FreeImage_GetHeight(source), FreeImage_GetPitch(source),
+			FreeImage_GetBits(rescaled), width, height, FreeImage_GetPitch(rescaled));
 	}
 
-	// resize it
-	if(!resizeImage(mSavePath, mMaxWidth, mMaxHeight))
+	if(source != image)
+		FreeImage_Unload(source);
+
+	// keep the original depth, JPEG can't hold 32 bit anyway
+	if(rescaled != NULL && bpp == 24)
 	{
-		setError("Error saving resized image. Out of memory? Disk full?");
-		return;
+		FIBITMAP* converted = FreeImage_ConvertTo24Bits(rescaled);
+		FreeImage_Unload(rescaled);
+		rescaled = converted;
 	}
 
-	setStatus(ASYNC_DONE);
+	return rescaled;
+}
+
+// takes ownership of image
+static bool resizeAndSave(FIBITMAP* image, FREE_IMAGE_FORMAT format, const std::string& path, int maxWidth, int maxHeight)
+{
+	float width = (float)FreeImage_GetWidth(image);
+	float height = (float)FreeImage_GetHeight(image);
+
+	if(maxWidth == 0)
+	{
+		maxWidth = (int)((maxHeight / height) * width);
+	}else if(maxHeight == 0)
+	{
+		maxHeight = (int)((maxWidth / width) * height);
+	}
+
+	FIBITMAP* imageRescaled = rescaleBitmap(image, maxWidth, maxHeight);
+	FreeImage_Unload(image);
+
+	if(imageRescaled == NULL)
+	{
+		LOG_SUB(LogScraper, LogError) << "Could not resize image! (not enough memory? invalid bitdepth?)";
+		return false;
+	}
+
+	bool saved = FreeImage_Save(format, imageRescaled, path.c_str());
+	FreeImage_Unload(imageRescaled);
+
+    if(!saved) {
+		LOG_SUB(LogScraper, LogError) << "Failed to save resized image!";
+    }
+
+	return saved;
 }
 
 //you can pass 0 for width or height to keep aspect ratio
@@ -226,7 +308,7 @@ bool resizeImage(const std::string& path, int maxWidth, int maxHeight)
 		format = FreeImage_GetFIFFromFilename(path.c_str());
 	if(format == FIF_UNKNOWN)
 	{
-		LOG(LogError) << "Error - could not detect filetype for image \"" << path << "\"!";
+		LOG_SUB(LogScraper, LogError) << "Error - could not detect filetype for image \"" << path << "\"!";
 		return false;
 	}
 
@@ -235,38 +317,53 @@ bool resizeImage(const std::string& path, int maxWidth, int maxHeight)
 	{
 		image = FreeImage_Load(format, path.c_str());
 	}else{
-		LOG(LogError) << "Error - file format reading not supported for image \"" << path << "\"!";
+		LOG_SUB(LogScraper, LogError) << "Error - file format reading not supported for image \"" << path << "\"!";
 		return false;
 	}
 
-	float width = (float)FreeImage_GetWidth(image);
-	float height = (float)FreeImage_GetHeight(image);
-
-	if(maxWidth == 0)
-	{
-		maxWidth = (int)((maxHeight / height) * width);
-	}else if(maxHeight == 0)
+	if(image == NULL)
 	{
-		maxHeight = (int)((maxWidth / width) * height);
+		LOG_SUB(LogScraper, LogError) << "Error - could not load image \"" << path << "\"!";
+		return false;
 	}
 
-	FIBITMAP* imageRescaled = FreeImage_Rescale(image, maxWidth, maxHeight, FILTER_BILINEAR);
-	FreeImage_Unload(image);
+	return resizeAndSave(image, format, path, maxWidth, maxHeight);
+}
 
-	if(imageRescaled == NULL)
+bool resizeImageFromMemory(const std::vector<char>& data, const std::string& path, int maxWidth, int maxHeight)
+{
+	FIMEMORY* memory = FreeImage_OpenMemory((BYTE*)data.data(), data.size());
+	if(memory == NULL)
+		return false;
+
+	FREE_IMAGE_FORMAT format = FreeImage_GetFileTypeFromMemory(memory, 0);
+	if(format == FIF_UNKNOWN)
+		format = FreeImage_GetFIFFromFilename(path.c_str());
+	if(format == FIF_UNKNOWN || !FreeImage_FIFSupportsReading(format))
 	{
-		LOG(LogError) << "Could not resize image! (not enough memory? invalid bitdepth?)";
+		LOG_SUB(LogScraper, LogError) << "Error - could not detect filetype for image \"" << path << "\"!";
+		FreeImage_CloseMemory(memory);
 		return false;
 	}
 
-	bool saved = FreeImage_Save(format, imageRescaled, path.c_str());
-	FreeImage_Unload(imageRescaled);
+	FIBITMAP* image = FreeImage_LoadFromMemory(format, memory);
+	FreeImage_CloseMemory(memory);
 
-    if(!saved) {
-		LOG(LogError) << "Failed to save resized image!";
-    }
+	if(image == NULL)
+	{
+		LOG_SUB(LogScraper, LogError) << "Error - could not decode image \"" << path << "\"!";
+		return false;
+	}
 
-	return saved;
+	// nothing to resize, but still needs to be written
+	if(maxWidth == 0 && maxHeight == 0)
+	{
+		bool saved = FreeImage_Save(format, image, path.c_str());
+		FreeImage_Unload(image);
+		return saved;
+	}
+
+	return resizeAndSave(image, format, path, maxWidth, maxHeight);
 }
 
 std::string getSaveAsPath(const ScraperSearchParams& params, const std::string& suffix, const std::string& url)
@@ -7,6 +7,7 @@
 #include <vector>
 #include <functional>
 #include <queue>
+#include <atomic>
 
 #define MAX_SCRAPER_RESULTS 7
 
@@ -126,6 +127,16 @@ private:
 	std::vector<ResolvePair> mFuncs;
 };
 
+// Outcome of a resize running on the ThreadPool.
+// status is an AsyncHandleStatus, error must not be read while it is ASYNC_IN_PROGRESS.
+struct ImageResizeJob
+{
+	ImageResizeJob() : status(ASYNC_IN_PROGRESS) {};
+
+	std::atomic<int> status;
+	std::string error;
+};
+
 class ImageDownloadHandle : public AsyncHandle
 {
 public:
@@ -138,6 +149,9 @@ private:
 	std::string mSavePath;
 	int mMaxWidth;
 	int mMaxHeight;
+
+	// set once the downloaded image has been handed to the ThreadPool to be resized
+	std::shared_ptr<ImageResizeJob> mResizeJob;
 };
 
 //About the same as "~/.emulationstation/downloaded_images/[system_name]/[game_name].[url's extension]".
@@ -154,3 +168,7 @@ std::unique_ptr<MDResolveHandle> resolveMetaDataAssets(const ScraperSearchResult
 //Will overwrite the image at [path] with the new resized one.
 //Returns true if successful, false otherwise.
 bool resizeImage(const std::string& path, int maxWidth, int maxHeight);
+
+//Same as resizeImage, but decodes the image from memory and writes the resized one to [path].
+//Blocks, meant to run on a worker thread.
+bool resizeImageFromMemory(const std::vector<char>& data, const std::string& path, int maxWidth, int maxHeight);
@@ -118,7 +118,7 @@ void screenscraper_generate_scraper_requests(const ScraperSearchParams& params,
 				path += "&platform=";
 				path += HttpReq::urlEncode(mapIt->second);
 			}else{
-				LOG(LogWarning) << "Screenscraper scraper warning - no support for platform " << getPlatformName(*platformIt);
+				LOG_SUB(LogScraper, LogWarning) << "Screenscraper scraper warning - no support for platform " << getPlatformName(*platformIt);
 			}
 
 			requests.push(std::unique_ptr<ScraperRequest>(new ScreenscraperRequest(results, path)));
@@ -138,7 +138,7 @@ void ScreenscraperRequest::process(const std::unique_ptr<HttpReq>& req, std::vec
 		ss << "ScreenscraperRequest - Error parsing XML. \n\t" << parseResult.description() << "";
 		std::string err = ss.str();
 		setError(err);
-		LOG(LogError) << err;
+		LOG_SUB(LogScraper, LogError) << err;
 		return;
 	}
 
@@ -30,6 +30,7 @@ SystemView::SystemView(Window* window) : IList<SystemViewData, SystemData*>(wind
 	mCamOffset = 0;
 	mExtrasCamOffset = 0;
 	mExtrasFadeOpacity = 0.0f;
+	lastSystem = NULL;
 
 	setSize((float)Renderer::getScreenWidth(), (float)Renderer::getScreenHeight());
 
@@ -170,7 +171,14 @@ void SystemView::onCursorChanged(const CursorState& state)
 	if(lastSystem != getSelected()){
 		lastSystem = getSelected();
 		AudioManager::getInstance()->themeChanged(getSelected()->getTheme());
+
+		// one of the neighbours is likely next, have their music ready
+		AudioManager::getInstance()->preload(getSelected()->getNext()->getTheme());
+		AudioManager::getInstance()->preload(getSelected()->getPrev()->getTheme());
 	}
+
+	// start scanning the highlighted system so it's ready when selected
+	getSelected()->loadAsync();
 	// update help style
 	updateHelpPrompts();
 
@@ -33,7 +33,7 @@ void ViewController::init(Window* window)
 }
 
 ViewController::ViewController(Window* window)
-	: GuiComponent(window), mCurrentView(nullptr), mCamera(Eigen::Affine3f::Identity()), mFadeOpacity(0), mLockInput(false)
+	: GuiComponent(window), mCurrentView(nullptr), mCamera(Eigen::Affine3f::Identity()), mFadeOpacity(0), mLockInput(false), mReleaseTimer(0)
 {
 	mState.viewing = NOTHING;
 	mFavoritesOnly = Settings::getInstance()->getBool("FavoritesOnly");
@@ -80,7 +80,7 @@ void ViewController::goToNextGameList()
 	SystemData* system = getState().getSystem();
 	assert(system);
 	SystemData* next = system->getNext();
-	while(next->getRootFolder()->getChildren().size() == 0) {
+	while(next->getGameCount() == 0) {
 		next = next->getNext();
 	}
 	AudioManager::getInstance()->themeChanged(system->getNext()->getTheme());
@@ -94,7 +94,7 @@ void ViewController::goToPrevGameList()
 	SystemData* system = getState().getSystem();
 	assert(system);
 	SystemData* prev = system->getPrev();
-	while(prev->getRootFolder()->getChildren().size() == 0) {
+	while(prev->getGameCount() == 0) {
 		prev = prev->getPrev();
 	}
 	AudioManager::getInstance()->themeChanged(prev->getTheme());
@@ -103,6 +103,9 @@ void ViewController::goToPrevGameList()
 
 void ViewController::goToGameList(SystemData* system)
 {
+	// wait for a lazy system still being scanned in the background
+	system->ensureLoaded();
+
 	if(mState.viewing == SYSTEM_SELECT)
 	{
 		// move system list
@@ -289,16 +292,17 @@ std::shared_ptr<IGameListView> ViewController::getGameListView(SystemData* syste
 		return exists->second;
 
 	//if we didn't, make it, remember it, and return it
+	system->ensureLoaded();
 	std::shared_ptr<IGameListView> view;
 
-	if(system->hasAnyThumbnails())
+	const std::string viewStyle = Settings::getInstance()->getString("GamelistViewStyle");
+	if(viewStyle == "grid")
+		view = std::shared_ptr<IGameListView>(new GridGameListView(mWindow, system->getRootFolder()));
+	else if(viewStyle == "detailed" || (viewStyle != "basic" && system->hasAnyThumbnails()))
 		view = std::shared_ptr<IGameListView>(new DetailedGameListView(mWindow, system->getRootFolder(), system));
 	else
 		view = std::shared_ptr<IGameListView>(new BasicGameListView(mWindow, system->getRootFolder()));
 
-	// uncomment for experimental "image grid" view
-	//view = std::shared_ptr<IGameListView>(new GridGameListView(mWindow, system->getRootFolder()));
-
 	view->setTheme(system->getTheme());
 
 	std::vector<SystemData*>& sysVec = SystemData::sSystemVector;
@@ -359,6 +363,27 @@ void ViewController::update(int deltaTime)
 		mCurrentView->update(deltaTime);
 	}
 
+	// every few seconds, free the games of lazily loaded systems nobody looked at for a while
+	mReleaseTimer += deltaTime;
+	if(mReleaseTimer >= RELEASE_CHECK_INTERVAL)
+	{
+		mReleaseTimer = 0;
+
+		SystemData* current = NULL;
+		if(mState.viewing == GAME_LIST || mState.viewing == SYSTEM_SELECT)
+		{
+			current = mState.getSystem();
+			current->touch();
+		}
+
+		std::vector<SystemData*> released = SystemData::releaseIdleSystems(current);
+		for(auto it = released.begin(); it != released.end(); it++)
+		{
+			mGameListViews.erase(*it);
+			mInvalidGameList.erase(*it);
+		}
+	}
+
 	updateSelf(deltaTime);
 }
 
@@ -432,6 +457,13 @@ void ViewController::reloadGameListView(IGameListView* view, bool reloadTheme)
 	}
 }
 
+void ViewController::reloadExistingGameListView(SystemData* system, bool reloadTheme)
+{
+	auto exists = mGameListViews.find(system);
+	if(exists != mGameListViews.end())
+		reloadGameListView(exists->second.get(), reloadTheme);
+}
+
 void ViewController::reloadAll()
 {
 	std::map<SystemData*, FileData*> cursorMap;
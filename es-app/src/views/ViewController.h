@@ -22,6 +22,8 @@ public:
 	// the current gamelist view (as it may change to be detailed).
 	void reloadGameListView(IGameListView* gamelist, bool reloadTheme = false);
 	inline void reloadGameListView(SystemData* system, bool reloadTheme = false) { reloadGameListView(getGameListView(system).get(), reloadTheme); }
+	// does nothing if the system has no view yet, so a lazy system isn't loaded for it
+	void reloadExistingGameListView(SystemData* system, bool reloadTheme = false);
 	void reloadAll(); // Reload everything with a theme.  Used when the "ThemeSet" setting changes.
 	void reloadGamesLists();
 	void setInvalidGamesList(SystemData* system);
@@ -92,6 +94,9 @@ private:
 	bool mLockInput;
 	bool mFavoritesOnly;
 
+	static const int RELEASE_CHECK_INTERVAL = 5000; // ms
+	int mReleaseTimer;
+
 	State mState;
 
     int getFirstSystemIndex();
@@ -8,6 +8,10 @@
 #include "Locale.h"
 #include <boost/assign.hpp>
 
+// read for every file
+static Settings::Bool sShowHidden("ShowHidden");
+static Settings::Bool sFavoritesOnly("FavoritesOnly");
+
 BasicGameListView::BasicGameListView(Window* window, FileData* root)
 	: ISimpleGameListView(window, root), mList(window)
 {
@@ -27,15 +31,14 @@ void BasicGameListView::onThemeChanged(const std::shared_ptr<ThemeData>& theme)
 
 void BasicGameListView::onFileChanged(FileData* file, FileChangeType change)
 {
-	ISimpleGameListView::onFileChanged(file, change);
-
-	if(change == FILE_METADATA_CHANGED)
+	// a new thumbnail switches the system to a detailed view, that needs a new view
+	if(change == FILE_METADATA_CHANGED && !file->getThumbnailPath().empty() && getRoot()->getSystem()->hasAnyThumbnails())
 	{
-		// might switch to a detailed view
 		ViewController::get()->reloadGameListView(this);
 		return;
 	}
 
+	ISimpleGameListView::onFileChanged(file, change);
 }
 
 static const std::map<std::string, const char*> favorites_icons_map = boost::assign::map_list_of
@@ -93,116 +96,130 @@ static const std::map<std::string, const char*> favorites_icons_map = boost::ass
 		("wii", "\uF263 ")
 		("imageviewer", "\uF27b ");
 
-void BasicGameListView::populateList(const std::vector<FileData*>& files)
+// Each file gets up to two rows: one in the favorites block at the top of the list,
+// and one in the main list.
+void BasicGameListView::getRows(FileData* file, bool favoritesOnly, bool& favoriteRow, bool& row) const
 {
-	mList.clear();
+	const SystemData* systemData = getRoot()->getSystem();
+	const bool favorite = file->getType() != FOLDER && file->metadata.get("favorite").compare("true") == 0;
+	const bool hidden = file->metadata.get("hidden").compare("true") == 0;
 
-	const FileData* root = getRoot();
-	const SystemData* systemData = root->getSystem();
-	mHeaderText.setText(systemData ? systemData->getFullName() : root->getCleanName());
+	favoriteRow = favorite && (!sFavoritesOnly.get() || systemData->isFavorite());
 
-	bool favoritesOnly = false;
-	bool showHidden = Settings::getInstance()->getBool("ShowHidden");
+	// Do not show double names in favorite system.
+	row = !systemData->isFavorite() && (!hidden || sShowHidden.get())
+		&& (!favoritesOnly || (file->getType() == GAME && favorite));
+}
+
+// Labels of the rows from getRows, empty labels mean no row.
+void BasicGameListView::getLabels(FileData* file, bool favoritesOnly, std::string& favoriteLabel, std::string& label) const
+{
+	favoriteLabel.clear();
+	label.clear();
+
+	bool favoriteRow, row;
+	getRows(file, favoritesOnly, favoriteRow, row);
+	if(!favoriteRow && !row)
+		return;
 
-	if (Settings::getInstance()->getBool("FavoritesOnly") && !systemData->isFavorite())
+	const bool favorite = file->getType() != FOLDER && file->metadata.get("favorite").compare("true") == 0;
+	const bool hidden = file->metadata.get("hidden").compare("true") == 0;
+
+	std::string icon;
+	if(favorite)
 	{
-		for (auto it = files.begin(); it != files.end(); it++)
-		{
-			if ((*it)->getType() == GAME)
-			{
-				if ((*it)->metadata.get("favorite").compare("true") == 0)
-				{
-					favoritesOnly = true;
-					break;
-				}
-			}
-		}
+		auto iconIt = favorites_icons_map.find(file->getSystem()->getName());
+		icon = iconIt != favorites_icons_map.end() ? iconIt->second : "\uF006 "; // FIXME Folder as favorite ?
+		if(hidden)
+			icon += "\uF070 ";
+	}
+
+	if(favoriteRow)
+		favoriteLabel = icon + file->getName();
+
+	if(row)
+	{
+		if(favorite && !favoritesOnly)
+			label = icon + file->getName();
+		else
+			label = (hidden ? "\uF070 " : "") + file->getName();
+	}
+}
+
+bool BasicGameListView::isFavoritesOnly(const std::vector<FileData*>& files) const
+{
+	if (!sFavoritesOnly.get() || getRoot()->getSystem()->isFavorite())
+		return false;
+
+	for (auto it = files.begin(); it != files.end(); it++)
+	{
+		if ((*it)->getType() == GAME && (*it)->metadata.get("favorite").compare("true") == 0)
+			return true;
 	}
+	return false;
+}
+
+void BasicGameListView::buildEntries(const std::vector<FileData*>& files, std::vector<TextListComponent<FileData*>::Entry>& entries) const
+{
+	const bool favoritesOnly = isFavoritesOnly(files);
 
-	// The TextListComponent would be able to insert at a specific position,
-	// but the cost of this operation could be seriously huge.
-	// This naive implemention of doing a first pass in the list is used instead.
-	if(!Settings::getInstance()->getBool("FavoritesOnly") || systemData->isFavorite()){
-		for(auto it = files.begin(); it != files.end(); it++)
+	std::vector<std::string> labels(files.size());
+	std::string favoriteLabel;
+
+	TextListComponent<FileData*>::Entry entry;
+	for(unsigned int i = 0; i < files.size(); i++)
+	{
+		getLabels(files[i], favoritesOnly, favoriteLabel, labels[i]);
+		if(!favoriteLabel.empty())
 		{
-			if ((*it)->getType() != FOLDER && (*it)->metadata.get("favorite").compare("true") == 0) {
-				if ((*it)->metadata.get("hidden").compare("true") != 0) {
-					if((favorites_icons_map.find((*it)->getSystem()->getName())) != favorites_icons_map.end()) {
-						mList.add((favorites_icons_map.find((*it)->getSystem()->getName())->second) + (*it)->getName(), *it, ((*it)->getType() == FOLDER));
-					}else {
-						mList.add("\uF006 " + (*it)->getName(), *it, ((*it)->getType() == FOLDER)); // FIXME Folder as favorite ?
-					}
-				}else {
-					if((favorites_icons_map.find((*it)->getSystem()->getName())) != favorites_icons_map.end()) {
-						mList.add((favorites_icons_map.find((*it)->getSystem()->getName())->second) + std::string("\uF070 ") + (*it)->getName(), *it, ((*it)->getType() == FOLDER));
-					}else {
-						mList.add("\uF006 \uF070 " + (*it)->getName(), *it, ((*it)->getType() == FOLDER));
-					}
-				}
-			}
+			entry.name = favoriteLabel;
+			entry.object = files[i];
+			entry.data.colorId = (files[i]->getType() == FOLDER);
+			entries.push_back(entry);
 		}
 	}
 
-	// Do not show double names in favorite system.
-	if(!systemData->isFavorite())
+	for(unsigned int i = 0; i < files.size(); i++)
 	{
-		for (auto it = files.begin(); it != files.end(); it++) {
-			if (favoritesOnly) {
-				if ((*it)->getType() == GAME) {
-					if ((*it)->metadata.get("favorite").compare("true") == 0) {
-						if (!showHidden) {
-							if ((*it)->metadata.get("hidden").compare("true") != 0) {
-								mList.add((*it)->getName(), *it, ((*it)->getType() == FOLDER));
-							}
-						}
-						else {
-							if ((*it)->metadata.get("hidden").compare("true") == 0) {
-								mList.add("\uF070 " + (*it)->getName(), *it, ((*it)->getType() == FOLDER));
-							}else {
-								mList.add((*it)->getName(), *it, ((*it)->getType() == FOLDER));
-							}
-						}
-					}
-				}
-			}
-			else {
-				if (!showHidden) {
-					if ((*it)->metadata.get("hidden").compare("true") != 0) {
-						if ((*it)->getType() != FOLDER && (*it)->metadata.get("favorite").compare("true") == 0) {
-							if((favorites_icons_map.find((*it)->getSystem()->getName())) != favorites_icons_map.end()) {
-								mList.add((favorites_icons_map.find((*it)->getSystem()->getName())->second) + (*it)->getName(), *it, ((*it)->getType() == FOLDER));
-							}else {
-								mList.add("\uF006 " + (*it)->getName(), *it, ((*it)->getType() == FOLDER));
-							}
-						}else {
-							mList.add((*it)->getName(), *it, ((*it)->getType() == FOLDER));
-						}
-					}
-				}
-				else {
-					if ((*it)->getType() != FOLDER && (*it)->metadata.get("favorite").compare("true") == 0) {
-						if ((*it)->metadata.get("hidden").compare("true") != 0) {
-							if((favorites_icons_map.find((*it)->getSystem()->getName())) != favorites_icons_map.end()) {
-								mList.add((favorites_icons_map.find((*it)->getSystem()->getName())->second) + (*it)->getName(), *it, ((*it)->getType() == FOLDER));
-							}else {
-								mList.add("\uF006 " + (*it)->getName(), *it, ((*it)->getType() == FOLDER));
-							}
-						}else {
-							if((favorites_icons_map.find((*it)->getSystem()->getName())) != favorites_icons_map.end()) {
-								mList.add((favorites_icons_map.find((*it)->getSystem()->getName())->second) + std::string("\uF070 ") + (*it)->getName(), *it, ((*it)->getType() == FOLDER));
-							}else {
-								mList.add("\uF006 \uF070 " + (*it)->getName(), *it, ((*it)->getType() == FOLDER));
-							}
-						}
-					}else if ((*it)->metadata.get("hidden").compare("true") == 0) {
-						mList.add("\uF070 " + (*it)->getName(), *it, ((*it)->getType() == FOLDER));
-					}else {
-						mList.add((*it)->getName(), *it, ((*it)->getType() == FOLDER));
-					}
-				}
-			}
+		if(!labels[i].empty())
+		{
+			entry.name = labels[i];
+			entry.object = files[i];
+			entry.data.colorId = (files[i]->getType() == FOLDER);
+			entries.push_back(entry);
 		}
 	}
+}
+
+void BasicGameListView::populateList(const std::vector<FileData*>& files)
+{
+	mList.clear();
+
+	std::vector<TextListComponent<FileData*>::Entry> entries;
+	buildEntries(files, entries);
+	for(auto it = entries.begin(); it != entries.end(); it++)
+		mList.add(it->name, it->object, it->data.colorId);
+
+	onListChanged(files);
+}
+
+void BasicGameListView::refreshList(const std::vector<FileData*>& files)
+{
+	// rows whose file and label are unchanged keep their text cache
+	std::vector<TextListComponent<FileData*>::Entry> entries;
+	buildEntries(files, entries);
+	mList.replaceEntries(entries);
+
+	onListChanged(files);
+}
+
+// header and cursor stack follow the listed files, however the list was rebuilt
+void BasicGameListView::onListChanged(const std::vector<FileData*>& files)
+{
+	const FileData* root = getRoot();
+	const SystemData* systemData = root->getSystem();
+	mHeaderText.setText(systemData ? systemData->getFullName() : root->getCleanName());
+
 	if(files.size() == 0){
 		while(!mCursorStack.empty()){
 			mCursorStack.pop();
@@ -210,6 +227,66 @@ void BasicGameListView::populateList(const std::vector<FileData*>& files)
 	}
 }
 
+bool BasicGameListView::updateEntry(FileData* file)
+{
+	FileData* folder = file->getParent();
+	if(folder == NULL)
+		return false;
+
+	// a changed sort key (name, rating, play count...) moves the file within its folder
+	const int index = folder->resortChild(file);
+	const std::vector<FileData*>& files = folder->getChildren();
+	const bool favoritesOnly = isFavoritesOnly(files);
+
+	std::string favoriteLabel, label;
+	getLabels(file, favoritesOnly, favoriteLabel, label);
+
+	std::vector<std::string> labels;
+	if(!favoriteLabel.empty())
+		labels.push_back(favoriteLabel);
+	if(!label.empty())
+		labels.push_back(label);
+
+	// rows of this file, in list order (favorites block first)
+	std::vector<int> rows = mList.getIndexes(file);
+	if(rows.size() != labels.size())
+		return false; // rows have to be added or removed
+	if(rows.empty())
+		return true;
+
+	// where the rows go: the favorites block then the main list, both in folder order
+	int favoriteRows = 0, favoriteRowsBefore = 0, rowsBefore = 0, total = 0;
+	for(int i = 0; i < (int)files.size(); i++)
+	{
+		bool favoriteRow, row;
+		getRows(files[i], favoritesOnly, favoriteRow, row);
+		favoriteRows += favoriteRow;
+		total += favoriteRow + row;
+		if(i < index)
+		{
+			favoriteRowsBefore += favoriteRow;
+			rowsBefore += row;
+		}
+	}
+	if(total != mList.size())
+		return false; // the list does not show this folder as it is now
+
+	std::vector<int> targets;
+	if(!favoriteLabel.empty())
+		targets.push_back(favoriteRowsBefore);
+	if(!label.empty())
+		targets.push_back(favoriteRows + rowsBefore);
+
+	// a move in the favorites block does not shift the main list rows
+	for(unsigned int i = 0; i < rows.size(); i++)
+	{
+		if(mList.getName(rows[i]) != labels[i])
+			mList.changeCursorName(rows[i], labels[i]);
+		mList.moveEntry(rows[i], targets[i]);
+	}
+	return true;
+}
+
 FileData* BasicGameListView::getCursor()
 {
 	if (!isEmpty())
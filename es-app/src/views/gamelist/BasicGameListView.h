@@ -23,6 +23,8 @@ public:
 	virtual std::vector<HelpPrompt> getHelpPrompts() override;
 
 	virtual void populateList(const std::vector<FileData*>& files) override;
+	virtual void refreshList(const std::vector<FileData*>& files) override;
+	virtual bool updateEntry(FileData* file) override;
 
 	virtual inline void updateInfoPanel() override {}
 
@@ -32,4 +34,11 @@ protected:
 	virtual void launch(FileData* game) override;
 
 	TextListComponent<FileData*> mList;
+
+private:
+	void onListChanged(const std::vector<FileData*>& files);
+	void getRows(FileData* file, bool favoritesOnly, bool& favoriteRow, bool& row) const;
+	void getLabels(FileData* file, bool favoritesOnly, std::string& favoriteLabel, std::string& label) const;
+	bool isFavoritesOnly(const std::vector<FileData*>& files) const;
+	void buildEntries(const std::vector<FileData*>& files, std::vector<TextListComponent<FileData*>::Entry>& entries) const;
 };
@@ -219,6 +219,12 @@ void DetailedGameListView::initMDValues()
 	mDescContainer.setSize(mDescContainer.getSize().x(), mSize.y() - mDescContainer.getPosition().y());
 }
 
+void DetailedGameListView::onFileChanged(FileData* file, FileChangeType change)
+{
+	// already detailed, no need to check for a view change
+	ISimpleGameListView::onFileChanged(file, change);
+}
+
 void DetailedGameListView::updateInfoPanel()
 {
 	FileData* file = (mList.size() == 0 || mList.isScrolling()) ? NULL : mList.getSelected();
@@ -13,6 +13,8 @@ public:
 
 	virtual void onThemeChanged(const std::shared_ptr<ThemeData>& theme) override;
 
+	virtual void onFileChanged(FileData* file, FileChangeType change) override;
+
 	virtual const char* getName() const override { return "detailed"; }
 
 	virtual void updateInfoPanel() override;
@@ -5,6 +5,8 @@
 #include "Settings.h"
 #include "Locale.h"
 
+static Settings::Bool sFavoritesOnly("FavoritesOnly");
+
 GridGameListView::GridGameListView(Window* window, FileData* root) : ISimpleGameListView(window, root),
 	mGrid(window)
 {
@@ -17,9 +19,22 @@ GridGameListView::GridGameListView(Window* window, FileData* root) : ISimpleGame
 
 FileData* GridGameListView::getCursor()
 {
+	if(mGrid.size() == 0)
+		return NULL;
+
 	return mGrid.getSelected();
 }
 
+int GridGameListView::getCursorIndex()
+{
+	return mGrid.getCursorIndex();
+}
+
+void GridGameListView::setCursorIndex(int index)
+{
+	mGrid.setCursorIndex(index);
+}
+
 void GridGameListView::setCursor(FileData* file)
 {
 	if(!mGrid.setCursor(file))
@@ -40,22 +55,38 @@ bool GridGameListView::input(InputConfig* config, Input input)
 void GridGameListView::populateList(const std::vector<FileData*>& files)
 {
 	mGrid.clear();
+
+	const bool favoritesOnly = sFavoritesOnly.get();
 	for(auto it = files.begin(); it != files.end(); it++)
 	{
-		if (Settings::getInstance()->getBool("FavoritesOnly"))
-		{
-			if ((*it)->metadata.get("favorite").compare("true") == 0)
-			{
-				mGrid.add((*it)->getName(), (*it)->getThumbnailPath(), *it);
-			}
-		}
-		else
-		{
-			mGrid.add((*it)->getName(), (*it)->getThumbnailPath(), *it);
-		}
+		if(favoritesOnly && (*it)->metadata.get("favorite").compare("true") != 0)
+			continue;
+
+		mGrid.add((*it)->getName(), (*it)->getThumbnailPath(), *it);
 	}
 }
 
+void GridGameListView::refreshList(const std::vector<FileData*>& files)
+{
+	const bool favoritesOnly = sFavoritesOnly.get();
+
+	std::vector<ImageGridComponent<FileData*>::Entry> entries;
+	entries.reserve(files.size());
+	for(auto it = files.begin(); it != files.end(); it++)
+	{
+		if(favoritesOnly && (*it)->metadata.get("favorite").compare("true") != 0)
+			continue;
+
+		ImageGridComponent<FileData*>::Entry entry;
+		entry.name = (*it)->getName();
+		entry.object = *it;
+		entry.data.texturePath = (*it)->getThumbnailPath();
+		entries.push_back(entry);
+	}
+
+	mGrid.replaceEntries(entries);
+}
+
 void GridGameListView::launch(FileData* game)
 {
 	ViewController::get()->launch(getRoot()->getSystem(), game);
@@ -13,7 +13,9 @@ public:
 	//virtual void onThemeChanged(const std::shared_ptr<ThemeData>& theme) override;
 
 	virtual FileData* getCursor() override;
+	virtual int getCursorIndex() override;
 	virtual void setCursor(FileData*) override;
+	virtual void setCursorIndex(int index) override;
 
 	virtual bool input(InputConfig* config, Input input) override;
 
@@ -23,6 +25,7 @@ public:
 
 protected:
 	virtual void populateList(const std::vector<FileData*>& files) override;
+	virtual void refreshList(const std::vector<FileData*>& files) override;
 	virtual void launch(FileData* game) override;
 
 	ImageGridComponent<FileData*> mGrid;
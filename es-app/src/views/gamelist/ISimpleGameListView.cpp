@@ -48,12 +48,16 @@ void ISimpleGameListView::onThemeChanged(const std::shared_ptr<ThemeData>& theme
 
 void ISimpleGameListView::onFileChanged(FileData* file, FileChangeType change)
 {
-	// we could be tricky here to be efficient;
-	// but this shouldn't happen very often so we'll just always repopulate
-	FileData* cursor = getCursor();
-	int index = getCursorIndex();
-	populateList(getRoot()->getChildren());
-	setCursorIndex(index);
+	// only touch the rows of the changed file when possible (e.g. playcount update after a launch)
+	if(change == FILE_METADATA_CHANGED && updateEntry(file))
+	{
+		updateInfoPanel();
+		return;
+	}
+
+	FileData* folder = mCursorStack.empty() ? getRoot() : mCursorStack.top();
+	refreshList(folder->getChildren());
+	updateInfoPanel();
 
 	/* Favorite */
 	if(file->getType() == GAME){
@@ -83,6 +87,13 @@ void ISimpleGameListView::onFileChanged(FileData* file, FileChangeType change)
 	}
 }
 
+void ISimpleGameListView::refreshList(const std::vector<FileData*>& files)
+{
+	int index = getCursorIndex();
+	populateList(files);
+	setCursorIndex(index);
+}
+
 bool ISimpleGameListView::input(InputConfig* config, Input input)
 {
 	if(input.value != 0)
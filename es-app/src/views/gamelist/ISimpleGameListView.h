@@ -30,6 +30,13 @@ public:
 
 	virtual inline void populateList(const std::vector<FileData*>& files) override {}
 
+	// Rebuilds the displayed rows from files, keeping the cursor where it was.
+	virtual void refreshList(const std::vector<FileData*>& files);
+
+	// Updates the rows of a single file in place.
+	// Returns false if rows have to be added or removed, the caller then refreshes the list.
+	virtual inline bool updateEntry(FileData* file) { return false; }
+
 protected:
 	virtual void launch(FileData* game) = 0;
 
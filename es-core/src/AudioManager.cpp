@@ -4,6 +4,7 @@
 #include <boost/filesystem.hpp>
 #include <views/SystemView.h>
 #include "Log.h"
+#include "Metrics.h"
 #include "RecalboxConf.h"
 #include "Settings.h"
 #include "ThemeData.h"
@@ -11,17 +12,28 @@
 #include <time.h>
 
 std::vector<std::shared_ptr<Sound>> AudioManager::sSoundVector;
-std::vector<std::shared_ptr<Music>> AudioManager::sMusicVector;
 
 
 std::shared_ptr<AudioManager> AudioManager::sInstance;
 
 
-AudioManager::AudioManager() : currentMusic(NULL), running(0) {
+AudioManager::AudioManager() : currentMusic(NULL), running(0), mFrequency(0), mFormat(0), mChannels(0),
+                               runningFromPlaylist(false), mLastRequest(0),
+                               mSwitching(false), mNextRepeat(false), mMusicEnded(false), mLoaderRunning(true),
+                               mCurrentRequest(0), mRandom((unsigned int)(time(NULL) % getpid() + getppid())) {
     init();
+    mLoaderThread = boost::thread(&AudioManager::runLoader, this);
 }
 
 AudioManager::~AudioManager() {
+    {
+        boost::mutex::scoped_lock lock(mLoaderMutex);
+        mLoaderRunning = false;
+        mRequests.clear();
+    }
+    mLoaderCondition.notify_one();
+    mLoaderThread.join();
+
     deinit();
 }
 
@@ -37,17 +49,43 @@ void AudioManager::init() {
     runningFromPlaylist = false;
     if (running == 0) {
         if (SDL_InitSubSystem(SDL_INIT_AUDIO) != 0) {
-            LOG(LogError) << "Error initializing SDL audio!\n" << SDL_GetError();
+            LOG_SUB(LogAudio, LogError) << "Error initializing SDL audio!\n" << SDL_GetError();
             return;
         }
 
+        // the buffer is what a sound effect waits for at most before it is heard: 4096 samples was 93ms
+        const int buffer = Settings::getInstance()->getInt("AudioBufferSize");
+
         //Open the audio device and pause
-        if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 4096) < 0) {
-            LOG(LogError) << "MUSIC Error - Unable to open SDLMixer audio: " << SDL_GetError() << std::endl;
-        } else {
-            LOG(LogInfo) << "SDL AUDIO Initialized";
-            running = 1;
+        boost::mutex::scoped_lock lock(mMixerMutex);
+        if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, buffer) < 0) {
+            LOG_SUB(LogAudio, LogError) << "MUSIC Error - Unable to open SDLMixer audio: " << SDL_GetError() << std::endl;
+            return;
+        }
+        running = 1;
+
+        int frequency = 0;
+        Uint16 format = 0;
+        int channels = 0;
+        Mix_QuerySpec(&frequency, &format, &channels);
+        LOG_SUB(LogAudio, LogInfo) << "SDL AUDIO Initialized, " << frequency << "Hz, " << buffer << " samples buffer ("
+                                   << (frequency > 0 ? buffer * 1000 / frequency : 0) << "ms)";
+
+        // closing the device frees the channels, so they are set up again every time
+        Mix_AllocateChannels(EFFECTS_CHANNELS + MIX_CHANNELS);
+        Mix_ReserveChannels(EFFECTS_CHANNELS);
+        Mix_GroupChannels(0, EFFECTS_CHANNELS - 1, EFFECTS_GROUP);
+
+        // sounds survive the device being closed for a game, they only need decoding again
+        // if it came back with another format
+        if (mFrequency != 0 && (frequency != mFrequency || format != mFormat || channels != mChannels)) {
+            LOG_SUB(LogAudio, LogInfo) << "Audio format changed, reloading sounds";
+            for (unsigned int i = 0; i < sSoundVector.size(); i++)
+                sSoundVector[i]->init();
         }
+        mFrequency = frequency;
+        mFormat = format;
+        mChannels = channels;
     }
 }
 
@@ -55,8 +93,19 @@ void AudioManager::deinit() {
     //stop all playback
     //stop();
     //completely tear down SDL audio. else SDL hogs audio resources and emulators might fail to start...
-    LOG(LogInfo) << "Shutting down SDL AUDIO";
+    LOG_SUB(LogAudio, LogInfo) << "Shutting down SDL AUDIO";
+
+    // nothing that was asked for before is wanted anymore
+    {
+        boost::mutex::scoped_lock lock(mLoaderMutex);
+        mRequests.clear();
+        mLoaded.reset();
+    }
+    mCurrentRequest = ++mLastRequest;
+    mNext.reset();
+    mSwitching = false;
 
+    boost::mutex::scoped_lock lock(mMixerMutex);
     Mix_HaltMusic();
     Mix_CloseAudio();
     SDL_QuitSubSystem(SDL_INIT_AUDIO);
@@ -67,57 +116,127 @@ void AudioManager::stopMusic() {
     Mix_FadeOutMusic(1000);
     Mix_HaltMusic();
     currentMusic = NULL;
+
+    // and whatever was about to start
+    mCurrentRequest = ++mLastRequest;
+    mNext.reset();
+    mSwitching = false;
 }
 
-void musicEndInternal() {
-    AudioManager::getInstance()->musicEnd();
+void AudioManager::musicEnded() {
+    // SDL audio thread, no mixer calls allowed here
+    getInstance()->mMusicEnded = true;
 }
 
 void AudioManager::themeChanged(const std::shared_ptr<ThemeData> &theme) {
     if (RecalboxConf::getInstance()->get("audio.bgmusic") == "1") {
         const ThemeData::ThemeElement *elem = theme->getElement("system", "directory", "sound");
-        if (!elem || !elem->has("path")) {
+        if (!elem || !elem->has(ThemeProperty::PATH)) {
             currentThemeMusicDirectory = "";
         } else {
-            currentThemeMusicDirectory = elem->get<std::string>("path");
+            currentThemeMusicDirectory = elem->get<std::string>(ThemeProperty::PATH);
         }
 
-        std::shared_ptr<Music> bgsound = Music::getFromTheme(theme, "system", "bgsound");
+        const ThemeData::ThemeElement *bgsound = theme->getElement("system", "bgsound", "sound");
 
         // Found a music for the system
-        if (bgsound) {
+        if (bgsound && bgsound->has(ThemeProperty::PATH)) {
+            const std::string path = bgsound->get<std::string>(ThemeProperty::PATH);
+
+            // systems sharing a track don't restart it
+            if (!runningFromPlaylist && !mSwitching && currentMusic && currentMusic->getPath() == path && Mix_PlayingMusic())
+                return;
+
             runningFromPlaylist = false;
-            stopMusic();
-            bgsound->play(true, NULL);
-            currentMusic = bgsound;
+            requestMusic(path, true);
             return;
         }
 
         if (!runningFromPlaylist) {
-            playRandomMusic();
+            runningFromPlaylist = true;
+            requestMusic("", true);
         }
     }
 }
 
-void AudioManager::playRandomMusic() {// Find a random song in user directory or theme music directory
-    std::shared_ptr<Music> bgsound = getRandomMusic(currentThemeMusicDirectory);
-    if (bgsound) {
-        runningFromPlaylist = true;
-        stopMusic();
-        bgsound->play(false, musicEndInternal);
-        currentMusic = bgsound;
+void AudioManager::preload(const std::shared_ptr<ThemeData> &theme) {
+    if (RecalboxConf::getInstance()->get("audio.bgmusic") != "1")
         return;
-    } else {
-        // Not running from playlist, and no theme song found
-        stopMusic();
+
+    const ThemeData::ThemeElement *bgsound = theme->getElement("system", "bgsound", "sound");
+    if (bgsound && bgsound->has(ThemeProperty::PATH))
+        requestMusic(bgsound->get<std::string>(ThemeProperty::PATH), false);
+}
+
+void AudioManager::requestMusic(const std::string &path, bool play) {
+    Request request;
+    request.play = play;
+    request.path = path;
+    request.musicDirectory = Settings::getInstance()->getString("MusicDirectory");
+    request.themeDirectory = currentThemeMusicDirectory;
+
+    {
+        boost::mutex::scoped_lock lock(mLoaderMutex);
+        if (play) {
+            // anything queued is out of date now
+            request.id = ++mLastRequest;
+            mCurrentRequest = request.id;
+            mRequests.clear();
+            mRequests.push_back(request);
+            mSwitching = true;
+        } else {
+            if (mRequests.size() >= MAX_QUEUED_PRELOADS)
+                return;
+            request.id = 0;
+            mRequests.push_back(request);
+        }
     }
+    mLoaderCondition.notify_one();
 }
 
+void AudioManager::update() {
+    // the track ended by itself, rather than being faded out for another one
+    if (mMusicEnded.exchange(false) && !mSwitching && runningFromPlaylist &&
+        RecalboxConf::getInstance()->get("audio.bgmusic") == "1") {
+        LOG_SUB(LogAudio, LogDebug) << "MusicEnded";
+        requestMusic("", true);
+    }
+
+    std::unique_ptr<Loaded> loaded;
+    {
+        boost::mutex::scoped_lock lock(mLoaderMutex);
+        loaded = std::move(mLoaded);
+    }
+
+    if (loaded && loaded->id == mLastRequest) {
+        if (!loaded->music) {
+            // Not running from playlist, and no theme song found
+            if (loaded->fromPlaylist)
+                runningFromPlaylist = false;
+            stopMusic();
+        } else {
+            mNext = loaded->music;
+            mNextRepeat = !loaded->fromPlaylist;
+
+            if (Mix_PlayingMusic() && Mix_FadingMusic() != MIX_FADING_OUT)
+                Mix_FadeOutMusic(FADE_MS);
+        }
+    }
+
+    if (mNext && !Mix_PlayingMusic()) {
+        currentMusic = mNext;
+        mNext.reset();
+        mSwitching = false;
+
+        currentMusic->play(mNextRepeat, mNextRepeat ? NULL : musicEnded);
+        mMusicEnded = false; // the one faded out may have just reported its end
+    }
+}
 
 void AudioManager::resumeMusic() {
     this->init();
     if (currentMusic != NULL && RecalboxConf::getInstance()->get("audio.bgmusic") == "1") {
-        currentMusic->play(runningFromPlaylist ? false : true, runningFromPlaylist ? musicEndInternal : NULL);
+        currentMusic->play(runningFromPlaylist ? false : true, runningFromPlaylist ? musicEnded : NULL);
     }
 }
 
@@ -126,11 +245,6 @@ void AudioManager::registerSound(std::shared_ptr<Sound> &sound) {
     sSoundVector.push_back(sound);
 }
 
-void AudioManager::registerMusic(std::shared_ptr<Music> &music) {
-    getInstance();
-    sMusicVector.push_back(music);
-}
-
 void AudioManager::unregisterSound(std::shared_ptr<Sound> &sound) {
     getInstance();
     for (unsigned int i = 0; i < sSoundVector.size(); i++) {
@@ -140,19 +254,7 @@ void AudioManager::unregisterSound(std::shared_ptr<Sound> &sound) {
             return;
         }
     }
-    LOG(LogError) << "AudioManager Error - tried to unregister a sound that wasn't registered!";
-}
-
-void AudioManager::unregisterMusic(std::shared_ptr<Music> &music) {
-    getInstance();
-    for (unsigned int i = 0; i < sMusicVector.size(); i++) {
-        if (sMusicVector.at(i) == music) {
-            //sMusicVector[i]->stop();
-            sMusicVector.erase(sMusicVector.begin() + i);
-            return;
-        }
-    }
-    LOG(LogError) << "AudioManager Error - tried to unregister a music that wasn't registered!";
+    LOG_SUB(LogAudio, LogError) << "AudioManager Error - tried to unregister a sound that wasn't registered!";
 }
 
 void AudioManager::play() {
@@ -176,44 +278,112 @@ void AudioManager::stop() {
     //SDL_PauseAudio(1);
 }
 
+void AudioManager::runLoader() {
+    while (true) {
+        Request request;
+        {
+            boost::mutex::scoped_lock lock(mLoaderMutex);
+            while (mLoaderRunning && mRequests.empty())
+                mLoaderCondition.wait(lock);
+
+            if (!mLoaderRunning)
+                return;
+
+            request = mRequests.front();
+            mRequests.pop_front();
+        }
+
+        // another system was selected meanwhile
+        if (request.play && request.id != mCurrentRequest)
+            continue;
+
+        const std::string path = request.path.empty() ? pickRandomMusic(request.musicDirectory, request.themeDirectory) : request.path;
+        std::shared_ptr<Music> music = path.empty() ? NULL : loadMusic(path);
+
+        if (request.play) {
+            boost::mutex::scoped_lock lock(mLoaderMutex);
+            mLoaded.reset(new Loaded());
+            mLoaded->id = request.id;
+            mLoaded->music = music;
+            mLoaded->fromPlaylist = request.path.empty();
+        }
+    }
+}
+
+std::shared_ptr<Music> AudioManager::loadMusic(const std::string &path) {
+    std::shared_ptr<Music> music;
+    {
+        boost::mutex::scoped_lock lock(mMixerMutex);
+        if (!running)
+            return NULL;
+
+        music = Music::get(path);
+    }
+
+    if (!music->isLoaded())
+        return NULL;
+
+    // the least recently used tracks are let go, the one playing is held by the UI thread
+    for (auto it = mCachedMusic.begin(); it != mCachedMusic.end(); it++) {
+        if (*it == music) {
+            mCachedMusic.erase(it);
+            break;
+        }
+    }
+    mCachedMusic.push_front(music);
+    if (mCachedMusic.size() > MAX_CACHED_MUSIC)
+        mCachedMusic.pop_back();
+
+    return music;
+}
+
+// rescanned only when the directory changed
+const std::vector<std::string> &AudioManager::listMusic(const std::string &path) {
+    static Metrics::Counter &scans = Metrics::counter("audio.music_directory_scans");
 
-std::vector<std::string> getMusicIn(const std::string &path) {
-    std::vector<std::string> all_matching_files;
+    boost::system::error_code ec;
+    const std::time_t mtime = boost::filesystem::last_write_time(path, ec);
 
-    if (!boost::filesystem::is_directory(path)) {
-        return all_matching_files;
+    Listing &listing = mListings[path];
+    if (ec) {
+        listing.scanned = false;
+        listing.files.clear();
+        return listing.files;
     }
-    const std::string target_path(path);
+
+    if (listing.scanned && listing.mtime == mtime)
+        return listing.files;
+
+    scans.add();
+    listing.scanned = true;
+    listing.mtime = mtime;
+    listing.files.clear();
 
     boost::filesystem::directory_iterator end_itr; // Default ctor yields past-the-end
-    for (boost::filesystem::directory_iterator i(target_path); i != end_itr; ++i) {
+    for (boost::filesystem::directory_iterator i(path, ec); !ec && i != end_itr; i.increment(ec)) {
         // Skip if not a file
         if (!boost::filesystem::is_regular_file(i->status())) continue;
 
         // File matches, store it
-        all_matching_files.push_back(i->path().string());
+        listing.files.push_back(i->path().string());
     }
+
+    return listing.files;
 }
 
-std::shared_ptr<Music> AudioManager::getRandomMusic(std::string themeSoundDirectory) {
+std::string AudioManager::pickRandomMusic(const std::string &musicDirectory, const std::string &themeSoundDirectory) {
     // 1 check in User music directory
-    std::vector<std::string> musics = getMusicIn(Settings::getInstance()->getString("MusicDirectory"));
-    if (musics.empty()) {
+    const std::vector<std::string> *musics = &listMusic(musicDirectory);
+    if (musics->empty()) {
         //  Check in theme sound directory
-        if (themeSoundDirectory != "") {
-            musics = getMusicIn(themeSoundDirectory);
-            if(musics.empty()) return NULL;
-        } else return NULL;
-    }
-    srand (time(NULL) % getpid() + getppid());
-    int randomIndex = rand() % musics.size();
-    std::shared_ptr<Music> bgsound = Music::get(musics.at(randomIndex));
-    return bgsound;
-}
+        if (themeSoundDirectory == "")
+            return "";
 
-void AudioManager::musicEnd() {
-    LOG(LogInfo) << "MusicEnded";
-    if (runningFromPlaylist && RecalboxConf::getInstance()->get("audio.bgmusic") == "1") {
-        playRandomMusic();
+        musics = &listMusic(themeSoundDirectory);
+        if (musics->empty())
+            return "";
     }
+
+    std::uniform_int_distribution<size_t> index(0, musics->size() - 1);
+    return musics->at(index(mRandom));
 }
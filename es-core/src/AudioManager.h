@@ -1,8 +1,14 @@
 #ifndef _AUDIOMANAGER_H_
 #define _AUDIOMANAGER_H_
 
+#include <atomic>
+#include <ctime>
+#include <deque>
+#include <map>
 #include <vector>
 #include <memory>
+#include <random>
+#include <boost/thread.hpp>
 
 #include "SDL_audio.h"
 
@@ -10,9 +16,10 @@
 #include "Music.h"
 
 
+// Music is looked up and loaded by a background thread, so switching systems never waits on the disk.
+// The UI thread picks up what was loaded in update(), fades the current track out and the new one in.
 class AudioManager {
     static std::vector<std::shared_ptr<Sound>> sSoundVector;
-    static std::vector<std::shared_ptr<Music>> sMusicVector;
 
     static std::shared_ptr<AudioManager> sInstance;
     std::shared_ptr<Music> currentMusic;
@@ -21,47 +28,109 @@ class AudioManager {
     AudioManager();
 
 public:
+    // mixer channels kept for Sound, the rest of the mixer (and music) never takes them
+    static const int EFFECTS_CHANNELS = 4;
+    static const int EFFECTS_GROUP = 1;
+
     static std::shared_ptr<AudioManager> &getInstance();
 
     void stopMusic();
 
+    // plays the theme's music, or a random track if it has none, once it is loaded
     void themeChanged(const std::shared_ptr<ThemeData> &theme);
 
+    // loads the theme's music in the background, for a system that is likely to be selected next
+    void preload(const std::shared_ptr<ThemeData> &theme);
+
     void resumeMusic();
 
     void init();
 
     void deinit();
 
-    void registerMusic(std::shared_ptr<Music> &music);
-
     void registerSound(std::shared_ptr<Sound> &sound);
 
-    void unregisterMusic(std::shared_ptr<Music> &music);
-
     void unregisterSound(std::shared_ptr<Sound> &sound);
 
     void play();
 
     void stop();
 
-    void musicEnd();
+    // UI thread, once per frame: starts the music the loader thread has ready
+    void update();
 
     virtual ~AudioManager();
 
 private:
+    // a track to load, and maybe play
+    struct Request {
+        unsigned int id;
+        bool play;
+        std::string path; // empty to pick a random track
+        std::string musicDirectory;
+        std::string themeDirectory;
+    };
+
+    struct Loaded {
+        unsigned int id;
+        std::shared_ptr<Music> music;
+        bool fromPlaylist;
+    };
+
+    struct Listing {
+        Listing() : scanned(false), mtime(0) {}
+
+        bool scanned;
+        std::time_t mtime;
+        std::vector<std::string> files;
+    };
+
+    static const int FADE_MS = 500;
+    static const size_t MAX_CACHED_MUSIC = 4; // tracks kept loaded besides the one playing
+    static const size_t MAX_QUEUED_PRELOADS = 4;
+
+    static void musicEnded();
+
     bool running;
-    int lastTime = 0;
 
-    std::shared_ptr<Music> getRandomMusic(std::string themeSoundDirectory);
+    // what the device was last opened with, sounds are decoded to it
+    int mFrequency;
+    Uint16 mFormat;
+    int mChannels;
 
     bool runningFromPlaylist;
+    std::string currentThemeMusicDirectory;
 
-    bool update(int curTime);
+    // UI thread only
+    unsigned int mLastRequest; // older results are dropped
+    bool mSwitching; // a track was asked for and hasn't started yet
+    std::shared_ptr<Music> mNext; // starts when the current one has faded out
+    bool mNextRepeat;
 
-    std::string currentThemeMusicDirectory;
+    std::atomic<bool> mMusicEnded; // set from the SDL audio thread
+
+    void requestMusic(const std::string &path, bool play);
+
+    // loader thread
+    boost::thread mLoaderThread;
+    boost::mutex mLoaderMutex; // guards the queue, the result and mLoaderRunning
+    boost::condition_variable mLoaderCondition;
+    std::deque<Request> mRequests;
+    std::unique_ptr<Loaded> mLoaded;
+    bool mLoaderRunning;
+    std::atomic<unsigned int> mCurrentRequest;
+
+    boost::mutex mMixerMutex; // held while loading, so the mixer isn't closed under it
+
+    // loader thread only
+    std::deque<std::shared_ptr<Music>> mCachedMusic; // most recently used first
+    std::map<std::string, Listing> mListings;
+    std::mt19937 mRandom;
 
-    void playRandomMusic();
+    void runLoader();
+    std::shared_ptr<Music> loadMusic(const std::string &path);
+    std::string pickRandomMusic(const std::string &musicDirectory, const std::string &themeSoundDirectory);
+    const std::vector<std::string> &listMusic(const std::string &path);
 };
 
 #endif
@@ -311,14 +311,14 @@ void GuiComponent::applyTheme(const std::shared_ptr<ThemeData>& theme, const std
 		return;
 
 	using namespace ThemeFlags;
-	if(properties & POSITION && elem->has("pos"))
+	if(properties & POSITION && elem->has(ThemeProperty::POS))
 	{
-		Eigen::Vector2f denormalized = elem->get<Eigen::Vector2f>("pos").cwiseProduct(scale);
+		Eigen::Vector2f denormalized = elem->get<Eigen::Vector2f>(ThemeProperty::POS).cwiseProduct(scale);
 		setPosition(Eigen::Vector3f(denormalized.x(), denormalized.y(), 0));
 	}
 
-	if(properties & ThemeFlags::SIZE && elem->has("size"))
-		setSize(elem->get<Eigen::Vector2f>("size").cwiseProduct(scale));
+	if(properties & ThemeFlags::SIZE && elem->has(ThemeProperty::SIZE))
+		setSize(elem->get<Eigen::Vector2f>(ThemeProperty::SIZE).cwiseProduct(scale));
 }
 
 void GuiComponent::updateHelpPrompts()
@@ -16,4 +16,6 @@ struct HelpStyle
 
 	HelpStyle(); // default values
 	void applyTheme(const std::shared_ptr<ThemeData>& theme, const std::string& view);
+
+	bool operator==(const HelpStyle& other) const;
 };
\ No newline at end of file
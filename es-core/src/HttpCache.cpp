@@ -0,0 +1,245 @@
+#include "HttpCache.h"
+#include "Log.h"
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+namespace fs = boost::filesystem;
+
+HttpCache::HttpCache(const std::string& directory, size_t maxSize, time_t maxAge) :
+	mDirectory(directory), mMaxSize(maxSize), mMaxAge(maxAge), mLoaded(false), mTotalSize(0), mUseCounter(0)
+{
+}
+
+// 64 bit FNV-1a, std::hash isn't guaranteed to be stable between runs
+std::string HttpCache::getKey(const std::string& url)
+{
+	unsigned long long hash = 14695981039346656037ULL;
+	for(size_t i = 0; i < url.size(); i++)
+	{
+		hash ^= (unsigned char)url[i];
+		hash *= 1099511628211ULL;
+	}
+
+	std::stringstream ss;
+	ss << std::hex << std::setw(16) << std::setfill('0') << hash;
+	return ss.str();
+}
+
+std::string HttpCache::getBodyPath(const std::string& key) const
+{
+	return mDirectory + "/" + key + ".body";
+}
+
+std::string HttpCache::getMetaPath(const std::string& key) const
+{
+	return mDirectory + "/" + key + ".meta";
+}
+
+// first line of the .meta files, older formats (which stored the url) are dropped
+static const char* META_VERSION = "2";
+
+// the index is built from the .meta files on first use, not at startup, then kept in memory
+void HttpCache::loadIndex()
+{
+	mLoaded = true;
+
+	boost::system::error_code ec;
+	if(!fs::exists(mDirectory) && !fs::create_directories(mDirectory, ec))
+	{
+		LOG_SUB(LogNetwork, LogError) << "HttpCache: could not create " << mDirectory;
+		return;
+	}
+
+	// the meta files' mtime gives the LRU order across runs
+	std::multimap<time_t, std::pair<std::string, Entry> > byLastUse;
+	for(fs::directory_iterator it(mDirectory, ec), end; it != end; it.increment(ec))
+	{
+		if(it->path().extension() != ".meta")
+			continue;
+
+		const std::string key = it->path().stem().string();
+		std::ifstream meta(it->path().string());
+
+		std::string version;
+		Entry entry;
+		if(!std::getline(meta, version) || version != META_VERSION
+			|| !std::getline(meta, entry.etag) || !std::getline(meta, entry.lastModified) || !(meta >> entry.stored)
+			|| !fs::exists(getBodyPath(key)))
+		{
+			// unreadable, half written or from an older version, drop it
+			meta.close();
+			remove(key);
+			continue;
+		}
+
+		entry.size = (size_t)fs::file_size(getBodyPath(key), ec);
+		byLastUse.insert(std::make_pair(fs::last_write_time(it->path(), ec), std::make_pair(key, entry)));
+	}
+
+	for(auto it = byLastUse.begin(); it != byLastUse.end(); it++)
+		add(it->second.first, it->second.second);
+
+	evict();
+}
+
+void HttpCache::writeMeta(const std::string& key, const Entry& entry)
+{
+	std::ofstream meta(getMetaPath(key), std::ios_base::out | std::ios_base::trunc);
+	meta << META_VERSION << "\n" << entry.etag << "\n" << entry.lastModified << "\n" << entry.stored << "\n";
+}
+
+void HttpCache::add(const std::string& key, const Entry& entry)
+{
+	Entry& added = mEntries[key];
+	added = entry;
+	added.useOrder = ++mUseCounter;
+	mLru[added.useOrder] = key;
+	mTotalSize += added.size;
+}
+
+const HttpCache::Entry* HttpCache::find(const std::string& url)
+{
+	if(!mLoaded)
+		loadIndex();
+
+	auto it = mEntries.find(getKey(url));
+	if(it == mEntries.end())
+		return NULL;
+
+	return &it->second;
+}
+
+bool HttpCache::isFresh(const Entry& entry) const
+{
+	return time(NULL) - entry.stored < mMaxAge;
+}
+
+// the meta file's mtime keeps the LRU order across runs
+void HttpCache::use(const std::string& key, Entry& entry)
+{
+	mLru.erase(entry.useOrder);
+	entry.useOrder = ++mUseCounter;
+	mLru[entry.useOrder] = key;
+
+	boost::system::error_code ec;
+	fs::last_write_time(getMetaPath(key), time(NULL), ec);
+}
+
+bool HttpCache::read(const std::string& url, std::vector<char>& content)
+{
+	if(find(url) == NULL)
+		return false;
+
+	const std::string key = getKey(url);
+	std::ifstream body(getBodyPath(key), std::ios_base::in | std::ios_base::binary);
+	if(!body)
+		return false;
+
+	Entry& entry = mEntries[key];
+	content.resize(entry.size);
+	if(entry.size > 0 && !body.read(content.data(), entry.size))
+	{
+		content.clear();
+		remove(key);
+		return false;
+	}
+
+	use(key, entry);
+	return true;
+}
+
+bool HttpCache::copyTo(const std::string& url, const std::string& path)
+{
+	if(find(url) == NULL)
+		return false;
+
+	const std::string key = getKey(url);
+	boost::system::error_code ec;
+	fs::copy_file(getBodyPath(key), path, fs::copy_option::overwrite_if_exists, ec);
+	if(ec)
+		return false;
+
+	use(key, mEntries[key]);
+	return true;
+}
+
+void HttpCache::store(const std::string& url, const std::vector<char>& content, const std::string& contentPath,
+	const std::string& etag, const std::string& lastModified)
+{
+	if(!mLoaded)
+		loadIndex();
+
+	const std::string key = getKey(url);
+	if(mEntries.find(key) != mEntries.end())
+		remove(key);
+
+	boost::system::error_code ec;
+	Entry entry;
+	if(!contentPath.empty())
+	{
+		fs::copy_file(contentPath, getBodyPath(key), fs::copy_option::overwrite_if_exists, ec);
+		entry.size = ec ? 0 : (size_t)fs::file_size(getBodyPath(key), ec);
+	}else{
+		std::ofstream body(getBodyPath(key), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+		body.write(content.data(), content.size());
+		body.close();
+		if(body.fail())
+			ec = boost::system::errc::make_error_code(boost::system::errc::io_error);
+		entry.size = content.size();
+	}
+
+	if(ec)
+	{
+		LOG_SUB(LogNetwork, LogWarning) << "HttpCache: could not cache " << url;
+		fs::remove(getBodyPath(key), ec);
+		return;
+	}
+
+	entry.etag = etag;
+	entry.lastModified = lastModified;
+	entry.stored = time(NULL);
+
+	// written last, a body without meta is ignored
+	writeMeta(key, entry);
+	add(key, entry);
+
+	evict();
+}
+
+void HttpCache::revalidated(const std::string& url)
+{
+	if(find(url) == NULL)
+		return;
+
+	const std::string key = getKey(url);
+	Entry& entry = mEntries[key];
+	entry.stored = time(NULL);
+	writeMeta(key, entry);
+	use(key, entry);
+}
+
+void HttpCache::remove(const std::string& key)
+{
+	auto it = mEntries.find(key);
+	if(it != mEntries.end())
+	{
+		mTotalSize -= it->second.size;
+		mLru.erase(it->second.useOrder);
+		mEntries.erase(it);
+	}
+
+	boost::system::error_code ec;
+	fs::remove(getMetaPath(key), ec);
+	fs::remove(getBodyPath(key), ec);
+}
+
+void HttpCache::evict()
+{
+	while(mTotalSize > mMaxSize && !mLru.empty())
+	{
+		const std::string key = mLru.begin()->second;
+		remove(key);
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <ctime>
+
+// On-disk cache of HTTP responses, keyed by a hash of the URL (URLs can carry scraper credentials,
+// they are never written to disk).
+// Entries younger than maxAge are served without touching the network, older ones are revalidated
+// with If-None-Match / If-Modified-Since. The least recently used entries are evicted past maxSize bytes.
+// Only used from the HttpThread, so it does no locking of its own.
+class HttpCache
+{
+public:
+	struct Entry
+	{
+		std::string etag;
+		std::string lastModified;
+		time_t stored;
+		unsigned long useOrder; // position in mLru
+		size_t size;
+	};
+
+	HttpCache(const std::string& directory, size_t maxSize, time_t maxAge);
+
+	// NULL if the url is not cached
+	const Entry* find(const std::string& url);
+	bool isFresh(const Entry& entry) const;
+
+	bool read(const std::string& url, std::vector<char>& content);
+	bool copyTo(const std::string& url, const std::string& path);
+
+	// contentPath: file holding the body if content is not used
+	void store(const std::string& url, const std::vector<char>& content, const std::string& contentPath,
+		const std::string& etag, const std::string& lastModified);
+
+	// the server confirmed the cached copy (304), it is fresh again
+	void revalidated(const std::string& url);
+
+private:
+	void loadIndex();
+	void writeMeta(const std::string& key, const Entry& entry);
+	void use(const std::string& key, Entry& entry);
+	void add(const std::string& key, const Entry& entry);
+	void remove(const std::string& key);
+	void evict();
+
+	static std::string getKey(const std::string& url);
+	std::string getBodyPath(const std::string& key) const;
+	std::string getMetaPath(const std::string& key) const;
+
+	std::string mDirectory;
+	size_t mMaxSize;
+	time_t mMaxAge;
+
+	bool mLoaded;
+	std::map<std::string, Entry> mEntries;
+	std::map<unsigned long, std::string> mLru; // useOrder -> key, least recently used first
+	size_t mTotalSize;
+	unsigned long mUseCounter;
+};
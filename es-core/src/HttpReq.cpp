@@ -1,11 +1,14 @@
 #include <iostream>
 #include "HttpReq.h"
+#include "HttpThread.h"
 #include "Log.h"
 #include <boost/filesystem.hpp>
 
-CURLM* HttpReq::s_multi_handle = curl_multi_init();
-
-std::map<CURL*, HttpReq*> HttpReq::s_requests;
+HttpTransfer::HttpTransfer() : handle(NULL), status(HttpReq::REQ_IN_PROGRESS), cancelled(false), file(NULL),
+	headers(NULL), revalidating(false)
+{
+	errorBuffer[0] = '\0';
+}
 
 std::string HttpReq::urlEncode(const std::string &s)
 {
@@ -37,142 +40,173 @@ bool HttpReq::isUrl(const std::string& str)
 }
 
 HttpReq::HttpReq(const std::string& url)
-	: mStatus(REQ_IN_PROGRESS), mHandle(NULL)
+	: mTransfer(std::make_shared<HttpTransfer>())
+{
+	init(url);
+}
+
+HttpReq::HttpReq(const std::string& url, const std::string& saveAs)
+	: mTransfer(std::make_shared<HttpTransfer>())
+{
+	mTransfer->savePath = saveAs;
+	init(url);
+}
+
+void HttpReq::init(const std::string& url)
 {
-	mHandle = curl_easy_init();
+	CURL* handle = curl_easy_init();
 
-	if(mHandle == NULL)
+	if(handle == NULL)
 	{
-		mStatus = REQ_IO_ERROR;
 		onError("curl_easy_init failed");
 		return;
 	}
 
 	//set the url
-	CURLcode err = curl_easy_setopt(mHandle, CURLOPT_URL, url.c_str());
-	if(err != CURLE_OK)
-	{
-		mStatus = REQ_IO_ERROR;
-		onError(curl_easy_strerror(err));
-		return;
-	}
+	CURLcode err = curl_easy_setopt(handle, CURLOPT_URL, url.c_str());
 
 	//tell curl how to write the data
-	err = curl_easy_setopt(mHandle, CURLOPT_WRITEFUNCTION, &HttpReq::write_content);
-	if(err != CURLE_OK)
-	{
-		mStatus = REQ_IO_ERROR;
-		onError(curl_easy_strerror(err));
-		return;
-	}
+	if(err == CURLE_OK)
+		err = curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, &HttpReq::write_content);
+
+	//give curl a pointer to the transfer so we know where to write the data *to* in our write function
+	if(err == CURLE_OK)
+		err = curl_easy_setopt(handle, CURLOPT_WRITEDATA, mTransfer.get());
+
+	if(err == CURLE_OK)
+		err = curl_easy_setopt(handle, CURLOPT_ERRORBUFFER, mTransfer->errorBuffer);
+
+	//ETag and Last-Modified are needed to revalidate cached responses
+	if(err == CURLE_OK)
+		err = curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, &HttpReq::write_header);
+
+	if(err == CURLE_OK)
+		err = curl_easy_setopt(handle, CURLOPT_HEADERDATA, mTransfer.get());
+
+	//signals can't be used for DNS timeouts outside of the main thread
+	if(err == CURLE_OK)
+		err = curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+
+	//keep resolved hosts around, scrapers hit the same few hosts over and over
+	if(err == CURLE_OK)
+		err = curl_easy_setopt(handle, CURLOPT_DNS_CACHE_TIMEOUT, 300L);
+
+	if(err == CURLE_OK)
+		err = curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
 
-	//give curl a pointer to this HttpReq so we know where to write the data *to* in our write function
-	err = curl_easy_setopt(mHandle, CURLOPT_WRITEDATA, this);
 	if(err != CURLE_OK)
 	{
-		mStatus = REQ_IO_ERROR;
+		curl_easy_cleanup(handle);
 		onError(curl_easy_strerror(err));
 		return;
 	}
 
-	//add the handle to our multi
-	CURLMcode merr = curl_multi_add_handle(s_multi_handle, mHandle);
-	if(merr != CURLM_OK)
-	{
-		mStatus = REQ_IO_ERROR;
-		onError(curl_multi_strerror(merr));
-		return;
-	}
-
-	s_requests[mHandle] = this;
+	mTransfer->handle = handle;
+	mTransfer->url = url;
+	HttpThread::getInstance()->add(mTransfer);
 }
 
 HttpReq::~HttpReq()
 {
-	if(mHandle)
-	{
-		s_requests.erase(mHandle);
-
-		CURLMcode merr = curl_multi_remove_handle(s_multi_handle, mHandle);
-
-        if(merr != CURLM_OK) {
-			LOG(LogError) << "Error removing curl_easy handle from curl_multi: " << curl_multi_strerror(merr);
-        }
-
-		curl_easy_cleanup(mHandle);
-	}
+	if(mTransfer->status.load(std::memory_order_acquire) == REQ_IN_PROGRESS)
+		HttpThread::getInstance()->cancel(mTransfer);
 }
 
 HttpReq::Status HttpReq::status()
 {
-	if(mStatus == REQ_IN_PROGRESS)
-	{
-		int handle_count;
-		CURLMcode merr = curl_multi_perform(s_multi_handle, &handle_count);
-		if(merr != CURLM_OK && merr != CURLM_CALL_MULTI_PERFORM)
-		{
-			mStatus = REQ_IO_ERROR;
-			onError(curl_multi_strerror(merr));
-			return mStatus;
-		}
-
-		int msgs_left;
-		CURLMsg* msg;
-        while((msg = curl_multi_info_read(s_multi_handle, &msgs_left)))
-		{
-			if(msg->msg == CURLMSG_DONE)
-			{
-				HttpReq* req = s_requests[msg->easy_handle];
-				
-				if(req == NULL)
-				{
-					LOG(LogError) << "Cannot find easy handle!";
-					continue;
-				}
-
-				if(msg->data.result == CURLE_OK)
-				{
-					req->mStatus = REQ_SUCCESS;
-				}else{
-					req->mStatus = REQ_IO_ERROR;
-					req->onError(curl_easy_strerror(msg->data.result));
-				}
-			}
-		}
-	}
-
-	return mStatus;
+	return (Status)mTransfer->status.load(std::memory_order_acquire);
 }
 
 std::string HttpReq::getContent() const
 {
-	assert(mStatus == REQ_SUCCESS);
-	return mContent.str();
+	assert(mTransfer->status.load(std::memory_order_acquire) == REQ_SUCCESS);
+	return std::string(mTransfer->content.begin(), mTransfer->content.end());
+}
+
+std::vector<char> HttpReq::takeContent()
+{
+	assert(mTransfer->status.load(std::memory_order_acquire) == REQ_SUCCESS);
+	return std::move(mTransfer->content);
 }
 
+// only used before the transfer is handed to the HttpThread
 void HttpReq::onError(const char* msg)
 {
-	mErrorMsg = msg;
+	mTransfer->errorMsg = msg;
+	mTransfer->status.store(REQ_IO_ERROR, std::memory_order_release);
 }
 
 std::string HttpReq::getErrorMsg()
 {
-	return mErrorMsg;
+	if(mTransfer->status.load(std::memory_order_acquire) == REQ_IN_PROGRESS)
+		return "";
+
+	return mTransfer->errorMsg;
 }
 
-//used as a curl callback
+//used as a curl callback, runs on the network thread
 //size = size of an element, nmemb = number of elements
-//return value is number of elements successfully read
-size_t HttpReq::write_content(void* buff, size_t size, size_t nmemb, void* req_ptr)
+//return value is number of bytes successfully written, anything else aborts the transfer
+size_t HttpReq::write_content(void* buff, size_t size, size_t nmemb, void* transfer_ptr)
 {
-	std::stringstream& ss = ((HttpReq*)req_ptr)->mContent;
-	ss.write((char*)buff, size * nmemb);
+	HttpTransfer* transfer = (HttpTransfer*)transfer_ptr;
+	const size_t length = size * nmemb;
 
-	return nmemb;
+	if(!transfer->savePath.empty())
+	{
+		if(transfer->file == NULL)
+		{
+			transfer->file = fopen(transfer->savePath.c_str(), "wb");
+			if(transfer->file == NULL)
+				return 0;
+		}
+
+		return fwrite(buff, 1, length, transfer->file);
+	}
+
+	std::vector<char>& content = transfer->content;
+	if(content.empty())
+	{
+		// allocate the whole body up front when the server tells us its size
+		curl_off_t contentLength = -1;
+		if(curl_easy_getinfo(transfer->handle, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &contentLength) == CURLE_OK && contentLength > 0)
+			content.reserve((size_t)contentLength);
+	}
+
+	content.insert(content.end(), (char*)buff, (char*)buff + length);
+	return length;
 }
 
-//used as a curl callback
-/*int HttpReq::update_progress(void* req_ptr, double dlTotal, double dlNow, double ulTotal, double ulNow)
+//used as a curl callback for every header line, runs on the network thread
+size_t HttpReq::write_header(char* buff, size_t size, size_t nmemb, void* transfer_ptr)
 {
-	
-}*/
+	HttpTransfer* transfer = (HttpTransfer*)transfer_ptr;
+	const size_t length = size * nmemb;
+
+	std::string line(buff, length);
+	while(!line.empty() && (line.back() == '\r' || line.back() == '\n'))
+		line.pop_back();
+
+	const size_t colon = line.find(':');
+	if(line.compare(0, 5, "HTTP/") == 0)
+	{
+		// a new response (e.g. after a redirect), forget the previous one's headers
+		transfer->etag.clear();
+		transfer->lastModified.clear();
+	}else if(colon != std::string::npos)
+	{
+		std::string name = line.substr(0, colon);
+		for(size_t i = 0; i < name.size(); i++)
+			name[i] = tolower(name[i]);
+
+		size_t valueStart = line.find_first_not_of(' ', colon + 1);
+		const std::string value = valueStart == std::string::npos ? "" : line.substr(valueStart);
+
+		if(name == "etag")
+			transfer->etag = value;
+		else if(name == "last-modified")
+			transfer->lastModified = value;
+	}
+
+	return length;
+}
@@ -1,8 +1,11 @@
 #pragma once
 
 #include <curl/curl.h>
-#include <sstream>
-#include <map>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdio>
 
 /* Usage:
  * HttpReq myRequest("www.google.com", "/index.html");
@@ -19,13 +22,48 @@
  *
  * std::string content = myRequest.getContent();
  * //process contents...
+ *
+ * The transfer itself runs on the HttpThread, status() never blocks.
+ * HttpReq myDownload(url, "/path/to/file") writes the body straight to the file instead of keeping it in memory.
+ * Responses are cached on disk (see HttpCache), an unchanged response (304) is served from there.
 */
 
+// State shared between an HttpReq and the HttpThread.
+// It can outlive the HttpReq when the request is destroyed (cancelled) mid-transfer.
+struct HttpTransfer
+{
+	HttpTransfer();
+
+	CURL* handle;
+
+	// an HttpReq::Status, written once by the network thread when the transfer is over (release)
+	// content and errorMsg must not be read before this leaves REQ_IN_PROGRESS (acquire)
+	std::atomic<int> status;
+	std::atomic<bool> cancelled;
+
+	std::vector<char> content;
+	std::string savePath;
+	FILE* file;
+
+	std::string errorMsg;
+	char errorBuffer[CURL_ERROR_SIZE];
+
+	// HttpCache bookkeeping, network thread only
+	std::string url;
+	struct curl_slist* headers;
+	bool revalidating;
+	std::string etag;
+	std::string lastModified;
+};
+
 class HttpReq
 {
 public:
 	HttpReq(const std::string& url);
 
+	// the body is written to saveAs as it arrives, getContent() stays empty
+	HttpReq(const std::string& url, const std::string& saveAs);
+
 	~HttpReq();
 
 	enum Status
@@ -38,31 +76,23 @@ public:
 		REQ_INVALID_RESPONSE	//the HTTP response was invalid
 	};
 
-	Status status(); //process any received data and return the status afterwards
+	Status status(); //return the status, the transfer progresses on its own
 
 	std::string getErrorMsg();
 
 	std::string getContent() const; // mStatus must be REQ_SUCCESS
+	std::vector<char> takeContent(); // the same without a copy, getContent() is empty afterwards
 
 	static std::string urlEncode(const std::string &s);
 	static bool isUrl(const std::string& s);
 
 private:
-	static size_t write_content(void* buff, size_t size, size_t nmemb, void* req_ptr);
-	//static int update_progress(void* req_ptr, double dlTotal, double dlNow, double ulTotal, double ulNow);
+	void init(const std::string& url);
 
-	//god dammit libcurl why can't you have some way to check the status of an individual handle
-	//why do I have to handle ALL messages at once
-	static std::map<CURL*, HttpReq*> s_requests;
-
-	static CURLM* s_multi_handle;
+	static size_t write_content(void* buff, size_t size, size_t nmemb, void* transfer_ptr);
+	static size_t write_header(char* buff, size_t size, size_t nmemb, void* transfer_ptr);
 
 	void onError(const char* msg);
 
-	CURL* mHandle;
-
-	Status mStatus;
-
-	std::stringstream mContent;
-	std::string mErrorMsg;
+	std::shared_ptr<HttpTransfer> mTransfer;
 };
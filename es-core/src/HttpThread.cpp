@@ -0,0 +1,445 @@
+#include "HttpThread.h"
+#include "Log.h"
+#include "Settings.h"
+#include "platform.h"
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <time.h>
+
+#define MAX_EVENTS 16
+
+static long long now_ms()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+HttpThread* HttpThread::sInstance = NULL;
+
+HttpThread* HttpThread::getInstance()
+{
+	if(sInstance == NULL)
+		sInstance = new HttpThread();
+
+	return sInstance;
+}
+
+void HttpThread::shutdown()
+{
+	delete sInstance;
+	sInstance = NULL;
+}
+
+HttpThread::HttpThread() : mDeadline(-1), mStopping(false)
+{
+	// must happen before any other thread uses curl
+	curl_global_init(CURL_GLOBAL_ALL);
+
+	mMulti = curl_multi_init();
+	curl_multi_setopt(mMulti, CURLMOPT_SOCKETFUNCTION, &HttpThread::socketCallback);
+	curl_multi_setopt(mMulti, CURLMOPT_SOCKETDATA, this);
+	curl_multi_setopt(mMulti, CURLMOPT_TIMERFUNCTION, &HttpThread::timerCallback);
+	curl_multi_setopt(mMulti, CURLMOPT_TIMERDATA, this);
+
+	// idle connections kept open for the next request to the same host
+	curl_multi_setopt(mMulti, CURLMOPT_MAXCONNECTS, 8L);
+
+	// settings are read here, on the thread creating us, never from the network thread
+	if(Settings::getInstance()->getBool("HttpCache"))
+	{
+		mCache = std::unique_ptr<HttpCache>(new HttpCache(getHomePath() + "/.emulationstation/http_cache",
+			(size_t)Settings::getInstance()->getInt("HttpCacheSize") * 1024 * 1024,
+			(time_t)Settings::getInstance()->getInt("HttpCacheMaxAge") * 60 * 60));
+	}
+
+	mEpollFd = epoll_create1(EPOLL_CLOEXEC);
+	if(mEpollFd < 0)
+		LOG_SUB(LogNetwork, LogError) << "HttpThread: epoll_create error: " << strerror(errno);
+
+	mWakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if(mWakeFd < 0)
+		LOG_SUB(LogNetwork, LogError) << "HttpThread: eventfd error: " << strerror(errno);
+
+	epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.fd = mWakeFd;
+	epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mWakeFd, &event);
+
+	mThread = boost::thread(&HttpThread::run, this);
+}
+
+HttpThread::~HttpThread()
+{
+	{
+		boost::mutex::scoped_lock lock(mMutex);
+		mStopping = true;
+	}
+	wakeUp();
+	mThread.join();
+
+	// nobody is waiting for these anymore
+	for(auto it = mActive.begin(); it != mActive.end(); it++)
+	{
+		curl_multi_remove_handle(mMulti, it->first);
+		release(it->second);
+	}
+	mActive.clear();
+
+	for(auto it = mSubmitted.begin(); it != mSubmitted.end(); it++)
+		release(*it);
+	mSubmitted.clear();
+
+	curl_multi_cleanup(mMulti);
+	close(mWakeFd);
+	close(mEpollFd);
+	curl_global_cleanup();
+}
+
+void HttpThread::add(const std::shared_ptr<HttpTransfer>& transfer)
+{
+	{
+		boost::mutex::scoped_lock lock(mMutex);
+		mSubmitted.push_back(transfer);
+	}
+	wakeUp();
+}
+
+void HttpThread::cancel(const std::shared_ptr<HttpTransfer>& transfer)
+{
+	transfer->cancelled.store(true);
+	{
+		boost::mutex::scoped_lock lock(mMutex);
+		mCancelled.push_back(transfer);
+	}
+	wakeUp();
+}
+
+void HttpThread::wakeUp()
+{
+	uint64_t one = 1;
+	if(write(mWakeFd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+		LOG_SUB(LogNetwork, LogError) << "HttpThread: could not wake up network thread: " << strerror(errno);
+}
+
+int HttpThread::socketCallback(CURL* easy, curl_socket_t s, int what, void* userp, void* socketp)
+{
+	HttpThread* self = (HttpThread*)userp;
+
+	if(what == CURL_POLL_REMOVE)
+	{
+		// curl may already have closed it, which removes it from the epoll set anyway
+		epoll_ctl(self->mEpollFd, EPOLL_CTL_DEL, s, NULL);
+		return 0;
+	}
+
+	epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.data.fd = s;
+	if(what & CURL_POLL_IN)
+		event.events |= EPOLLIN;
+	if(what & CURL_POLL_OUT)
+		event.events |= EPOLLOUT;
+
+	if(epoll_ctl(self->mEpollFd, EPOLL_CTL_MOD, s, &event) != 0 && errno == ENOENT)
+		epoll_ctl(self->mEpollFd, EPOLL_CTL_ADD, s, &event);
+
+	return 0;
+}
+
+int HttpThread::timerCallback(CURLM* multi, long timeoutMs, void* userp)
+{
+	HttpThread* self = (HttpThread*)userp;
+	self->mDeadline = timeoutMs < 0 ? -1 : now_ms() + timeoutMs;
+	return 0;
+}
+
+void HttpThread::run()
+{
+	epoll_event events[MAX_EVENTS];
+	int running;
+
+	while(true)
+	{
+		int timeout = -1;
+		if(mDeadline >= 0)
+		{
+			long long remaining = mDeadline - now_ms();
+			timeout = remaining > 0 ? (int)remaining : 0;
+		}
+
+		int count = epoll_wait(mEpollFd, events, MAX_EVENTS, timeout);
+		if(count < 0)
+		{
+			if(errno != EINTR)
+				LOG_SUB(LogNetwork, LogError) << "HttpThread: epoll_wait error: " << strerror(errno);
+			continue;
+		}
+
+		for(int i = 0; i < count; i++)
+		{
+			if(events[i].data.fd == mWakeFd)
+			{
+				uint64_t value;
+				while(read(mWakeFd, &value, sizeof(value)) > 0)
+				{
+				}
+
+				{
+					boost::mutex::scoped_lock lock(mMutex);
+					if(mStopping)
+						return;
+				}
+
+				processQueues();
+				continue;
+			}
+
+			int mask = 0;
+			if(events[i].events & EPOLLIN)
+				mask |= CURL_CSELECT_IN;
+			if(events[i].events & EPOLLOUT)
+				mask |= CURL_CSELECT_OUT;
+			if(events[i].events & (EPOLLERR | EPOLLHUP))
+				mask |= CURL_CSELECT_ERR;
+
+			curl_multi_socket_action(mMulti, events[i].data.fd, mask, &running);
+		}
+
+		if(mDeadline >= 0 && now_ms() >= mDeadline)
+		{
+			mDeadline = -1;
+			curl_multi_socket_action(mMulti, CURL_SOCKET_TIMEOUT, 0, &running);
+		}
+
+		checkCompleted();
+	}
+}
+
+void HttpThread::processQueues()
+{
+	std::vector< std::shared_ptr<HttpTransfer> > submitted;
+	std::vector< std::shared_ptr<HttpTransfer> > cancelled;
+	{
+		boost::mutex::scoped_lock lock(mMutex);
+		submitted.swap(mSubmitted);
+		cancelled.swap(mCancelled);
+	}
+
+	for(auto it = submitted.begin(); it != submitted.end(); it++)
+	{
+		const std::shared_ptr<HttpTransfer>& transfer = *it;
+
+		// cancelled before we even started, the cancel entry below has nothing left to do
+		if(transfer->cancelled.load() || checkCache(transfer))
+		{
+			curl_easy_cleanup(transfer->handle);
+			transfer->handle = NULL;
+			continue;
+		}
+
+		CURLMcode merr = curl_multi_add_handle(mMulti, transfer->handle);
+		if(merr != CURLM_OK)
+		{
+			transfer->errorMsg = curl_multi_strerror(merr);
+			curl_easy_cleanup(transfer->handle);
+			transfer->handle = NULL;
+			transfer->status.store(HttpReq::REQ_IO_ERROR, std::memory_order_release);
+			continue;
+		}
+
+		mActive[transfer->handle] = transfer;
+	}
+
+	for(auto it = cancelled.begin(); it != cancelled.end(); it++)
+	{
+		const std::shared_ptr<HttpTransfer>& transfer = *it;
+		if(transfer->handle == NULL || mActive.find(transfer->handle) == mActive.end())
+			continue;
+
+		mActive.erase(transfer->handle);
+		curl_multi_remove_handle(mMulti, transfer->handle);
+		release(transfer);
+	}
+}
+
+// the handle must not be in the multi handle anymore
+void HttpThread::release(const std::shared_ptr<HttpTransfer>& transfer)
+{
+	curl_easy_cleanup(transfer->handle);
+	transfer->handle = NULL;
+
+	if(transfer->headers != NULL)
+	{
+		curl_slist_free_all(transfer->headers);
+		transfer->headers = NULL;
+	}
+
+	if(transfer->file != NULL)
+	{
+		// don't leave half a file behind
+		fclose(transfer->file);
+		transfer->file = NULL;
+		remove(transfer->savePath.c_str());
+	}
+}
+
+void HttpThread::checkCompleted()
+{
+	int msgsLeft;
+	CURLMsg* msg;
+	while((msg = curl_multi_info_read(mMulti, &msgsLeft)))
+	{
+		if(msg->msg != CURLMSG_DONE)
+			continue;
+
+		auto it = mActive.find(msg->easy_handle);
+		if(it == mActive.end())
+		{
+			LOG_SUB(LogNetwork, LogError) << "Cannot find easy handle!";
+			continue;
+		}
+
+		// the message points into the handle, read it before cleaning up
+		std::shared_ptr<HttpTransfer> transfer = it->second;
+		CURLcode result = msg->data.result;
+		mActive.erase(it);
+
+		finish(transfer, result);
+	}
+}
+
+bool HttpThread::checkCache(const std::shared_ptr<HttpTransfer>& transfer)
+{
+	if(!mCache)
+		return false;
+
+	const HttpCache::Entry* entry = mCache->find(transfer->url);
+	if(entry == NULL)
+		return false;
+
+	if(mCache->isFresh(*entry) && serveFromCache(transfer))
+		return true;
+
+	// stale, ask the server whether our copy is still good
+	if(!entry->etag.empty())
+		transfer->headers = curl_slist_append(transfer->headers, ("If-None-Match: " + entry->etag).c_str());
+	if(!entry->lastModified.empty())
+		transfer->headers = curl_slist_append(transfer->headers, ("If-Modified-Since: " + entry->lastModified).c_str());
+
+	if(transfer->headers != NULL)
+	{
+		curl_easy_setopt(transfer->handle, CURLOPT_HTTPHEADER, transfer->headers);
+		transfer->revalidating = true;
+	}
+
+	return false;
+}
+
+bool HttpThread::serveFromCache(const std::shared_ptr<HttpTransfer>& transfer)
+{
+	const bool served = transfer->savePath.empty() ? mCache->read(transfer->url, transfer->content) : mCache->copyTo(transfer->url, transfer->savePath);
+	if(served)
+		transfer->status.store(HttpReq::REQ_SUCCESS, std::memory_order_release);
+
+	return served;
+}
+
+// our copy went away (evicted, unreadable) while the server said it was still good:
+// the same handle goes again, without the conditional headers
+bool HttpThread::retryUnconditionally(const std::shared_ptr<HttpTransfer>& transfer)
+{
+	LOG_SUB(LogNetwork, LogDebug) << "Cached copy of " << transfer->url << " is gone, requesting it again";
+
+	curl_easy_setopt(transfer->handle, CURLOPT_HTTPHEADER, NULL);
+	curl_slist_free_all(transfer->headers);
+	transfer->headers = NULL;
+	transfer->revalidating = false;
+
+	transfer->content.clear();
+	transfer->errorBuffer[0] = '\0';
+
+	if(curl_multi_add_handle(mMulti, transfer->handle) != CURLM_OK)
+		return false;
+
+	mActive[transfer->handle] = transfer;
+	return true;
+}
+
+void HttpThread::finish(const std::shared_ptr<HttpTransfer>& transfer, CURLcode result)
+{
+	long responseCode = 0;
+	curl_easy_getinfo(transfer->handle, CURLINFO_RESPONSE_CODE, &responseCode);
+
+	curl_multi_remove_handle(mMulti, transfer->handle);
+
+	const bool wroteFile = transfer->file != NULL;
+	if(wroteFile)
+	{
+		if(fclose(transfer->file) != 0 && result == CURLE_OK)
+		{
+			transfer->errorMsg = "Failed to write \"" + transfer->savePath + "\"";
+			result = CURLE_WRITE_ERROR;
+		}
+		transfer->file = NULL;
+	}
+
+	if(mCache && transfer->revalidating && (responseCode == 304 || responseCode >= 500 || result != CURLE_OK))
+	{
+		// not modified, or the server can't answer: our copy is the best we have
+		if(responseCode == 304)
+			mCache->revalidated(transfer->url);
+
+		transfer->content.clear();
+		if(serveFromCache(transfer))
+		{
+			release(transfer);
+			return;
+		}
+
+		// a 304 has no body to fall back on
+		if(responseCode == 304 && !wroteFile && retryUnconditionally(transfer))
+			return;
+	}
+
+	curl_easy_cleanup(transfer->handle);
+	transfer->handle = NULL;
+
+	if(transfer->headers != NULL)
+	{
+		curl_slist_free_all(transfer->headers);
+		transfer->headers = NULL;
+	}
+
+	HttpReq::Status status = HttpReq::REQ_SUCCESS;
+	if(result != CURLE_OK)
+	{
+		status = HttpReq::REQ_IO_ERROR;
+		if(transfer->errorMsg.empty())
+			transfer->errorMsg = transfer->errorBuffer[0] != '\0' ? transfer->errorBuffer : curl_easy_strerror(result);
+
+		if(!transfer->savePath.empty())
+			remove(transfer->savePath.c_str());
+	}else if(responseCode == 304)
+	{
+		// the retry couldn't be started: there is no body to give
+		status = HttpReq::REQ_BAD_STATUS_CODE;
+		transfer->errorMsg = "Not modified, but the cached copy is gone";
+	}else if(!transfer->savePath.empty() && !wroteFile)
+	{
+		// empty body, nothing was written so the file was never created
+		FILE* file = fopen(transfer->savePath.c_str(), "wb");
+		if(file != NULL)
+			fclose(file);
+	}
+
+	if(mCache && status == HttpReq::REQ_SUCCESS && responseCode == 200)
+		mCache->store(transfer->url, transfer->content, transfer->savePath, transfer->etag, transfer->lastModified);
+
+	// publishes content and errorMsg to the thread polling HttpReq::status()
+	transfer->status.store(status, std::memory_order_release);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "HttpReq.h"
+#include "HttpCache.h"
+#include <map>
+#include <vector>
+#include <boost/thread.hpp>
+
+// Drives every HttpReq from a single network thread.
+// curl_multi_socket_action is fed from an epoll loop, so transfers progress independently of the frame rate.
+// All requests share one curl multi handle, which keeps connections and DNS lookups around for reuse.
+// Responses go through an HttpCache, unless the HttpCache setting is off.
+class HttpThread
+{
+public:
+	static HttpThread* getInstance();
+
+	// at exit: drops the transfers still running, joins the network thread and cleans up curl
+	static void shutdown();
+
+	// takes over transfer->handle, which must be fully configured
+	void add(const std::shared_ptr<HttpTransfer>& transfer);
+
+	// the transfer is dropped as soon as the network thread wakes up
+	void cancel(const std::shared_ptr<HttpTransfer>& transfer);
+
+private:
+	HttpThread();
+	~HttpThread();
+
+	void run();
+	void wakeUp();
+
+	// network thread only
+	void processQueues();
+	void checkCompleted();
+	void finish(const std::shared_ptr<HttpTransfer>& transfer, CURLcode result);
+	bool retryUnconditionally(const std::shared_ptr<HttpTransfer>& transfer);
+	void release(const std::shared_ptr<HttpTransfer>& transfer);
+
+	// answers the transfer from the cache, or sets up its revalidation
+	// returns true if the transfer is complete and must not be started
+	bool checkCache(const std::shared_ptr<HttpTransfer>& transfer);
+	bool serveFromCache(const std::shared_ptr<HttpTransfer>& transfer);
+
+	static int socketCallback(CURL* easy, curl_socket_t s, int what, void* userp, void* socketp);
+	static int timerCallback(CURLM* multi, long timeoutMs, void* userp);
+
+	static HttpThread* sInstance;
+
+	CURLM* mMulti;
+	std::unique_ptr<HttpCache> mCache;
+	int mEpollFd;
+	int mWakeFd;
+
+	// absolute deadline (ms, monotonic) requested by curl's timer callback, -1 if none
+	long long mDeadline;
+
+	boost::mutex mMutex;
+	bool mStopping;
+	std::vector< std::shared_ptr<HttpTransfer> > mSubmitted;
+	std::vector< std::shared_ptr<HttpTransfer> > mCancelled;
+
+	std::map< CURL*, std::shared_ptr<HttpTransfer> > mActive;
+
+	boost::thread mThread;
+};
@@ -1,11 +1,149 @@
 #include "ImageIO.h"
 
 #include <memory.h>
+#include <algorithm>
 
 #include "Log.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMAGEIO_SSE2
+#include <emmintrin.h>
+#endif
 
-std::vector<unsigned char> ImageIO::loadFromMemoryRGBA32(const unsigned char * data, const size_t size, size_t & width, size_t & height)
+// built with per function target attributes, so only used if the CPU says it has it
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define IMAGEIO_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define IMAGEIO_NEON
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+	// swaps the first and third byte of width 32 bit pixels
+	typedef void (*SwizzleRowFunc)(const unsigned char* src, unsigned char* dst, size_t width);
+
+	void swizzleRowScalar(const unsigned char* src, unsigned char* dst, size_t width)
+	{
+		for(size_t x = 0; x < width; x++)
+		{
+			dst[0] = src[2];
+			dst[1] = src[1];
+			dst[2] = src[0];
+			dst[3] = src[3];
+			src += 4;
+			dst += 4;
+		}
+	}
+
+#ifdef IMAGEIO_SSE2
+	// no byte shuffle before SSSE3, so the bytes are moved around with 32 bit shifts, 4 pixels at a time
+	void swizzleRowSSE2(const unsigned char* src, unsigned char* dst, size_t width)
+	{
+		const __m128i keep = _mm_set1_epi32((int)0xFF00FF00);
+		const __m128i low = _mm_set1_epi32(0x000000FF);
+
+		size_t x = 0;
+		for(; x + 4 <= width; x += 4)
+		{
+			const __m128i p = _mm_loadu_si128((const __m128i*)(src + x * 4));
+			const __m128i swapped = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(p, 16), low), _mm_slli_epi32(_mm_and_si128(p, low), 16));
+			_mm_storeu_si128((__m128i*)(dst + x * 4), _mm_or_si128(_mm_and_si128(p, keep), swapped));
+		}
+
+		swizzleRowScalar(src + x * 4, dst + x * 4, width - x);
+	}
+#endif
+
+#ifdef IMAGEIO_AVX2
+	__attribute__((target("avx2")))
+	void swizzleRowAVX2(const unsigned char* src, unsigned char* dst, size_t width)
+	{
+		const __m256i order = _mm256_setr_epi8(
+			2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+			2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+		size_t x = 0;
+		for(; x + 8 <= width; x += 8)
+		{
+			const __m256i p = _mm256_loadu_si256((const __m256i*)(src + x * 4));
+			_mm256_storeu_si256((__m256i*)(dst + x * 4), _mm256_shuffle_epi8(p, order));
+		}
+
+		swizzleRowScalar(src + x * 4, dst + x * 4, width - x);
+	}
+#endif
+
+#ifdef IMAGEIO_NEON
+	// de-interleaving loads put every channel in its own register, 16 pixels at a time
+	void swizzleRowNEON(const unsigned char* src, unsigned char* dst, size_t width)
+	{
+		size_t x = 0;
+		for(; x + 16 <= width; x += 16)
+		{
+			uint8x16x4_t p = vld4q_u8(src + x * 4);
+			const uint8x16_t first = p.val[0];
+			p.val[0] = p.val[2];
+			p.val[2] = first;
+			vst4q_u8(dst + x * 4, p);
+		}
+
+		swizzleRowScalar(src + x * 4, dst + x * 4, width - x);
+	}
+#endif
+
+	// NULL if it isn't built in or the CPU doesn't have it
+	SwizzleRowFunc getSwizzleRow(ImageIO::SwizzleKernel kernel)
+	{
+		switch(kernel)
+		{
+		case ImageIO::SWIZZLE_SCALAR:
+			return swizzleRowScalar;
+#ifdef IMAGEIO_SSE2
+		case ImageIO::SWIZZLE_SSE2:
+			return swizzleRowSSE2;
+#endif
+#ifdef IMAGEIO_AVX2
+		case ImageIO::SWIZZLE_AVX2:
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("avx2") ? swizzleRowAVX2 : NULL;
+#endif
+#ifdef IMAGEIO_NEON
+		case ImageIO::SWIZZLE_NEON:
+			return swizzleRowNEON;
+#endif
+		default:
+			return NULL;
+		}
+	}
+
+	SwizzleRowFunc selectSwizzleRow()
+	{
+		const ImageIO::SwizzleKernel preferred[] = { ImageIO::SWIZZLE_AVX2, ImageIO::SWIZZLE_SSE2, ImageIO::SWIZZLE_NEON };
+		for(size_t i = 0; i < sizeof(preferred) / sizeof(preferred[0]); i++)
+		{
+			SwizzleRowFunc func = getSwizzleRow(preferred[i]);
+			if(func != NULL)
+				return func;
+		}
+		return swizzleRowScalar;
+	}
+
+	void swizzleRowsWith(SwizzleRowFunc swizzleRow, const unsigned char* src, size_t srcPitch, unsigned char* dst, size_t dstPitch,
+		size_t width, size_t height, bool flip)
+	{
+		for(size_t y = 0; y < height; y++)
+		{
+			const size_t row = flip ? height - 1 - y : y;
+			swizzleRow(src + row * srcPitch, dst + y * dstPitch, width);
+		}
+	}
+}
+
+std::vector<unsigned char> ImageIO::loadFromMemoryRGBA32(const unsigned char * data, const size_t size, size_t & width, size_t & height, bool flip)
 {
 	std::vector<unsigned char> rawData;
 	width = 0;
@@ -21,7 +159,6 @@ std::vector<unsigned char> ImageIO::loadFromMemoryRGBA32(const unsigned char * d
 			if (fiBitmap != nullptr)
 			{
 				//loaded. convert to 32bit if necessary
-				FIBITMAP * fiConverted = nullptr;
 				if (FreeImage_GetBPP(fiBitmap) != 32)
 				{
 					FIBITMAP * fiConverted = FreeImage_ConvertTo32Bits(fiBitmap);
@@ -36,30 +173,12 @@ std::vector<unsigned char> ImageIO::loadFromMemoryRGBA32(const unsigned char * d
 				{
 					width = FreeImage_GetWidth(fiBitmap);
 					height = FreeImage_GetHeight(fiBitmap);
-					unsigned int pitch = FreeImage_GetPitch(fiBitmap);
-					//loop through scanlines and add all pixel data to the return vector
-					//this is necessary, because width*height*bpp might not be == pitch
-					unsigned char * tempData = new unsigned char[width * height * 4];
-					for (size_t i = 0; i < height; i++)
-					{
-						const BYTE * scanLine = FreeImage_GetScanLine(fiBitmap, i);
-						memcpy(tempData + (i * width * 4), scanLine, width * 4);
-					}
-					//convert from BGRA to RGBA
-					for(size_t i = 0; i < width*height; i++)
-					{
-						RGBQUAD bgra = ((RGBQUAD *)tempData)[i];
-						RGBQUAD rgba;
-						rgba.rgbBlue = bgra.rgbRed;
-						rgba.rgbGreen = bgra.rgbGreen;
-						rgba.rgbRed = bgra.rgbBlue;
-						rgba.rgbReserved = bgra.rgbReserved;
-						((RGBQUAD *)tempData)[i] = rgba;
-					}
-					rawData = std::vector<unsigned char>(tempData, tempData + width * height * 4);
+					//convert from BGRA to RGBA straight into the return vector, in a single pass
+					//scanlines are pitch bytes apart, width*bpp might not be == pitch
+					rawData.resize(width * height * 4);
+					swizzleRows32(FreeImage_GetBits(fiBitmap), FreeImage_GetPitch(fiBitmap), rawData.data(), width * 4, width, height, flip);
 					//free bitmap data
 					FreeImage_Unload(fiBitmap);
-					delete[] tempData;
 				}
 			}
 			else
@@ -77,17 +196,193 @@ std::vector<unsigned char> ImageIO::loadFromMemoryRGBA32(const unsigned char * d
 	return rawData;
 }
 
+void ImageIO::swizzleRows32(const unsigned char* src, size_t srcPitch, unsigned char* dst, size_t dstPitch,
+	size_t width, size_t height, bool flip)
+{
+	static const SwizzleRowFunc swizzleRow = selectSwizzleRow();
+	swizzleRowsWith(swizzleRow, src, srcPitch, dst, dstPitch, width, height, flip);
+}
+
+bool ImageIO::swizzleRows32Using(SwizzleKernel kernel, const unsigned char* src, size_t srcPitch, unsigned char* dst, size_t dstPitch,
+	size_t width, size_t height, bool flip)
+{
+	if(kernel == SWIZZLE_AUTO)
+	{
+		swizzleRows32(src, srcPitch, dst, dstPitch, width, height, flip);
+		return true;
+	}
+
+	SwizzleRowFunc swizzleRow = getSwizzleRow(kernel);
+	if(swizzleRow == NULL)
+		return false;
+
+	swizzleRowsWith(swizzleRow, src, srcPitch, dst, dstPitch, width, height, flip);
+	return true;
+}
+
+// whole rows at a time, memcpy is vectorized already
 void ImageIO::flipPixelsVert(unsigned char* imagePx, const size_t& width, const size_t& height)
 {
-	unsigned int temp;
-	unsigned int* arr = (unsigned int*)imagePx;
+	const size_t rowSize = width * 4;
+	std::vector<unsigned char> temp(rowSize);
 	for(size_t y = 0; y < height / 2; y++)
 	{
-		for(size_t x = 0; x < width; x++)
+		unsigned char* top = imagePx + y * rowSize;
+		unsigned char* bottom = imagePx + (height - 1 - y) * rowSize;
+		memcpy(temp.data(), top, rowSize);
+		memcpy(top, bottom, rowSize);
+		memcpy(bottom, temp.data(), rowSize);
+	}
+}
+
+// Averages boxes of about xFactor by yFactor pixels. The box edges are spread over the whole
+// source so every pixel lands in exactly one box, boxes are xFactor or xFactor + 1 wide.
+static void boxReduce32(const unsigned char* src, size_t srcWidth, size_t srcHeight, size_t srcPitch,
+	size_t xFactor, size_t yFactor, std::vector<unsigned char>& dst, size_t& dstWidth, size_t& dstHeight)
+{
+	dstWidth = srcWidth / xFactor;
+	dstHeight = srcHeight / yFactor;
+	dst.resize(dstWidth * dstHeight * 4);
+
+	// first source column of every box, and one past the last box
+	std::vector<size_t> boxStart(dstWidth + 1);
+	for(size_t x = 0; x <= dstWidth; x++)
+		boxStart[x] = x * srcWidth / dstWidth;
+
+	// the rows of a box are summed column by column first, then the columns of each box
+	std::vector<unsigned int> columnSums(srcWidth * 4);
+	for(size_t y = 0; y < dstHeight; y++)
+	{
+		const size_t start = y * srcHeight / dstHeight;
+		const size_t end = (y + 1) * srcHeight / dstHeight;
+
+		std::fill(columnSums.begin(), columnSums.end(), 0);
+		const size_t lineLength = srcWidth * 4;
+		for(size_t sy = start; sy < end; sy++)
+		{
+			const unsigned char* line = src + sy * srcPitch;
+			unsigned int* sums = columnSums.data();
+			for(size_t i = 0; i < lineLength; i++)
+				sums[i] += line[i];
+		}
+
+		const unsigned int boxHeight = (unsigned int)(end - start);
+		unsigned char* out = &dst[y * dstWidth * 4];
+		for(size_t x = 0; x < dstWidth; x++)
+		{
+			unsigned int sum[4] = { 0, 0, 0, 0 };
+			for(size_t sx = boxStart[x]; sx < boxStart[x + 1]; sx++)
+			{
+				for(int c = 0; c < 4; c++)
+					sum[c] += columnSums[sx * 4 + c];
+			}
+
+			const unsigned int count = (unsigned int)(boxStart[x + 1] - boxStart[x]) * boxHeight;
+			for(int c = 0; c < 4; c++)
+				out[x * 4 + c] = (unsigned char)((sum[c] + count / 2) / count);
+		}
+	}
+}
+
+// Two taps only see the source pixels next to each sample: shrinking by more than 2 would skip
+// most of them and alias, so those are box averaged down to less than twice the target size
+// first (FreeImage widens its bilinear filter instead, to the same effect).
+void ImageIO::resizeBilinear32(const unsigned char* src, size_t srcWidth, size_t srcHeight, size_t srcPitch,
+	unsigned char* dst, size_t dstWidth, size_t dstHeight, size_t dstPitch)
+{
+	if(srcWidth == 0 || srcHeight == 0 || dstWidth == 0 || dstHeight == 0)
+		return;
+
+	const size_t xFactor = std::max<size_t>(srcWidth / dstWidth, 1);
+	const size_t yFactor = std::max<size_t>(srcHeight / dstHeight, 1);
+	if(xFactor >= 2 || yFactor >= 2)
+	{
+		std::vector<unsigned char> reduced;
+		size_t reducedWidth, reducedHeight;
+		boxReduce32(src, srcWidth, srcHeight, srcPitch, xFactor, yFactor, reduced, reducedWidth, reducedHeight);
+		resizeBilinear32(reduced.data(), reducedWidth, reducedHeight, reducedWidth * 4, dst, dstWidth, dstHeight, dstPitch);
+		return;
+	}
+
+	// Fixed point (8 bit weights), done as a horizontal pass into two intermediate rows followed by a vertical blend.
+	// There are no hand written SIMD kernels here, unlike swizzleRows32. The inner loops run over plain arrays
+	// without branches and rely on the compiler's auto-vectorization (-O3) instead.
+
+	// source offsets and weights of every destination column
+	std::vector<size_t> xOffset0(dstWidth), xOffset1(dstWidth);
+	std::vector<unsigned short> xWeight(dstWidth);
+	const float xScale = (float)srcWidth / dstWidth;
+	for(size_t x = 0; x < dstWidth; x++)
+	{
+		float sx = (x + 0.5f) * xScale - 0.5f;
+		if(sx < 0)
+			sx = 0;
+
+		size_t x0 = (size_t)sx;
+		if(x0 > srcWidth - 1)
+			x0 = srcWidth - 1;
+		const size_t x1 = x0 + 1 < srcWidth ? x0 + 1 : x0;
+
+		xOffset0[x] = x0 * 4;
+		xOffset1[x] = x1 * 4;
+		xWeight[x] = (unsigned short)((sx - x0) * 256);
+	}
+
+	const size_t rowLength = dstWidth * 4;
+	std::vector<unsigned short> rowA(rowLength), rowB(rowLength);
+	size_t cachedA = (size_t)-1, cachedB = (size_t)-1;
+
+	auto scaleRow = [&](size_t y, std::vector<unsigned short>& row)
+	{
+		const unsigned char* line = src + y * srcPitch;
+		for(size_t x = 0; x < dstWidth; x++)
 		{
-			temp = arr[x + (y * width)];
-			arr[x + (y * width)] = arr[x + (height * width) - ((y + 1) * width)];
-			arr[x + (height * width) - ((y + 1) * width)] = temp;
+			const unsigned char* p0 = line + xOffset0[x];
+			const unsigned char* p1 = line + xOffset1[x];
+			const unsigned int w1 = xWeight[x];
+			const unsigned int w0 = 256 - w1;
+			unsigned short* out = &row[x * 4];
+			for(int c = 0; c < 4; c++)
+				out[c] = (unsigned short)(p0[c] * w0 + p1[c] * w1);
 		}
+	};
+
+	const float yScale = (float)srcHeight / dstHeight;
+	for(size_t y = 0; y < dstHeight; y++)
+	{
+		float sy = (y + 0.5f) * yScale - 0.5f;
+		if(sy < 0)
+			sy = 0;
+
+		size_t y0 = (size_t)sy;
+		if(y0 > srcHeight - 1)
+			y0 = srcHeight - 1;
+		const size_t y1 = y0 + 1 < srcHeight ? y0 + 1 : y0;
+		const unsigned int w1 = (unsigned int)((sy - y0) * 256);
+		const unsigned int w0 = 256 - w1;
+
+		// consecutive destination rows mostly share their source rows
+		if(cachedA != y0)
+		{
+			if(cachedB == y0)
+			{
+				rowA.swap(rowB);
+				std::swap(cachedA, cachedB);
+			}else{
+				scaleRow(y0, rowA);
+				cachedA = y0;
+			}
+		}
+		if(cachedB != y1)
+		{
+			scaleRow(y1, rowB);
+			cachedB = y1;
+		}
+
+		const unsigned short* a = rowA.data();
+		const unsigned short* b = rowB.data();
+		unsigned char* out = dst + y * dstPitch;
+		for(size_t i = 0; i < rowLength; i++)
+			out[i] = (unsigned char)((a[i] * w0 + b[i] * w1 + 32768) >> 16);
 	}
 }
@@ -6,6 +6,23 @@
 class ImageIO
 {
 public:
-	static std::vector<unsigned char> loadFromMemoryRGBA32(const unsigned char * data, const size_t size, size_t & width, size_t & height);
+	// Rows come out bottom first, the way OpenGL wants them, or top first if flip is set.
+	static std::vector<unsigned char> loadFromMemoryRGBA32(const unsigned char * data, const size_t size, size_t & width, size_t & height, bool flip = false);
 	static void flipPixelsVert(unsigned char* imagePx, const size_t& width, const size_t& height);
+
+	// Copies rows of 32 bit pixels swapping their first and third bytes (BGRA <-> RGBA), in reverse row order if flip is set.
+	// Uses AVX2, SSE2 or NEON when the CPU has them. Pitches are in bytes.
+	static void swizzleRows32(const unsigned char* src, size_t srcPitch, unsigned char* dst, size_t dstPitch,
+		size_t width, size_t height, bool flip);
+
+	// The kernels swizzleRows32 chooses from, AUTO being the one it uses. For benchmarks and tests.
+	enum SwizzleKernel { SWIZZLE_AUTO, SWIZZLE_SCALAR, SWIZZLE_SSE2, SWIZZLE_AVX2, SWIZZLE_NEON };
+	// Returns false, leaving dst untouched, if the kernel isn't built in or the CPU doesn't have it.
+	static bool swizzleRows32Using(SwizzleKernel kernel, const unsigned char* src, size_t srcPitch, unsigned char* dst, size_t dstPitch,
+		size_t width, size_t height, bool flip);
+
+	// Bilinear resize of 32 bit pixels, the channel order does not matter. Pitches are in bytes.
+	// Shrinking by 2 or more is box averaged first, so no source pixel is skipped.
+	static void resizeBilinear32(const unsigned char* src, size_t srcWidth, size_t srcHeight, size_t srcPitch,
+		unsigned char* dst, size_t dstWidth, size_t dstHeight, size_t dstPitch);
 };
\ No newline at end of file
@@ -1,15 +1,42 @@
-#include <iostream>
 #include <cerrno>
 #include <cstring>
 #include <cstdlib>
+#include <random>
 #include <sys/fcntl.h>
 #include <unistd.h>
 #include <sys/epoll.h>
 #include <sys/timerfd.h>
 #include <sys/socket.h>
+#include <netinet/in.h>
 #include <arpa/inet.h>
 
 #include "Lobby.h"
+#include "Log.h"
+#include "Metrics.h"
+
+// Announcements go to an administratively scoped multicast group, so they stay on the local network
+// and only reach hosts that joined it. IP_MULTICAST_LOOP lets several instances share one machine.
+#define LOBBY_GROUP "239.255.56.1"
+#define LOBBY_PORT 5601
+
+// Announcement packet, all integers in network byte order:
+//   0  magic "ESLB"
+//   4  u8  version
+//   5  u8  ttl, seconds the announcement is valid for, 0 means the host stopped playing
+//   6  u16 number of games
+//   8  u64 host id, opaque
+//  16  u32 sequence number, increases with every announcement of a host
+//  20  u32 reserved
+//  24  16 byte md5 of every game
+#define LOBBY_MAGIC "ESLB"
+#define LOBBY_VERSION 1
+#define LOBBY_HEADER_SIZE 24
+#define LOBBY_HASH_SIZE 16
+#define LOBBY_MAX_HASHES 64 // keeps a packet well under the usual MTU
+#define LOBBY_TTL 5 // seconds, we announce every second
+
+#define LOBBY_MAX_SESSIONS 256 // hosts beyond that are ignored until others leave
+#define LOBBY_RECV_BATCH 32
 
 
 static int make_socket_non_blocking ( int sfd )
@@ -20,7 +47,7 @@ static int make_socket_non_blocking ( int sfd )
 
     if (flags == -1)
     {
-        perror ("fcntl");
+        LOG_SUB(LogLobby, LogError) << "fcntl error: " << strerror(errno);
         return -1;
     }
 
@@ -29,13 +56,87 @@ static int make_socket_non_blocking ( int sfd )
 
     if (s == -1)
     {
-        perror ("fcntl");
+        LOG_SUB(LogLobby, LogError) << "fcntl error: " << strerror(errno);
         return -1;
     }
 
     return 0;
 }
 
+static uint64_t make_host_id()
+{
+    std::random_device random;
+    return ((uint64_t)random() << 32) | random();
+}
+
+static time_t monotonic_seconds()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec;
+}
+
+// true if a was sent after b, the sequence may wrap around
+static bool sequence_newer(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b) > 0;
+}
+
+static bool parse_hash(const std::string& hex, unsigned char* out)
+{
+    if (hex.size() != LOBBY_HASH_SIZE * 2)
+        return false;
+
+    for (int i = 0; i < LOBBY_HASH_SIZE; i++) {
+        char byte[3] = { hex[i * 2], hex[i * 2 + 1], 0 };
+        char* end;
+        out[i] = (unsigned char)strtoul(byte, &end, 16);
+        if (*end != '\0')
+            return false;
+    }
+
+    return true;
+}
+
+static std::string format_hash(const unsigned char* hash)
+{
+    static const char hexchars[] = "0123456789abcdef";
+
+    std::string result;
+    for (int i = 0; i < LOBBY_HASH_SIZE; i++) {
+        result += hexchars[hash[i] >> 4];
+        result += hexchars[hash[i] & 0xF];
+    }
+
+    return result;
+}
+
+static void write_u16(unsigned char* out, uint16_t value)
+{
+    value = htons(value);
+    memcpy(out, &value, sizeof(value));
+}
+
+static void write_u32(unsigned char* out, uint32_t value)
+{
+    value = htonl(value);
+    memcpy(out, &value, sizeof(value));
+}
+
+static uint16_t read_u16(const unsigned char* in)
+{
+    uint16_t value;
+    memcpy(&value, in, sizeof(value));
+    return ntohs(value);
+}
+
+static uint32_t read_u32(const unsigned char* in)
+{
+    uint32_t value;
+    memcpy(&value, in, sizeof(value));
+    return ntohl(value);
+}
+
 LobbyThread *LobbyThread::instance = NULL;
 
 
@@ -46,17 +147,17 @@ LobbyThread *LobbyThread::getInstance() {
     return LobbyThread::instance;
 }
 
-LobbyThread::LobbyThread() {
+LobbyThread::LobbyThread() : mSessions(new SessionList()), mBroadcasting(false), mHostId(make_host_id()), mSequence(0) {
 	mefd = epoll_create1(EPOLL_CLOEXEC);
 	if (mefd < 0) {
-		std::cerr << "epoll_create error: " << strerror(errno) << std::endl;
+		LOG_SUB(LogLobby, LogError) << "epoll_create error: " << strerror(errno);
 		exit(1);
 	}
 
-  // Expire old sessions after 5 seconds
+  // Expire sessions whose announcements stopped
   mexpireFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
 	if (mexpireFd < 0) {
-		std::cerr << "timerfd_create error: " << strerror(errno) << std::endl;
+		LOG_SUB(LogLobby, LogError) << "timerfd_create error: " << strerror(errno);
 		exit(1);
 	}
 
@@ -69,7 +170,7 @@ LobbyThread::LobbyThread() {
   // Tell other players when we are playing a game
 	mtfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
 	if (mtfd < 0) {
-		std::cerr << "timerfd_create error: " << strerror(errno) << std::endl;
+		LOG_SUB(LogLobby, LogError) << "timerfd_create error: " << strerror(errno);
 		exit(1);
 	}
 
@@ -78,41 +179,51 @@ LobbyThread::LobbyThread() {
 	ev.data.fd = mtfd;
 	epoll_ctl(mefd, EPOLL_CTL_ADD, mtfd, &ev);
 
-  // Broadcast / receive broadcasts over udp
+  // Send / receive announcements over udp multicast
 	m_broadcast_fd = socket(AF_INET, SOCK_DGRAM, 0);
 	if (m_broadcast_fd == -1) {
-		std::cerr << "socket error: " << strerror(errno) << std::endl;
+		LOG_SUB(LogLobby, LogError) << "socket error: " << strerror(errno);
 		exit(1);
 	}
 
   int reuse = 1;
-	if((setsockopt(m_broadcast_fd, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse))) == -1) {
-		std::cerr << "setsockopt SO_REUSEPORT error: " << strerror(errno) << std::endl;
+	if((setsockopt(m_broadcast_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse))) == -1) {
+		LOG_SUB(LogLobby, LogError) << "setsockopt SO_REUSEADDR error: " << strerror(errno);
 		exit(1);
 	}
 
-	int broadcast = 1;
-	if((setsockopt(m_broadcast_fd, SOL_SOCKET, SO_BROADCAST, &broadcast, sizeof(broadcast))) == -1) {
-		std::cerr << "setsockopt SO_BROADCAST error: " << strerror(errno) << std::endl;
+	if((setsockopt(m_broadcast_fd, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse))) == -1) {
+		LOG_SUB(LogLobby, LogError) << "setsockopt SO_REUSEPORT error: " << strerror(errno);
 		exit(1);
 	}
 	make_socket_non_blocking(m_broadcast_fd);
 
-	struct sockaddr_in srvaddr;        // Broadcast Server Address
-	struct sockaddr_in dstaddr;        // Broadcast Destination Address
-
+	struct sockaddr_in srvaddr;
 	memset( &srvaddr, 0, sizeof( srvaddr ) );
-	memset( &dstaddr, 0, sizeof( dstaddr ) );
 
 	srvaddr.sin_family = AF_INET;
-	srvaddr.sin_port = htons(5601);
-	srvaddr.sin_addr.s_addr = INADDR_BROADCAST;
+	srvaddr.sin_port = htons(LOBBY_PORT);
+	srvaddr.sin_addr.s_addr = htonl(INADDR_ANY);
 
 	if( bind(m_broadcast_fd, (struct sockaddr*) &srvaddr, sizeof(srvaddr)) == -1 ) {
-		std::cerr << "bind error: " << strerror(errno) << std::endl;
+		LOG_SUB(LogLobby, LogError) << "bind error: " << strerror(errno);
 		exit(1);
 	}
 
+	struct ip_mreq group;
+	memset(&group, 0, sizeof(group));
+	group.imr_multiaddr.s_addr = inet_addr(LOBBY_GROUP);
+	group.imr_interface.s_addr = htonl(INADDR_ANY);
+	if((setsockopt(m_broadcast_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &group, sizeof(group))) == -1) {
+		// no multicast route (no network yet?), we can still announce but won't see anyone
+		LOG_SUB(LogLobby, LogError) << "setsockopt IP_ADD_MEMBERSHIP error: " << strerror(errno);
+	}
+
+	unsigned char ttl = 1; // don't leave the local network
+	unsigned char loop = 1;
+	setsockopt(m_broadcast_fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+	setsockopt(m_broadcast_fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+
 	memset(&ev, 0, sizeof(epoll_event));
 	ev.data.fd = m_broadcast_fd;
 	ev.events = EPOLLIN | EPOLLET;
@@ -128,7 +239,15 @@ LobbyThread::~LobbyThread() {
 }
 
 void LobbyThread::startBroadcast(std::string gameHash) {
-	m_gameHash = gameHash;
+	startBroadcast(std::vector<std::string>(1, gameHash));
+}
+
+void LobbyThread::startBroadcast(const std::vector<std::string>& gameHashes) {
+	{
+		boost::mutex::scoped_lock lock(mGameHashMutex);
+		m_gameHashes = gameHashes;
+		mBroadcasting = true;
+	}
 
 	struct itimerspec new_timeout;
 	new_timeout.it_value.tv_sec = 1;
@@ -137,15 +256,22 @@ void LobbyThread::startBroadcast(std::string gameHash) {
 	new_timeout.it_interval.tv_nsec = 0;
 
 	if (timerfd_settime(mtfd, 0, &new_timeout, NULL) != 0) {
-		std::cerr << "timerfd_settime error: " << strerror(errno) << std::endl;
+		LOG_SUB(LogLobby, LogError) << "timerfd_settime error: " << strerror(errno);
 	}
 }
 
 void LobbyThread::stopBroadcast() {
 	itimerspec new_timeout{{0}};
 	if (timerfd_settime(mtfd, 0, &new_timeout, NULL) != 0) {
-		std::cerr << "timerfd_settime error: " << strerror(errno) << std::endl;
+		LOG_SUB(LogLobby, LogError) << "timerfd_settime error: " << strerror(errno);
 	}
+
+	// a timer tick in progress either sent before we got the lock, with a lower sequence number,
+	// or sees mBroadcasting cleared and sends nothing: no game list can follow the stop packet
+	boost::mutex::scoped_lock lock(mGameHashMutex);
+	mBroadcasting = false;
+	m_gameHashes.clear();
+	sendAnnouncement(0);
 }
 
 void LobbyThread::subscribeStartedPlaying(PlayerStartedPlayingFunction callback) {
@@ -156,72 +282,260 @@ void LobbyThread::subscribeStoppedPlaying(PlayerStoppedPlayingFunction callback)
   mStoppedPlayingCallbacks.push_back(callback);
 }
 
+void LobbyThread::processEvents() {
+  Event event;
+  while (mEvents.pop(event)) {
+    auto& callbacks = event.started ? mStartedPlayingCallbacks : mStoppedPlayingCallbacks;
+    for (auto callback = callbacks.begin(); callback != callbacks.end(); callback++) {
+      (*callback)(event.session);
+    }
+  }
+}
+
+std::shared_ptr<const SessionList> LobbyThread::getSessions() const {
+  return std::atomic_load(&mSessions);
+}
+
+void LobbyThread::publish(bool started, const std::shared_ptr<const Session>& session) {
+  // the UI only ever sees a complete list, it is never modified once stored
+  std::shared_ptr<SessionList> sessions(new SessionList());
+  for (auto it = mActiveSessions.begin(); it != mActiveSessions.end(); it++) {
+    sessions->push_back((*it).second.session);
+  }
+  std::atomic_store(&mSessions, std::shared_ptr<const SessionList>(sessions));
+
+  Event event;
+  event.started = started;
+  event.session = session;
+  mBacklog.push_back(event);
+
+  flushBacklog();
+}
+
+void LobbyThread::flushBacklog() {
+  // keep the order: nothing new goes in while older events are still waiting for room
+  while (!mBacklog.empty() && mEvents.push(std::move(mBacklog.front()))) {
+    mBacklog.pop_front();
+  }
+}
+
 void LobbyThread::expireSessions() {
-  timespec currentTime;
-  clock_gettime(CLOCK_MONOTONIC, &currentTime);
+  static Metrics::Counter& sessionsExpired = Metrics::counter("lobby.sessions_expired");
 
-  for (auto it = mActiveSessions.begin(); it!=mActiveSessions.end(); it++) {
-    if ((currentTime.tv_sec - (*it).second->lastSeen.tv_sec) > 5) {
-      for(auto callback = mStoppedPlayingCallbacks.begin(); callback != mStoppedPlayingCallbacks.end(); callback++) {
-        (*callback)((*it).second);
-      }
-      mActiveSessions.erase(it);
+  const time_t now = monotonic_seconds();
+
+  auto it = mActiveSessions.begin();
+  while (it != mActiveSessions.end()) {
+    if (now >= (*it).second.expires) {
+      LOG_SUB(LogLobby, LogDebug) << (*it).second.session->peer << " stopped playing";
+      sessionsExpired.add();
+
+      std::shared_ptr<const Session> session = (*it).second.session;
+      it = mActiveSessions.erase(it);
+      publish(false, session);
+    } else {
+      it++;
     }
   }
 
-  if (mActiveSessions.size() == 0) {
+  // the UI thread was busy for a while, try again
+  flushBacklog();
+
+  // keep ticking until the UI has seen every event
+  if (mActiveSessions.size() == 0 && mBacklog.empty()) {
     itimerspec new_timeout{{0}};
     if (timerfd_settime(mexpireFd, 0, &new_timeout, NULL) != 0) {
-      std::cerr << "timerfd_settime error: " << strerror(errno) << std::endl;
+      LOG_SUB(LogLobby, LogError) << "timerfd_settime error: " << strerror(errno);
     }
   }
 }
 
+void LobbyThread::armExpireTimer() {
+    struct itimerspec new_timeout;
+    new_timeout.it_value.tv_sec = 1;
+    new_timeout.it_value.tv_nsec = 0;
+    new_timeout.it_interval.tv_sec = 1;
+    new_timeout.it_interval.tv_nsec = 0;
+
+    if (timerfd_settime(mexpireFd, 0, &new_timeout, NULL) != 0) {
+      LOG_SUB(LogLobby, LogError) << "timerfd_settime error: " << strerror(errno);
+    }
+}
+
 void LobbyThread::handleTimeout() {
-	std::cerr << "TIME TO BROADCAST" << std::endl;
+	boost::mutex::scoped_lock lock(mGameHashMutex);
+	if (!mBroadcasting)
+		return;
 
-	struct sockaddr_in srvaddr;
-	memset( &srvaddr, 0, sizeof( srvaddr ) );
-	srvaddr.sin_family = AF_INET;
-	srvaddr.sin_port = htons(5601);
-	srvaddr.sin_addr.s_addr = INADDR_BROADCAST;
+	sendAnnouncement(LOBBY_TTL);
+}
+
+// called from the lobby thread, and from the UI thread by stopBroadcast
+void LobbyThread::sendAnnouncement(uint8_t ttl) {
+	static Metrics::Counter& packetsOut = Metrics::counter("lobby.packets_out");
+
+	unsigned char packet[LOBBY_HEADER_SIZE + LOBBY_MAX_HASHES * LOBBY_HASH_SIZE];
+	memset(packet, 0, LOBBY_HEADER_SIZE);
+
+	uint16_t count = 0;
+	for (auto it = m_gameHashes.begin(); it != m_gameHashes.end() && count < LOBBY_MAX_HASHES; it++) {
+		if (parse_hash(*it, packet + LOBBY_HEADER_SIZE + count * LOBBY_HASH_SIZE))
+			count++;
+	}
+
+	memcpy(packet, LOBBY_MAGIC, 4);
+	packet[4] = LOBBY_VERSION;
+	packet[5] = ttl;
+	write_u16(packet + 6, count);
+	memcpy(packet + 8, &mHostId, sizeof(mHostId));
+	write_u32(packet + 16, ++mSequence);
+
+	struct sockaddr_in dstaddr;
+	memset( &dstaddr, 0, sizeof( dstaddr ) );
+	dstaddr.sin_family = AF_INET;
+	dstaddr.sin_port = htons(LOBBY_PORT);
+	dstaddr.sin_addr.s_addr = inet_addr(LOBBY_GROUP);
 
-	if (sendto(m_broadcast_fd, m_gameHash.c_str(), m_gameHash.length(), 0, ( struct sockaddr * )&srvaddr, sizeof(srvaddr)) < 0) {
-		std::cerr << "sendto error: " << strerror(errno) << std::endl;
+	if (sendto(m_broadcast_fd, packet, LOBBY_HEADER_SIZE + count * LOBBY_HASH_SIZE, 0, ( struct sockaddr * )&dstaddr, sizeof(dstaddr)) < 0) {
+		LOG_SUB(LogLobby, LogError) << "sendto error: " << strerror(errno);
 		return;
 	}
+
+	packetsOut.add();
 }
 
-void LobbyThread::handleIncomingBroadcast(std::string gameHash, std::string peer) {
-		std::cerr << "SAW ANNOUNCEMENT FROM GAME" << gameHash << peer << std::endl;
+void LobbyThread::receiveAnnouncements() {
+    static Metrics::Counter& packetsIn = Metrics::counter("lobby.packets_in");
+    static Metrics::Counter& packetsInvalid = Metrics::counter("lobby.packets_invalid");
+
+    unsigned char buffers[LOBBY_RECV_BATCH][LOBBY_HEADER_SIZE + LOBBY_MAX_HASHES * LOBBY_HASH_SIZE];
+    struct sockaddr_in peers[LOBBY_RECV_BATCH];
+    struct iovec iovecs[LOBBY_RECV_BATCH];
+    struct mmsghdr messages[LOBBY_RECV_BATCH];
+
+    // edge triggered: we won't hear about this socket again until it has been read dry
+    while (1) {
+      memset(messages, 0, sizeof(messages));
+      for (int i = 0; i < LOBBY_RECV_BATCH; i++) {
+        iovecs[i].iov_base = buffers[i];
+        iovecs[i].iov_len = sizeof(buffers[i]);
+        messages[i].msg_hdr.msg_iov = &iovecs[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+        messages[i].msg_hdr.msg_name = &peers[i];
+        messages[i].msg_hdr.msg_namelen = sizeof(peers[i]);
+      }
+
+      int count = recvmmsg(m_broadcast_fd, messages, LOBBY_RECV_BATCH, MSG_DONTWAIT, NULL);
+      if (count < 0) {
+        if (errno == EINTR)
+          continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+          LOG_SUB(LogLobby, LogError) << "recvmmsg error: " << strerror(errno);
+        return;
+      }
+
+      for (int i = 0; i < count; i++) {
+        packetsIn.add();
+
+        const unsigned char* data = buffers[i];
+        const size_t length = messages[i].msg_len;
+
+        // anything that isn't exactly a version 1 announcement is dropped, truncated packets included
+        if (length < LOBBY_HEADER_SIZE || (messages[i].msg_hdr.msg_flags & MSG_TRUNC) || memcmp(data, LOBBY_MAGIC, 4) != 0 || data[4] != LOBBY_VERSION) {
+          packetsInvalid.add();
+          continue;
+        }
+
+        const uint16_t hashCount = read_u16(data + 6);
+        if (hashCount > LOBBY_MAX_HASHES || length != LOBBY_HEADER_SIZE + (size_t)hashCount * LOBBY_HASH_SIZE) {
+          packetsInvalid.add();
+          continue;
+        }
 
-    auto it = mActiveSessions.find(peer);
+        Announcement announcement;
+        announcement.ttl = data[5];
+        memcpy(&announcement.hostId, data + 8, sizeof(announcement.hostId));
+        announcement.sequence = read_u32(data + 16);
+        for (int h = 0; h < hashCount; h++) {
+          announcement.gameHashes.push_back(format_hash(data + LOBBY_HEADER_SIZE + h * LOBBY_HASH_SIZE));
+        }
+
+        char peer_string[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &peers[i].sin_addr, peer_string, INET_ADDRSTRLEN);
+
+        handleAnnouncement(announcement, peer_string);
+      }
+    }
+}
+
+void LobbyThread::handleAnnouncement(const Announcement& announcement, const std::string& peer) {
+    static Metrics::Counter& packetsStale = Metrics::counter("lobby.packets_stale");
+    static Metrics::Counter& sessionsRejected = Metrics::counter("lobby.sessions_rejected");
+
+    // our own, looped back
+    if (announcement.hostId == mHostId)
+      return;
+
+    const time_t now = monotonic_seconds();
+
+    auto it = mActiveSessions.find(announcement.hostId);
     if (it != mActiveSessions.end()) {
-      clock_gettime(CLOCK_MONOTONIC, &(*it).second->lastSeen);
+      ActiveSession& active = (*it).second;
+      if (!sequence_newer(announcement.sequence, active.sequence)) {
+        packetsStale.add();
+        return;
+      }
+
+      active.sequence = announcement.sequence;
+
+      if (announcement.ttl == 0 || announcement.gameHashes.empty()) {
+        LOG_SUB(LogLobby, LogDebug) << peer << " stopped playing";
+        std::shared_ptr<const Session> session = active.session;
+        mActiveSessions.erase(it);
+        publish(false, session);
+        return;
+      }
+
+      active.expires = now + announcement.ttl;
+
+      if (announcement.gameHashes == active.session->gameHashes && peer == active.session->peer)
+        return;
+
+      // switched games: the old session ends and a new one starts
+      std::shared_ptr<Session> session(new Session(*active.session));
+      session->peer = peer;
+      session->gameHashes = announcement.gameHashes;
+
+      std::shared_ptr<const Session> previous = active.session;
+      active.session = session;
+      publish(false, previous);
+      publish(true, session);
       return;
     }
 
-    auto session = new Session();
-    session->gameHash = gameHash;
-    session->peer = peer;
-    clock_gettime(CLOCK_MONOTONIC, &session->lastSeen);
-    mActiveSessions[peer] = session;
+    if (announcement.ttl == 0 || announcement.gameHashes.empty())
+      return;
 
-    for(auto it = mStartedPlayingCallbacks.begin(); it != mStartedPlayingCallbacks.end(); it++) {
-      (*it)(session);
+    if (mActiveSessions.size() >= LOBBY_MAX_SESSIONS) {
+      sessionsRejected.add();
+      return;
     }
 
-    // Configure session to expire
-    // FIXME: Is this too agressive?
-    struct itimerspec new_timeout;
-    new_timeout.it_value.tv_sec = 1;
-    new_timeout.it_value.tv_nsec = 0;
-    new_timeout.it_interval.tv_sec = 1;
-    new_timeout.it_interval.tv_nsec = 0;
+    LOG_SUB(LogLobby, LogDebug) << peer << " started playing " << announcement.gameHashes.front();
 
-    if (timerfd_settime(mexpireFd, 0, &new_timeout, NULL) != 0) {
-      std::cerr << "timerfd_settime error: " << strerror(errno) << std::endl;
-    }
+    std::shared_ptr<Session> session(new Session());
+    session->hostId = announcement.hostId;
+    session->peer = peer;
+    session->gameHashes = announcement.gameHashes;
+
+    ActiveSession& active = mActiveSessions[announcement.hostId];
+    active.session = session;
+    active.sequence = announcement.sequence;
+    active.expires = now + announcement.ttl;
+
+    publish(true, session);
+
+    armExpireTimer();
 }
 
 void LobbyThread::run() {
@@ -234,12 +548,10 @@ void LobbyThread::run() {
       if (errno == EINTR)
         continue;
 
-			std::cerr << "An error occured: " << strerror(errno) << std::endl;
+			LOG_SUB(LogLobby, LogError) << "epoll_wait error: " << strerror(errno);
 			return;
 		}
 		for (int i = 0; i < numEvents; ++i) {
-			std::cerr << "An event occured: " << events[i].data.fd << std::endl;
-
 			if (events[i].data.fd == mtfd) {
 				char data[8];
 				read(mtfd, &data, 8);
@@ -255,15 +567,7 @@ void LobbyThread::run() {
 			}
 
 			if (events[i].data.fd == m_broadcast_fd) {
-				char data[33];
-				struct sockaddr peer;
-				socklen_t peer_len = sizeof(peer);
-				char peer_string[INET_ADDRSTRLEN];
-
-				recvfrom(m_broadcast_fd, &data, sizeof(data), 0, &peer, &peer_len);
-				inet_ntop(peer.sa_family, &(((struct sockaddr_in *)&peer)->sin_addr), peer_string, INET_ADDRSTRLEN);
-
-				this->handleIncomingBroadcast(std::string(data), std::string(peer_string));
+				this->receiveAnnouncements();
 			}
 		}
 	}
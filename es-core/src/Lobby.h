@@ -1,43 +1,98 @@
 #pragma once
 
 #include <time.h>
+#include <stdint.h>
 
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <vector>
 #include <boost/thread.hpp>
 
+#include "SPSCQueue.h"
 
+
+// Immutable once published, the UI and the lobby thread can share it freely.
+// A host whose game list changes gets a new Session.
 struct Session {
 public:
-	std::string peer;
-	std::string gameHash;
-	timespec lastSeen;
+	uint64_t hostId; // random per running instance, several can share an address
+	std::string peer; // ip address
+	std::vector<std::string> gameHashes;
 };
 
-typedef std::function<void(Session *session)> PlayerStartedPlayingFunction;
-typedef std::function<void(Session *session)> PlayerStoppedPlayingFunction;
+typedef std::vector< std::shared_ptr<const Session> > SessionList;
+
+typedef std::function<void(const std::shared_ptr<const Session>& session)> PlayerStartedPlayingFunction;
+typedef std::function<void(const std::shared_ptr<const Session>& session)> PlayerStoppedPlayingFunction;
 
 
+// Sessions are owned by the lobby thread. Changes reach the UI thread through a lock-free queue
+// drained by processEvents(), so the subscribed callbacks always run on the UI thread.
+//
+// Hosts announce the games they are playing once a second to a multicast group, see Lobby.cpp for
+// the packet format. A session lasts as long as the TTL of its last announcement, and stale or
+// replayed announcements are told apart by their sequence number.
 class LobbyThread {
 public:
 	LobbyThread();
 	~LobbyThread();
 
 	void startBroadcast(std::string gameHash);
+	void startBroadcast(const std::vector<std::string>& gameHashes);
+	// also tells the other hosts right away, instead of letting our session time out
 	void stopBroadcast();
 
 	void subscribeStartedPlaying(PlayerStartedPlayingFunction callback);
 	void subscribeStoppedPlaying(PlayerStoppedPlayingFunction callback);
 
+	// UI thread, once per frame: runs the callbacks for everything that happened since the last call
+	void processEvents();
+
+	// the sessions as of the last change, safe to call from any thread
+	std::shared_ptr<const SessionList> getSessions() const;
+
   static LobbyThread *getInstance();
 private:
   static LobbyThread *instance;
 
+	struct ActiveSession {
+		std::shared_ptr<const Session> session;
+		uint32_t sequence;
+		time_t expires; // CLOCK_MONOTONIC seconds
+	};
+
+	struct Announcement {
+		uint64_t hostId;
+		uint32_t sequence;
+		uint8_t ttl;
+		std::vector<std::string> gameHashes;
+	};
+
+	struct Event {
+		bool started;
+		std::shared_ptr<const Session> session;
+	};
+
+	// lobby thread only
+	std::map<uint64_t, ActiveSession> mActiveSessions;
+	std::deque<Event> mBacklog; // events that didn't fit in the queue yet
+
+	SPSCQueue<Event, 256> mEvents;
+	std::shared_ptr<const SessionList> mSessions; // accessed through std::atomic_load/store
 
-	std::map<std::string, Session*> mActiveSessions;
+	// UI thread only
 	std::vector<PlayerStartedPlayingFunction> mStartedPlayingCallbacks;
 	std::vector<PlayerStoppedPlayingFunction> mStoppedPlayingCallbacks;
 
 	boost::thread *mThreadHandle;
-	std::string m_gameHash;
+	// held from reading the games to the sendto, so announcements leave in sequence order
+	boost::mutex mGameHashMutex;
+	std::vector<std::string> m_gameHashes;
+	bool mBroadcasting; // false from stopBroadcast on: a timer tick already in flight sends nothing
+	const uint64_t mHostId;
+	std::atomic<uint32_t> mSequence;
 	int mefd;
 	int mexpireFd;
 	int mtfd;
@@ -45,6 +100,11 @@ private:
 
 	void expireSessions();
 	void handleTimeout();
-	void handleIncomingBroadcast(std::string gameHash, std::string peer);
+	void sendAnnouncement(uint8_t ttl); // mGameHashMutex must be held
+	void receiveAnnouncements();
+	void handleAnnouncement(const Announcement& announcement, const std::string& peer);
+	void armExpireTimer();
+	void publish(bool started, const std::shared_ptr<const Session>& session);
+	void flushBacklog();
 	void run();
 };
@@ -2,14 +2,247 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <iostream>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <boost/thread.hpp>
 #include "platform.h"
 
-LogLevel Log::reportingLevel = LogInfo;
-FILE* Log::file = NULL; //fopen(getLogPath().c_str(), "w");
+#define LOG_QUEUE_SIZE 4096 // messages, must be a power of two
+#define LOG_MAX_SIZE (2 * 1024 * 1024) // bytes before the log is rotated
+#define LOG_ROTATIONS 2 // es_log.txt.1 and es_log.txt.2 are kept
 
-LogLevel Log::getReportingLevel()
+static const char* const levelNames[] = { "error", "warning", "info", "debug" };
+static const char* const subsystemNames[LogSubsystemCount] = { "general", "audio", "lobby", "network", "scraper", "theme" };
+
+static std::atomic<int> reportingLevels[LogSubsystemCount] = { {LogInfo}, {LogInfo}, {LogInfo}, {LogInfo}, {LogInfo}, {LogInfo} };
+
+namespace
+{
+	// Bounded multi-producer queue (Vyukov): producers claim a slot with a CAS on mEnqueuePos, the writer
+	// thread is the only consumer. The slot sequence tells whose turn it is, so no lock is ever taken
+	// unless the writer is asleep and has to be woken up.
+	class LogWriter
+	{
+	public:
+		LogWriter(const std::string& path, FILE* file) : mPath(path), mFile(file), mSize(0), mEnqueuePos(0), mDequeuePos(0),
+			mWrittenPos(0), mDropped(0), mIdle(false), mRunning(true)
+		{
+			for(size_t i = 0; i < LOG_QUEUE_SIZE; i++)
+				mSlots[i].sequence.store(i, std::memory_order_relaxed);
+
+			mThread = boost::thread(&LogWriter::run, this);
+		}
+
+		// false if the queue is full
+		bool push(LogLevel level, LogSubsystem subsystem, std::string&& text)
+		{
+			Slot* slot;
+			size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+			while(true)
+			{
+				slot = &mSlots[pos & (LOG_QUEUE_SIZE - 1)];
+				const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+				const intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+
+				if(diff == 0)
+				{
+					if(mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						break;
+				}else if(diff < 0)
+				{
+					return false;
+				}else{
+					pos = mEnqueuePos.load(std::memory_order_relaxed);
+				}
+			}
+
+			slot->level = level;
+			slot->subsystem = subsystem;
+			slot->time = std::chrono::system_clock::now();
+			slot->text = std::move(text);
+			slot->sequence.store(pos + 1, std::memory_order_release);
+
+			// pairs with the writer setting mIdle before its last look at the queue
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if(mIdle.load(std::memory_order_relaxed))
+			{
+				boost::mutex::scoped_lock lock(mMutex);
+				mWakeUp.notify_one();
+			}
+
+			return true;
+		}
+
+		void dropped()
+		{
+			mDropped.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		void flush()
+		{
+			const size_t target = mEnqueuePos.load(std::memory_order_acquire);
+			while(mWrittenPos.load(std::memory_order_acquire) < target)
+			{
+				{
+					boost::mutex::scoped_lock lock(mMutex);
+					mWakeUp.notify_one();
+				}
+				boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+			}
+		}
+
+		// writes whatever is left and closes the file
+		void stop()
+		{
+			{
+				boost::mutex::scoped_lock lock(mMutex);
+				mRunning = false;
+				mWakeUp.notify_one();
+			}
+			mThread.join();
+
+			if(mFile != NULL)
+				fclose(mFile);
+			mFile = NULL;
+		}
+
+	private:
+		struct Slot
+		{
+			std::atomic<size_t> sequence;
+			LogLevel level;
+			LogSubsystem subsystem;
+			std::chrono::system_clock::time_point time;
+			std::string text;
+		};
+
+		void run()
+		{
+			while(true)
+			{
+				if(drain())
+					continue;
+
+				boost::mutex::scoped_lock lock(mMutex);
+				if(!mRunning)
+					break;
+
+				mIdle.store(true, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+
+				// the timeout only matters if a wake up was missed
+				if(!hasPending())
+					mWakeUp.timed_wait(lock, boost::posix_time::milliseconds(100));
+
+				mIdle.store(false, std::memory_order_relaxed);
+			}
+
+			drain();
+		}
+
+		bool hasPending()
+		{
+			const Slot& slot = mSlots[mDequeuePos & (LOG_QUEUE_SIZE - 1)];
+			return slot.sequence.load(std::memory_order_acquire) == mDequeuePos + 1;
+		}
+
+		// returns false if there was nothing to write
+		bool drain()
+		{
+			bool wrote = false;
+			while(hasPending())
+			{
+				Slot& slot = mSlots[mDequeuePos & (LOG_QUEUE_SIZE - 1)];
+				write(slot.level, slot.subsystem, slot.time, slot.text);
+				slot.text.clear();
+				slot.sequence.store(mDequeuePos + LOG_QUEUE_SIZE, std::memory_order_release);
+				mDequeuePos++;
+				wrote = true;
+
+				if(mSize > LOG_MAX_SIZE)
+					rotate();
+			}
+
+			const unsigned int dropped = mDropped.exchange(0, std::memory_order_relaxed);
+			if(dropped > 0)
+			{
+				write(LogWarning, LogGeneral, std::chrono::system_clock::now(), std::to_string(dropped) + " log messages dropped, the log queue was full");
+				wrote = true;
+			}
+
+			if(wrote && mFile != NULL)
+				fflush(mFile);
+
+			mWrittenPos.store(mDequeuePos, std::memory_order_release);
+			return wrote;
+		}
+
+		// all the formatting happens here, on the writer thread
+		void write(LogLevel level, LogSubsystem subsystem, const std::chrono::system_clock::time_point& time, const std::string& text)
+		{
+			const time_t seconds = std::chrono::system_clock::to_time_t(time);
+			const int millis = (int)(std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count() % 1000);
+			// localtime() returns shared static storage that any other thread calling it can overwrite
+			tm localTime;
+#ifdef WIN32
+			localtime_s(&localTime, &seconds);
+#else
+			localtime_r(&seconds, &localTime);
+#endif
+			const tm* local = &localTime;
+
+			char prefix[64];
+			if(subsystem == LogGeneral)
+				snprintf(prefix, sizeof(prefix), "%02d:%02d:%02d.%03d lvl%d: \t", local->tm_hour, local->tm_min, local->tm_sec, millis, level);
+			else
+				snprintf(prefix, sizeof(prefix), "%02d:%02d:%02d.%03d lvl%d: \t[%s] ", local->tm_hour, local->tm_min, local->tm_sec, millis, level, subsystemNames[subsystem]);
+
+			if(mFile != NULL)
+				mSize += fprintf(mFile, "%s%s\n", prefix, text.c_str());
+
+			//if it's an error, also print to console
+			//print all messages if using --debug
+			if(level == LogError || Log::getReportingLevel(subsystem) >= LogDebug)
+				fprintf(stderr, "%s%s\n", prefix, text.c_str());
+		}
+
+		void rotate()
+		{
+			fclose(mFile);
+
+			for(int i = LOG_ROTATIONS - 1; i > 0; i--)
+				rename((mPath + "." + std::to_string(i)).c_str(), (mPath + "." + std::to_string(i + 1)).c_str());
+			rename(mPath.c_str(), (mPath + ".1").c_str());
+
+			mFile = fopen(mPath.c_str(), "w");
+			mSize = 0;
+		}
+
+		const std::string mPath;
+		FILE* mFile;
+		long mSize;
+
+		Slot mSlots[LOG_QUEUE_SIZE];
+		std::atomic<size_t> mEnqueuePos;
+		size_t mDequeuePos; // writer thread only
+		std::atomic<size_t> mWrittenPos;
+		std::atomic<unsigned int> mDropped;
+
+		boost::thread mThread;
+		boost::mutex mMutex;
+		boost::condition_variable mWakeUp;
+		std::atomic<bool> mIdle;
+		bool mRunning;
+	};
+}
+
+// never deleted: threads still running at exit may be logging while we close
+static std::atomic<LogWriter*> writer(NULL);
+
+LogLevel Log::getReportingLevel(LogSubsystem subsystem)
 {
-	return reportingLevel;
+	return (LogLevel)reportingLevels[subsystem].load(std::memory_order_relaxed);
 }
 
 std::string Log::getLogPath()
@@ -20,54 +253,120 @@ std::string Log::getLogPath()
 
 void Log::setReportingLevel(LogLevel level)
 {
-	reportingLevel = level;
+	for(int i = 0; i < LogSubsystemCount; i++)
+		reportingLevels[i].store(level, std::memory_order_relaxed);
+}
+
+static bool parseLevel(const std::string& name, LogLevel& level)
+{
+	for(int i = LogError; i <= LogDebug; i++)
+	{
+		if(name == levelNames[i])
+		{
+			level = (LogLevel)i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool Log::setReportingLevels(const std::string& levels)
+{
+	size_t start = 0;
+	while(start <= levels.size())
+	{
+		size_t end = levels.find(',', start);
+		if(end == std::string::npos)
+			end = levels.size();
+
+		const std::string entry = levels.substr(start, end - start);
+		const size_t equals = entry.find('=');
+
+		LogLevel level;
+		if(equals == std::string::npos)
+		{
+			if(!parseLevel(entry, level))
+				return false;
+
+			setReportingLevel(level);
+		}else{
+			const std::string name = entry.substr(0, equals);
+
+			int subsystem = 0;
+			while(subsystem < LogSubsystemCount && name != subsystemNames[subsystem])
+				subsystem++;
+
+			if(subsystem == LogSubsystemCount || !parseLevel(entry.substr(equals + 1), level))
+				return false;
+
+			reportingLevels[subsystem].store(level, std::memory_order_relaxed);
+		}
+
+		start = end + 1;
+	}
+
+	return true;
 }
 
 void Log::open()
 {
-	file = fopen(getLogPath().c_str(), "w");
+	const std::string path = getLogPath();
+	FILE* file = fopen(path.c_str(), "w");
+	if(file == NULL)
+	{
+		std::cerr << "ERROR - could not open " << path << ", nothing will be logged\n";
+		return;
+	}
+
+	writer.store(new LogWriter(path, file), std::memory_order_release);
 }
 
-std::ostringstream& Log::get(LogLevel level)
+std::ostringstream& Log::get(LogLevel level, LogSubsystem subsystem)
 {
-	os << "lvl" << level << ": \t";
 	messageLevel = level;
+	messageSubsystem = subsystem;
 
 	return os;
 }
 
 void Log::flush()
 {
-	fflush(getOutput());
+	LogWriter* current = writer.load(std::memory_order_acquire);
+	if(current != NULL)
+		current->flush();
 }
 
 void Log::close()
 {
-	fclose(file);
-	file = NULL;
-}
+	LogWriter* current = writer.exchange(NULL, std::memory_order_acq_rel);
+	if(current == NULL)
+		return;
 
-FILE* Log::getOutput()
-{
-	return file;
+	current->stop();
 }
 
 Log::~Log()
 {
-	os << std::endl;
-
-	if(getOutput() == NULL)
+	LogWriter* current = writer.load(std::memory_order_acquire);
+	if(current == NULL)
 	{
 		// not open yet, print to stdout
 		std::cerr << "ERROR - tried to write to log file before it was open! The following won't be logged:\n";
-		std::cerr << os.str();
+		std::cerr << "lvl" << messageLevel << ": \t" << os.str() << std::endl;
 		return;
 	}
 
-	fprintf(getOutput(), "%s", os.str().c_str());
+	if(current->push(messageLevel, messageSubsystem, os.str()))
+		return;
+
+	// the writer is behind, errors are worth waiting for but anything else is dropped
+	if(messageLevel != LogError)
+	{
+		current->dropped();
+		return;
+	}
 
-	//if it's an error, also print to console
-	//print all messages if using --debug
-	if(messageLevel == LogError || reportingLevel >= LogDebug)
-		fprintf(stderr, "%s", os.str().c_str());
+	while(!current->push(messageLevel, messageSubsystem, os.str()) && writer.load(std::memory_order_acquire) == current)
+		boost::this_thread::yield();
 }
@@ -1,9 +1,12 @@
 #ifndef _LOG_H_
 #define _LOG_H_
 
-#define LOG(level) \
-if(level > Log::getReportingLevel()) ; \
-else Log().get(level)
+#define LOG(level) LOG_SUB(LogGeneral, level)
+
+// the message is only formatted if it is going to be written
+#define LOG_SUB(subsystem, level) \
+if(level > Log::getReportingLevel(subsystem)) ; \
+else Log().get(level, subsystem)
 
 #include <string>
 #include <sstream>
@@ -11,28 +14,37 @@ else Log().get(level)
 
 enum LogLevel { LogError, LogWarning, LogInfo, LogDebug };
 
+// each subsystem can be given its own reporting level, see Log::setReportingLevels
+enum LogSubsystem { LogGeneral, LogAudio, LogLobby, LogNetwork, LogScraper, LogTheme, LogSubsystemCount };
+
+// Messages are handed to a background thread through a lock-free queue, which timestamps them and
+// writes them to es_log.txt. The log is rotated once it grows past a few megabytes.
 class Log
 {
 public:
 	//Log();
 	~Log();
-	std::ostringstream& get(LogLevel level = LogInfo);
+	std::ostringstream& get(LogLevel level = LogInfo, LogSubsystem subsystem = LogGeneral);
 
-	static LogLevel getReportingLevel();
+	static LogLevel getReportingLevel(LogSubsystem subsystem = LogGeneral);
+
+	// sets the level of every subsystem
 	static void setReportingLevel(LogLevel level);
 
+	// "debug" for every subsystem, or a list like "lobby=debug,scraper=warning"; false if it can't be parsed
+	static bool setReportingLevels(const std::string& levels);
+
 	static std::string getLogPath();
 
+	// blocks until everything logged so far is written
 	static void flush();
 	static void open();
 	static void close();
 protected:
 	std::ostringstream os;
-	static FILE* file;
 private:
-	static LogLevel reportingLevel;
-	static FILE* getOutput();
 	LogLevel messageLevel;
+	LogSubsystem messageSubsystem;
 };
 
 #endif
@@ -0,0 +1,49 @@
+#include "Metrics.h"
+#include "Log.h"
+#include <map>
+#include <memory>
+#include <sstream>
+#include <boost/thread/mutex.hpp>
+
+static boost::mutex& getMutex()
+{
+	static boost::mutex mutex;
+	return mutex;
+}
+
+static std::map< std::string, std::unique_ptr<Metrics::Counter> >& getCounters()
+{
+	static std::map< std::string, std::unique_ptr<Metrics::Counter> > counters;
+	return counters;
+}
+
+Metrics::Counter& Metrics::counter(const std::string& name)
+{
+	boost::mutex::scoped_lock lock(getMutex());
+
+	std::unique_ptr<Counter>& counter = getCounters()[name];
+	if(!counter)
+		counter = std::unique_ptr<Counter>(new Counter());
+
+	return *counter;
+}
+
+std::string Metrics::toString()
+{
+	boost::mutex::scoped_lock lock(getMutex());
+
+	std::stringstream ss;
+	for(auto it = getCounters().begin(); it != getCounters().end(); it++)
+	{
+		if(it != getCounters().begin())
+			ss << ", ";
+		ss << it->first << "=" << it->second->get();
+	}
+
+	return ss.str();
+}
+
+void Metrics::log()
+{
+	LOG(LogInfo) << "Metrics: " << toString();
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+
+// Process-wide named counters, for things that happen too often to log one line each.
+// Counters are registered on first use and never removed, so callers can keep a reference:
+//   static Metrics::Counter& packets = Metrics::counter("lobby.packets_in");
+//   packets.add();
+class Metrics
+{
+public:
+	class Counter
+	{
+	public:
+		Counter() : mValue(0) {}
+
+		inline void add(unsigned long long amount = 1) { mValue.fetch_add(amount, std::memory_order_relaxed); }
+		inline unsigned long long get() const { return mValue.load(std::memory_order_relaxed); }
+
+	private:
+		std::atomic<unsigned long long> mValue;
+	};
+
+	// thread safe
+	static Counter& counter(const std::string& name);
+
+	// one line with every counter, sorted by name
+	static std::string toString();
+	static void log();
+};
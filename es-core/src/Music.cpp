@@ -1,35 +1,55 @@
 #include "Music.h"
 #include "Log.h"
+#include "Metrics.h"
 #include "Settings.h"
 #include "ThemeData.h"
 #include "AudioManager.h"
 #include "RecalboxConf.h"
 
-std::map< std::string, std::shared_ptr<Music> > Music::sMap;
+std::map< std::string, std::weak_ptr<Music> > Music::sMap;
+boost::mutex Music::sMapMutex;
 
 
 std::shared_ptr<Music> Music::get(const std::string& path)
 {
+	static Metrics::Counter& loaded = Metrics::counter("audio.music_loaded");
+
+	boost::mutex::scoped_lock lock(sMapMutex);
+
 	auto it = sMap.find(path);
 	if(it != sMap.end())
-		return it->second;
+	{
+		std::shared_ptr<Music> music = it->second.lock();
+		if(music)
+			return music;
+	}
+
+	// forget the ones that were let go
+	for(it = sMap.begin(); it != sMap.end(); )
+	{
+		if(it->second.expired())
+			it = sMap.erase(it);
+		else
+			it++;
+	}
+
 	std::shared_ptr<Music> music = std::shared_ptr<Music>(new Music(path));
 	sMap[path] = music;
-        AudioManager::getInstance()->registerMusic(music);
+	loaded.add();
 
 	return music;
 }
 
 std::shared_ptr<Music> Music::getFromTheme(const std::shared_ptr<ThemeData>& theme, const std::string& view, const std::string& element)
 {
-	LOG(LogInfo) << " req music [" << view << "." << element << "]";
+	LOG_SUB(LogAudio, LogDebug) << " req music [" << view << "." << element << "]";
 	const ThemeData::ThemeElement* elem = theme->getElement(view, element, "sound");
-	if(!elem || !elem->has("path"))
+	if(!elem || !elem->has(ThemeProperty::PATH))
 	{
-		LOG(LogInfo) << "   (missing)";
+		LOG_SUB(LogAudio, LogDebug) << "   (missing)";
 		return NULL;
 	}
-	return get(elem->get<std::string>("path"));
+	return get(elem->get<std::string>(ThemeProperty::PATH));
 }
 
 Music::Music(const std::string & path) : music(NULL), playing(false)
@@ -56,7 +76,7 @@ void Music::initMusic()
         Mix_Music *gMusic = NULL;
         gMusic = Mix_LoadMUS( mPath.c_str() );
         if(gMusic == NULL){
-            LOG(LogError) << "Error loading sound \"" << mPath << "\"!\n" << "	" << SDL_GetError();
+            LOG_SUB(LogAudio, LogError) << "Error loading sound \"" << mPath << "\"!\n" << "	" << SDL_GetError();
             return;
         }else {
             music = gMusic;
@@ -80,12 +100,10 @@ void Music::play(bool repeat, void (* callback)())
 	{
 		playing = true;
 	}
-    LOG(LogInfo) << "playing";
+    LOG_SUB(LogAudio, LogDebug) << "playing";
     if(Mix_FadeInMusic(music, repeat ? -1 : 1, 1000) == -1){
-        LOG(LogInfo) << "Mix_PlayMusic: " << Mix_GetError();
+        LOG_SUB(LogAudio, LogInfo) << "Mix_PlayMusic: " << Mix_GetError();
 		return;
     }
-	if(!repeat){
-		Mix_HookMusicFinished(callback);
-	}
+	Mix_HookMusicFinished(repeat ? NULL : callback);
 }
\ No newline at end of file
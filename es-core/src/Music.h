@@ -4,6 +4,7 @@
 #include <string>
 #include <map>
 #include <memory>
+#include <boost/thread/mutex.hpp>
 #include "SDL_mixer.h"
 
 class ThemeData;
@@ -17,15 +18,21 @@ class Music
 public:
         
         static std::shared_ptr<Music> getFromTheme(const std::shared_ptr<ThemeData>& theme, const std::string& view, const std::string& element);
+        // any thread, loads the file if nobody holds it yet
         static std::shared_ptr<Music> get(const std::string& path);
         void play(bool repeat, void (* callback)());
+
+        const std::string& getPath() const { return mPath; }
+        bool isLoaded() const { return music != NULL; }
         
 	~Music();
 
 
 private:
 	Music(const std::string & path = "");
-	static std::map< std::string, std::shared_ptr<Music> > sMap;
+	// only as long as somebody holds them, see AudioManager
+	static std::map< std::string, std::weak_ptr<Music> > sMap;
+	static boost::mutex sMapMutex;
 
 
 	void initMusic();
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+// Capacity must be a power of two. Items are moved in and out, slots are default constructed.
+template<typename T, size_t Capacity>
+class SPSCQueue
+{
+	static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "SPSCQueue capacity must be a power of two");
+
+public:
+	SPSCQueue() : mHead(0), mTail(0) {}
+
+	// producer only, false if the queue is full
+	bool push(T&& item)
+	{
+		const size_t tail = mTail.load(std::memory_order_relaxed);
+		if(tail - mHead.load(std::memory_order_acquire) == Capacity)
+			return false;
+
+		mSlots[tail & (Capacity - 1)] = std::move(item);
+		mTail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// consumer only, false if the queue is empty
+	bool pop(T& item)
+	{
+		const size_t head = mHead.load(std::memory_order_relaxed);
+		if(head == mTail.load(std::memory_order_acquire))
+			return false;
+
+		item = std::move(mSlots[head & (Capacity - 1)]);
+		mSlots[head & (Capacity - 1)] = T(); // don't keep what was moved out alive until the slot is reused
+		mHead.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	T mSlots[Capacity];
+
+	// padded apart, so the producer and the consumer don't bounce one cache line between them
+	std::atomic<size_t> mHead;
+	char mPadding[64];
+	std::atomic<size_t> mTail;
+};
@@ -4,6 +4,8 @@
 #include "platform.h"
 #include <boost/filesystem.hpp>
 #include <boost/assign.hpp>
+#include <fstream>
+#include <sstream>
 
 Settings *Settings::sInstance = NULL;
 
@@ -29,7 +31,7 @@ std::vector<const char *> settings_dont_save = boost::assign::list_of
         ("HideSystemView")
         ("MusicDirectory");
 
-Settings::Settings() {
+Settings::Settings() : mNextListener(0), mHasPendingSave(false), mWriting(false), mFlushing(false) {
     setDefaults();
     loadFile();
 }
@@ -68,6 +70,7 @@ void Settings::setDefaults() {
     mBoolMap["QuickSystemSelect"] = true;
     mBoolMap["FavoritesOnly"] = false;
     mBoolMap["ShowHidden"] = false;
+    mBoolMap["LazyLoading"] = false;
 
     mBoolMap["Debug"] = false;
     mBoolMap["DebugGrid"] = false;
@@ -75,16 +78,28 @@ void Settings::setDefaults() {
 
 
     mBoolMap["Overscan"] = false;
+    mBoolMap["HttpCache"] = true;
+    mBoolMap["ResidentAssets"] = false; // keep decoded images in RAM while a game runs, see ResidentCache
 
     mIntMap["ScreenSaverTime"] = 5 * 60 * 1000; // 5 minutes
     mIntMap["ScraperResizeWidth"] = 400;
     mIntMap["ScraperResizeHeight"] = 0;
+    mIntMap["ScraperMaxSearches"] = 4;
+    mIntMap["ScraperMaxDownloads"] = 4;
+    mIntMap["ScraperRequestsPerSecond"] = 4; // per host
+    mIntMap["HttpCacheSize"] = 64; // MB
+    mIntMap["HttpCacheMaxAge"] = 0; // hours before a cached response is revalidated, 0: on every scrape so corrections show up
+    mIntMap["ResidentAssetsBudget"] = 64; // MB
     mIntMap["SystemVolume"] = 96;
+    mIntMap["AudioBufferSize"] = 1024; // samples, about 23ms at 44.1kHz
+    mIntMap["LazyReleaseTime"] = 10 * 60 * 1000; // 10 minutes
 
     mStringMap["TransitionStyle"] = "fade";
     mStringMap["ThemeSet"] = "";
+    mStringMap["GamelistViewStyle"] = "automatic"; // automatic, basic, detailed or grid
     mStringMap["ScreenSaverBehavior"] = "dim";
     mStringMap["Scraper"] = "Screenscraper";
+    mStringMap["ScraperDatabase"] = ""; // dump used by the local database scraper, ~/.emulationstation/scraper_db.xml if empty
     mStringMap["Lang"] = "en_US";
     mStringMap["INPUT P1"] = "DEFAULT";
     mStringMap["INPUT P2"] = "DEFAULT";
@@ -115,8 +130,6 @@ void saveMap(pugi::xml_node &node, std::map<K, V> &map, const char *type) {
 }
 
 void Settings::saveFile() {
-    const std::string path = getHomePath() + "/.emulationstation/es_settings.cfg";
-
     pugi::xml_document doc;
 
     pugi::xml_node config = doc.append_child("config");
@@ -132,7 +145,69 @@ void Settings::saveFile() {
         node.append_attribute("value").set_value(iter->second.c_str());
     }
 
-    doc.save_file(path.c_str());
+    std::ostringstream contents;
+    doc.save(contents);
+
+    {
+        boost::mutex::scoped_lock lock(mSaveMutex);
+        // replaces one that wasn't written yet
+        mPendingSave = contents.str();
+        mHasPendingSave = true;
+        mSaveDeadline = boost::get_system_time() + boost::posix_time::milliseconds(SAVE_DELAY_MS);
+
+        if (!mSaveThread.joinable())
+            mSaveThread = boost::thread(&Settings::runSaver, this);
+    }
+    mSaveCondition.notify_all();
+}
+
+void Settings::flush() {
+    boost::mutex::scoped_lock lock(mSaveMutex);
+    mFlushing = true;
+    mSaveCondition.notify_all();
+    while (mHasPendingSave || mWriting)
+        mSaveCondition.wait(lock);
+    mFlushing = false;
+}
+
+void Settings::runSaver() {
+    const std::string path = getHomePath() + "/.emulationstation/es_settings.cfg";
+    const std::string tmpPath = path + ".tmp";
+
+    boost::mutex::scoped_lock lock(mSaveMutex);
+    while (true) {
+        while (!mHasPendingSave)
+            mSaveCondition.wait(lock);
+
+        // until nothing was changed for a moment
+        while (mHasPendingSave && !mFlushing && boost::get_system_time() < mSaveDeadline)
+            mSaveCondition.timed_wait(lock, mSaveDeadline);
+
+        const std::string contents = mPendingSave;
+        mPendingSave.clear();
+        mHasPendingSave = false;
+        mWriting = true;
+        lock.unlock();
+
+        // a crash or power loss while writing leaves the previous file
+        bool written;
+        {
+            std::ofstream file(tmpPath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+            file << contents;
+            file.close();
+            written = !file.fail();
+        }
+
+        boost::system::error_code ec;
+        if (written)
+            boost::filesystem::rename(tmpPath, path, ec);
+        if (!written || ec)
+            LOG(LogError) << "Could not save settings to " << path;
+
+        lock.lock();
+        mWriting = false;
+        mSaveCondition.notify_all();
+    }
 }
 
 void Settings::loadFile() {
@@ -181,13 +256,52 @@ void Settings::loadFile() {
 } \
 void Settings::setMethodName(const std::string& name, type value) \
 { \
+    auto it = mapName.find(name); \
+    if(it != mapName.end() && it->second == value) \
+        return; \
     mapName[name] = value; \
+    notify(name); \
+}
+
+#define SETTINGS_LOOKUP(type, mapName) template<> const type& Settings::lookup<type>(const std::string& name) \
+{ \
+    if(mapName.find(name) == mapName.end()) \
+    { \
+        LOG(LogError) << "Tried to use unset setting " << name << "!"; \
+    } \
+    return mapName[name]; \
 }
 
 SETTINGS_GETSET(bool, mBoolMap, getBool, setBool);
+SETTINGS_LOOKUP(bool, mBoolMap);
 
 SETTINGS_GETSET(int, mIntMap, getInt, setInt);
+SETTINGS_LOOKUP(int, mIntMap);
 
 SETTINGS_GETSET(float, mFloatMap, getFloat, setFloat);
+SETTINGS_LOOKUP(float, mFloatMap);
 
 SETTINGS_GETSET(const std::string&, mStringMap, getString, setString);
+SETTINGS_LOOKUP(std::string, mStringMap);
+
+int Settings::addListener(const std::string& name, const Listener& listener) {
+    const int id = mNextListener++;
+    mListeners[id] = std::make_pair(name, listener);
+    return id;
+}
+
+void Settings::removeListener(int id) {
+    mListeners.erase(id);
+}
+
+void Settings::notify(const std::string& name) {
+    // a listener may remove itself
+    std::vector<Listener> listeners;
+    for (auto it = mListeners.begin(); it != mListeners.end(); it++) {
+        if (it->second.first == name)
+            listeners.push_back(it->second.second);
+    }
+
+    for (auto it = listeners.begin(); it != listeners.end(); it++)
+        (*it)();
+}
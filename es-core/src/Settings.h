@@ -1,15 +1,57 @@
 #pragma once
 #include <string>
 #include <map>
+#include <functional>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/thread_time.hpp>
 
 //This is a singleton for storing settings.
 class Settings
 {
 public:
+	// A setting looked up once, the first time it is read: get() is then a pointer read instead of a
+	// map lookup by name, for the ones read every frame or for every file. Values are never removed,
+	// so a handle can be static:
+	//   static Settings::Bool drawFramerate("DrawFramerate");
+	//   if(drawFramerate.get()) ...
+	template<typename T>
+	class Handle
+	{
+	public:
+		explicit Handle(const std::string& name) : mName(name), mValue(NULL) {}
+
+		inline const T& get()
+		{
+			if(mValue == NULL)
+				mValue = &Settings::getInstance()->lookup<T>(mName);
+			return *mValue;
+		}
+
+		const std::string& getName() const { return mName; }
+
+	private:
+		std::string mName;
+		const T* mValue;
+	};
+
+	typedef Handle<bool> Bool;
+	typedef Handle<int> Int;
+	typedef Handle<float> Float;
+	typedef Handle<std::string> String;
+
+	// called from set*() when the value actually changed, on the thread that set it
+	typedef std::function<void()> Listener;
+
 	static Settings* getInstance();
 
 	void loadFile();
+
+	// written in the background a moment later, so a menu changing several settings writes once
 	void saveFile();
+	// waits for a pending save, before exiting or launching a game
+	void flush();
 
 	//You will get a warning if you try a get on a key that is not already present.
 	bool getBool(const std::string& name);
@@ -22,16 +64,47 @@ public:
 	void setFloat(const std::string& name, float value);
 	void setString(const std::string& name, const std::string& value);
 
+	// returns an id for removeListener
+	int addListener(const std::string& name, const Listener& listener);
+	void removeListener(int id);
+
 private:
 	static Settings* sInstance;
 
+	static const int SAVE_DELAY_MS = 500;
+
 	Settings();
 
 	//Clear everything and load default values.
 	void setDefaults();
 
+	template<typename T>
+	const T& lookup(const std::string& name);
+
+	void notify(const std::string& name);
+
+	void runSaver();
+
 	std::map<std::string, bool> mBoolMap;
 	std::map<std::string, int> mIntMap;
 	std::map<std::string, float> mFloatMap;
 	std::map<std::string, std::string> mStringMap;
+
+	std::map< int, std::pair<std::string, Listener> > mListeners;
+	int mNextListener;
+
+	// the saver thread only ever sees the serialized document
+	boost::thread mSaveThread;
+	boost::mutex mSaveMutex;
+	boost::condition_variable mSaveCondition;
+	std::string mPendingSave;
+	bool mHasPendingSave;
+	bool mWriting;
+	bool mFlushing;
+	boost::system_time mSaveDeadline;
 };
+
+template<> const bool& Settings::lookup<bool>(const std::string& name);
+template<> const int& Settings::lookup<int>(const std::string& name);
+template<> const float& Settings::lookup<float>(const std::string& name);
+template<> const std::string& Settings::lookup<std::string>(const std::string& name);
@@ -1,13 +1,18 @@
 #include "Sound.h"
 #include "AudioManager.h"
 #include "Log.h"
+#include "Metrics.h"
 #include "Settings.h"
 #include "ThemeData.h"
 
 std::map< std::string, std::shared_ptr<Sound> > Sound::sMap;
+boost::mutex Sound::sMapMutex;
 
 std::shared_ptr<Sound> Sound::get(const std::string& path)
 {
+	// themes are loaded in parallel, the same effect is only decoded once
+	boost::mutex::scoped_lock lock(sMapMutex);
+
 	auto it = sMap.find(path);
 	if(it != sMap.end())
 		return it->second;
@@ -20,16 +25,34 @@ std::shared_ptr<Sound> Sound::get(const std::string& path)
 
 std::shared_ptr<Sound> Sound::getFromTheme(const std::shared_ptr<ThemeData>& theme, const std::string& view, const std::string& element)
 {
-	LOG(LogInfo) << " req sound [" << view << "." << element << "]";
+	LOG_SUB(LogAudio, LogDebug) << " req sound [" << view << "." << element << "]";
 
 	const ThemeData::ThemeElement* elem = theme->getElement(view, element, "sound");
-	if(!elem || !elem->has("path"))
+	if(!elem || !elem->has(ThemeProperty::PATH))
 	{
-		LOG(LogInfo) << "   (missing)";
+		LOG_SUB(LogAudio, LogDebug) << "   (missing)";
 		return get("");
 	}
 
-	return get(elem->get<std::string>("path"));
+	return get(elem->get<std::string>(ThemeProperty::PATH));
+}
+
+void Sound::preloadTheme(const std::shared_ptr<ThemeData>& theme)
+{
+	// bgsound and directory are music, streamed by AudioManager instead of decoded whole
+	const auto sounds = theme->getElementsOfType("sound");
+	for(auto it = sounds.begin(); it != sounds.end(); it++)
+	{
+		if(it->first != "bgsound" && it->first != "directory" && it->second->has(ThemeProperty::PATH))
+			get(it->second->get<std::string>(ThemeProperty::PATH));
+	}
+
+	const auto lists = theme->getElementsOfType("textlist");
+	for(auto it = lists.begin(); it != lists.end(); it++)
+	{
+		if(it->second->has(ThemeProperty::SCROLL_SOUND))
+			get(it->second->get<std::string>(ThemeProperty::SCROLL_SOUND));
+	}
 }
 
 Sound::Sound(const std::string & path) : mSampleData(NULL), playing(false)
@@ -50,6 +73,8 @@ void Sound::loadFile(const std::string & path)
 
 void Sound::init()
 {
+	static Metrics::Counter& loaded = Metrics::counter("audio.sounds_loaded");
+
 	if(mSampleData != NULL)
 		deinit();
 
@@ -59,9 +84,10 @@ void Sound::init()
 	//load wav file via SDL
 	mSampleData = Mix_LoadWAV(mPath.c_str());
 	if(mSampleData == NULL) {
-		LOG(LogError) << "Error loading sound \"" << mPath << "\"!\n" << "	" << SDL_GetError();
+		LOG_SUB(LogAudio, LogError) << "Error loading sound \"" << mPath << "\"!\n" << "	" << SDL_GetError();
 		return;
 	}
+	loaded.add();
 }
 
 void Sound::deinit()
@@ -71,6 +97,7 @@ void Sound::deinit()
 	if(mSampleData != NULL)
 	{
             Mix_FreeChunk( mSampleData );
+            mSampleData = NULL;
 	}
 }
 
@@ -85,7 +112,12 @@ void Sound::play()
 		//flag our sample as playing
 		playing = true;
 	}
-	Mix_PlayChannel( -1, mSampleData, 0 );
+
+	// a free effect channel, or else the one that started first: fast scrolling never goes silent
+	int channel = Mix_GroupAvailable(AudioManager::EFFECTS_GROUP);
+	if(channel == -1)
+		channel = Mix_GroupOldest(AudioManager::EFFECTS_GROUP);
+	Mix_PlayChannel( channel, mSampleData, 0 );
 }
 
 bool Sound::isPlaying() const
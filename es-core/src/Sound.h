@@ -4,10 +4,14 @@
 #include <string>
 #include <map>
 #include <memory>
+#include <boost/thread/mutex.hpp>
 #include "SDL_mixer.h"
 
 class ThemeData;
 
+// Sound effects are decoded once into a pool shared by path and kept for the whole run, including
+// across game launches (see AudioManager::init). They play on the mixer channels AudioManager
+// reserves for effects, so they never wait for or cut into anything else.
 class Sound
 {
 	std::string mPath;
@@ -15,9 +19,13 @@ class Sound
 	bool playing;
 
 public:
+	// any thread
 	static std::shared_ptr<Sound> get(const std::string& path);
 	static std::shared_ptr<Sound> getFromTheme(const std::shared_ptr<ThemeData>& theme, const std::string& view, const std::string& elem);
 
+	// decodes every effect the theme uses, so nothing is loaded when they are first played
+	static void preloadTheme(const std::shared_ptr<ThemeData>& theme);
+
 	~Sound();
 
 	void init();
@@ -33,6 +41,7 @@ public:
 private:
 	Sound(const std::string & path = "");
 	static std::map< std::string, std::shared_ptr<Sound> > sMap;
+	static boost::mutex sMapMutex;
 };
 
 #endif
@@ -4,9 +4,13 @@
 #include "Sound.h"
 #include "resources/TextureResource.h"
 #include "Log.h"
+#include "Metrics.h"
 #include "Settings.h"
 #include "pugixml/pugixml.hpp"
 #include <boost/assign.hpp>
+#include <algorithm>
+#include <cassert>
+#include <chrono>
 
 #include "components/ImageComponent.h"
 #include "components/TextComponent.h"
@@ -84,6 +88,71 @@ std::map< std::string, ElementMapType > ThemeData::sElementMap = boost::assign::
 		("fontPath", PATH)
 		("fontSize", FLOAT)));
 
+// in ThemeProperty::PropertyId order
+static const char* const sPropertyNames[] = {
+	"pos",
+	"size",
+	"maxSize",
+	"origin",
+	"path",
+	"tile",
+	"color",
+	"text",
+	"textColor",
+	"iconColor",
+	"alignment",
+	"fontPath",
+	"fontSize",
+	"forceUppercase",
+	"lineSpacing",
+	"horizontalMargin",
+	"scrollSound",
+	"selectorColor",
+	"selectedColor",
+	"primaryColor",
+	"secondaryColor",
+	"filledPath",
+	"unfilledPath"
+};
+static_assert(sizeof(sPropertyNames) / sizeof(sPropertyNames[0]) == ThemeProperty::COUNT, "a theme property has no name");
+
+ThemeProperty::PropertyId ThemeData::getPropertyId(const std::string& name)
+{
+	for(int i = 0; i < ThemeProperty::COUNT; i++)
+	{
+		if(name == sPropertyNames[i])
+			return (ThemeProperty::PropertyId)i;
+	}
+	return ThemeProperty::INVALID;
+}
+
+const char* ThemeData::getPropertyName(ThemeProperty::PropertyId prop)
+{
+	return prop < ThemeProperty::COUNT ? sPropertyNames[prop] : "";
+}
+
+static bool propertyBefore(const std::pair<ThemeProperty::PropertyId, ThemeData::PropertyValue>& property, ThemeProperty::PropertyId prop)
+{
+	return property.first < prop;
+}
+
+const ThemeData::PropertyValue* ThemeData::ThemeElement::find(ThemeProperty::PropertyId prop) const
+{
+	auto it = std::lower_bound(properties.begin(), properties.end(), prop, propertyBefore);
+	if(it == properties.end() || it->first != prop)
+		return NULL;
+	return &it->second;
+}
+
+void ThemeData::ThemeElement::set(ThemeProperty::PropertyId prop, const PropertyValue& value)
+{
+	auto it = std::lower_bound(properties.begin(), properties.end(), prop, propertyBefore);
+	if(it != properties.end() && it->first == prop)
+		it->second = value;
+	else
+		properties.insert(it, std::make_pair(prop, value));
+}
+
 namespace fs = boost::filesystem;
 
 #define MINIMUM_THEME_FORMAT_VERSION 3
@@ -136,6 +205,19 @@ std::string resolvePath(const char* in, const fs::path& relative)
 
 
 
+struct ThemeData::CachedFragment
+{
+	CachedFragment() : mtime(0), parses(0) {}
+
+	boost::mutex mutex; // held while parsing, so a file several threads need at once is parsed only once
+	std::time_t mtime;
+	unsigned int parses;
+	std::shared_ptr<const ThemeFragment> fragment;
+};
+
+boost::mutex ThemeData::sFragmentCacheMutex;
+std::map< std::string, std::shared_ptr<ThemeData::CachedFragment> > ThemeData::sFragmentCache;
+
 ThemeData::ThemeData()
 {
 	mVersion = 0;
@@ -143,6 +225,9 @@ ThemeData::ThemeData()
 
 void ThemeData::loadFile(const std::string& path)
 {
+	static Metrics::Counter& loadTime = Metrics::counter("theme.load_us");
+	const auto start = std::chrono::steady_clock::now();
+
 	mPaths.push_back(path);
 
 	ThemeException error;
@@ -154,61 +239,125 @@ void ThemeData::loadFile(const std::string& path)
 	mVersion = 0;
 	mViews.clear();
 
-	pugi::xml_document doc;
-	pugi::xml_parse_result res = doc.load_file(path.c_str());
-	if(!res)
-		throw error << "XML parsing error: \n    " << res.description();
-
-	pugi::xml_node root = doc.child("theme");
-	if(!root)
-		throw error << "Missing <theme> tag!";
+	std::shared_ptr<const ThemeFragment> root = getFragment(path);
 
 	// parse version
-	mVersion = root.child("formatVersion").text().as_float(-404);
+	mVersion = root->version;
 	if(mVersion == -404)
 		throw error << "<formatVersion> tag missing!\n   It's either out of date or you need to add <formatVersion>" << CURRENT_THEME_FORMAT_VERSION << "</formatVersion> inside your <theme> tag.";
 
 	if(mVersion < MINIMUM_THEME_FORMAT_VERSION)
 		throw error << "Theme uses format version " << mVersion << ". Minimum supported version is " << MINIMUM_THEME_FORMAT_VERSION << ".";
 
-	parseIncludes(root);
-	parseViews(root);
+	applyFragment(*root);
+
+	loadTime.add(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
 }
 
+std::shared_ptr<const ThemeData::ThemeFragment> ThemeData::getFragment(const std::string& path)
+{
+	static Metrics::Counter& parsed = Metrics::counter("theme.files_parsed");
+	static Metrics::Counter& reused = Metrics::counter("theme.files_reused");
+	static Metrics::Counter& duplicates = Metrics::counter("theme.duplicate_parses");
+
+	std::shared_ptr<CachedFragment> entry;
+	{
+		boost::mutex::scoped_lock lock(sFragmentCacheMutex);
+		std::shared_ptr<CachedFragment>& cached = sFragmentCache[path];
+		if(!cached)
+			cached = std::make_shared<CachedFragment>();
+		entry = cached;
+	}
+
+	boost::system::error_code ec;
+	const std::time_t mtime = fs::last_write_time(path, ec);
+
+	boost::mutex::scoped_lock lock(entry->mutex);
+	if(entry->fragment && entry->mtime == mtime)
+	{
+		reused.add();
+		return entry->fragment;
+	}
+
+	// changed on disk, or failed to parse last time
+	if(entry->parses > 0)
+		duplicates.add();
+
+	entry->parses++;
+	parsed.add();
 
-void ThemeData::parseIncludes(const pugi::xml_node& root)
+	entry->fragment = parseFragment(path);
+	entry->mtime = mtime;
+	return entry->fragment;
+}
+
+std::shared_ptr<const ThemeData::ThemeFragment> ThemeData::parseFragment(const std::string& path)
 {
 	ThemeException error;
 	error.setFiles(mPaths);
 
+	pugi::xml_document doc;
+	pugi::xml_parse_result res = doc.load_file(path.c_str());
+	if(!res)
+		throw error << "XML parsing error: \n    " << res.description();
+
+	pugi::xml_node root = doc.child("theme");
+	if(!root)
+		throw error << "Missing <theme> tag!";
+
+	std::shared_ptr<ThemeFragment> fragment = std::make_shared<ThemeFragment>();
+	fragment->version = root.child("formatVersion").text().as_float(-404);
+
 	for(pugi::xml_node node = root.child("include"); node; node = node.next_sibling("include"))
 	{
 		const char* relPath = node.text().get();
-		std::string path = resolvePath(relPath, mPaths.back());
-		if(!ResourceManager::getInstance()->fileExists(path))
-			throw error << "Included file \"" << relPath << "\" not found! (resolved to \"" << path << "\")";
-
-		error << "    from included file \"" << relPath << "\":\n    ";
+		fragment->includes.push_back(std::make_pair(std::string(relPath), resolvePath(relPath, path)));
+	}
 
-		mPaths.push_back(path);
+	parseViews(root, fragment->views);
 
-		pugi::xml_document includeDoc;
-		pugi::xml_parse_result result = includeDoc.load_file(path.c_str());
-		if(!result)
-			throw error << "Error parsing file: \n    " << result.description();
+	return fragment;
+}
 
-		pugi::xml_node root = includeDoc.child("theme");
-		if(!root)
-			throw error << "Missing <theme> tag!";
+void ThemeData::applyFragment(const ThemeFragment& fragment)
+{
+	ThemeException error;
+	error.setFiles(mPaths);
 
-		parseIncludes(root);
-		parseViews(root);
+	// includes first, the including file overrides them
+	for(auto it = fragment.includes.begin(); it != fragment.includes.end(); it++)
+	{
+		const std::string& path = it->second;
+		if(!ResourceManager::getInstance()->fileExists(path))
+			throw error << "Included file \"" << it->first << "\" not found! (resolved to \"" << path << "\")";
 
+		mPaths.push_back(path);
+		applyFragment(*getFragment(path));
 		mPaths.pop_back();
 	}
+
+	// properties of an element that is already defined are replaced one by one, the others are kept
+	for(auto viewIt = fragment.views.begin(); viewIt != fragment.views.end(); viewIt++)
+	{
+		ThemeView& view = mViews[viewIt->first];
+		for(auto keyIt = viewIt->second.orderedKeys.begin(); keyIt != viewIt->second.orderedKeys.end(); keyIt++)
+		{
+			const ThemeElement& source = viewIt->second.elements.at(*keyIt);
+
+			auto inserted = view.elements.insert(std::pair<std::string, ThemeElement>(*keyIt, ThemeElement()));
+			ThemeElement& element = inserted.first->second;
+			element.type = source.type;
+			element.extra = source.extra;
+			for(auto propIt = source.properties.begin(); propIt != source.properties.end(); propIt++)
+				element.set(propIt->first, propIt->second);
+
+			if(inserted.second)
+				view.orderedKeys.push_back(*keyIt);
+		}
+	}
 }
 
-void ThemeData::parseViews(const pugi::xml_node& root)
+void ThemeData::parseViews(const pugi::xml_node& root, std::map<std::string, ThemeView>& views)
 {
 	ThemeException error;
 	error.setFiles(mPaths);
@@ -230,7 +379,7 @@ void ThemeData::parseViews(const pugi::xml_node& root)
 			prevOff = nameAttr.find_first_not_of(delim, off);
 			off = nameAttr.find_first_of(delim, prevOff);
 			
-			ThemeView& view = mViews.insert(std::pair<std::string, ThemeView>(viewKey, ThemeView())).first->second;
+			ThemeView& view = views.insert(std::pair<std::string, ThemeView>(viewKey, ThemeView())).first->second;
 			parseView(node, view);
 		}
 	}
@@ -284,6 +433,10 @@ void ThemeData::parseElement(const pugi::xml_node& root, const std::map<std::str
 		if(typeIt == typeMap.end())
 			throw error << "Unknown property type \"" << node.name() << "\" (for element of type " << root.name() << ").";
 
+		// every name in sElementMap has an id
+		const ThemeProperty::PropertyId id = getPropertyId(typeIt->first);
+		assert(id != ThemeProperty::INVALID);
+
 		switch(typeIt->second)
 		{
 		case NORMALIZED_PAIR:
@@ -299,11 +452,11 @@ void ThemeData::parseElement(const pugi::xml_node& root, const std::map<std::str
 
 			Eigen::Vector2f val(atof(first.c_str()), atof(second.c_str()));
 
-			element.properties[node.name()] = val;
+			element.set(id, val);
 			break;
 		}
 		case STRING:
-			element.properties[node.name()] = std::string(node.text().as_string());
+			element.set(id, std::string(node.text().as_string()));
 			break;
 		case PATH:
 		{
@@ -315,19 +468,19 @@ void ThemeData::parseElement(const pugi::xml_node& root, const std::map<std::str
 				ss << "could not find file \"" << node.text().get() << "\" ";
 				if(node.text().get() != path)
 					ss << "(which resolved to \"" << path << "\") ";
-				LOG(LogWarning) << ss.str();
+				LOG_SUB(LogTheme, LogWarning) << ss.str();
 			}
-			element.properties[node.name()] = path;
+			element.set(id, path);
 			break;
 		}
 		case COLOR:
-			element.properties[node.name()] = getHexColor(node.text().as_string());
+			element.set(id, getHexColor(node.text().as_string()));
 			break;
 		case FLOAT:
-			element.properties[node.name()] = node.text().as_float();
+			element.set(id, node.text().as_float());
 			break;
 		case BOOLEAN:
-			element.properties[node.name()] = node.text().as_bool();
+			element.set(id, node.text().as_bool());
 			break;
 		default:
 			throw error << "Unknown ElementPropertyType for \"" << root.attribute("name").as_string() << "\", property " << node.name();
@@ -347,7 +500,7 @@ const ThemeData::ThemeElement* ThemeData::getElement(const std::string& view, co
 
 	if(elemIt->second.type != expectedType && !expectedType.empty())
 	{
-		LOG(LogWarning) << " requested mismatched theme type for [" << view << "." << element << "] - expected \"" 
+		LOG_SUB(LogTheme, LogWarning) << " requested mismatched theme type for [" << view << "." << element << "] - expected \"" 
 			<< expectedType << "\", got \"" << elemIt->second.type << "\"";
 		return NULL;
 	}
@@ -355,6 +508,20 @@ const ThemeData::ThemeElement* ThemeData::getElement(const std::string& view, co
 	return &elemIt->second;
 }
 
+std::vector< std::pair<std::string, const ThemeData::ThemeElement*> > ThemeData::getElementsOfType(const std::string& type) const
+{
+	std::vector< std::pair<std::string, const ThemeElement*> > elements;
+	for(auto viewIt = mViews.begin(); viewIt != mViews.end(); viewIt++)
+	{
+		for(auto elemIt = viewIt->second.elements.begin(); elemIt != viewIt->second.elements.end(); elemIt++)
+		{
+			if(elemIt->second.type == type)
+				elements.push_back(std::make_pair(elemIt->first, &elemIt->second));
+		}
+	}
+	return elements;
+}
+
 const std::shared_ptr<ThemeData>& ThemeData::getDefault()
 {
 	static std::shared_ptr<ThemeData> theme = nullptr;
@@ -370,7 +537,7 @@ const std::shared_ptr<ThemeData>& ThemeData::getDefault()
 				theme->loadFile(path);
 			} catch(ThemeException& e)
 			{
-				LOG(LogError) << e.what();
+				LOG_SUB(LogTheme, LogError) << e.what();
 				theme = std::shared_ptr<ThemeData>(new ThemeData()); //reset to empty
 			}
 		}
@@ -425,7 +592,11 @@ ThemeExtras::~ThemeExtras()
 }
 
 
-std::map<std::string, ThemeSet> ThemeData::getThemeSets()
+static boost::mutex themeSetsMutex;
+static std::map<std::string, ThemeSet> themeSets;
+static bool themeSetsScanned = false;
+
+static std::map<std::string, ThemeSet> scanThemeSets()
 {
 	std::map<std::string, ThemeSet> sets;
 
@@ -455,6 +626,27 @@ std::map<std::string, ThemeSet> ThemeData::getThemeSets()
 	return sets;
 }
 
+std::map<std::string, ThemeSet> ThemeData::getThemeSets()
+{
+	boost::mutex::scoped_lock lock(themeSetsMutex);
+	if(!themeSetsScanned)
+	{
+		themeSets = scanThemeSets();
+		themeSetsScanned = true;
+	}
+
+	return themeSets;
+}
+
+void ThemeData::refreshThemeSets()
+{
+	std::map<std::string, ThemeSet> sets = scanThemeSets();
+
+	boost::mutex::scoped_lock lock(themeSetsMutex);
+	themeSets = sets;
+	themeSetsScanned = true;
+}
+
 fs::path ThemeData::getThemeFromCurrentSet(const std::string& system)
 {
 	auto themeSets = ThemeData::getThemeSets();
@@ -479,3 +671,11 @@ bool ThemeData::getHasFavoritesInTheme()
 {
 	return (mVersion >= CURRENT_THEME_FORMAT_VERSION);
 }
+
+void ThemeData::logCacheStats()
+{
+	LOG_SUB(LogTheme, LogInfo) << "Themes loaded in " << Metrics::counter("theme.load_us").get() / 1000 << "ms: "
+		<< Metrics::counter("theme.files_parsed").get() << " files parsed, "
+		<< Metrics::counter("theme.files_reused").get() << " reused, "
+		<< Metrics::counter("theme.duplicate_parses").get() << " parsed more than once";
+}
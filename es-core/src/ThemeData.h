@@ -6,8 +6,11 @@
 #include <map>
 #include <deque>
 #include <string>
+#include <vector>
+#include <stdexcept>
 #include <boost/filesystem.hpp>
 #include <boost/variant.hpp>
+#include <boost/thread/mutex.hpp>
 #include <Eigen/Dense>
 #include "pugixml/pugixml.hpp"
 #include "GuiComponent.h"
@@ -42,6 +45,40 @@ namespace ThemeFlags
 	};
 }
 
+namespace ThemeProperty
+{
+	// every property an element can have, interned when the theme is parsed
+	enum PropertyId : unsigned char
+	{
+		POS,
+		SIZE,
+		MAX_SIZE,
+		ORIGIN,
+		PATH,
+		TILE,
+		COLOR,
+		TEXT,
+		TEXT_COLOR,
+		ICON_COLOR,
+		ALIGNMENT,
+		FONT_PATH,
+		FONT_SIZE,
+		FORCE_UPPERCASE,
+		LINE_SPACING,
+		HORIZONTAL_MARGIN,
+		SCROLL_SOUND,
+		SELECTOR_COLOR,
+		SELECTED_COLOR,
+		PRIMARY_COLOR,
+		SECONDARY_COLOR,
+		FILLED_PATH,
+		UNFILLED_PATH,
+
+		COUNT,
+		INVALID = 0xFF
+	};
+}
+
 class ThemeException : public std::exception
 {
 public:
@@ -95,18 +132,43 @@ class ThemeData
 {
 public:
 
+	typedef boost::variant<Eigen::Vector2f, std::string, unsigned int, float, bool> PropertyValue;
+
+	// ThemeProperty::INVALID for a name no element has
+	static ThemeProperty::PropertyId getPropertyId(const std::string& name);
+	static const char* getPropertyName(ThemeProperty::PropertyId prop);
+
 	class ThemeElement
 	{
 	public:
 		bool extra;
 		std::string type;
 
-		std::map< std::string, boost::variant<Eigen::Vector2f, std::string, unsigned int, float, bool> > properties;
+		// sorted by id: an element only has a handful, a binary search over them is cheaper
+		// than comparing strings down a tree
+		std::vector< std::pair<ThemeProperty::PropertyId, PropertyValue> > properties;
 
+		// throws std::out_of_range if the element doesn't have it
 		template<typename T>
-		T get(const std::string& prop) const { return boost::get<T>(properties.at(prop)); }
+		T get(ThemeProperty::PropertyId prop) const
+		{
+			const PropertyValue* value = find(prop);
+			if(value == NULL)
+				throw std::out_of_range("theme element has no such property");
+			return boost::get<T>(*value);
+		}
 
-		inline bool has(const std::string& prop) const { return (properties.find(prop) != properties.end()); }
+		inline bool has(ThemeProperty::PropertyId prop) const { return find(prop) != NULL; }
+
+		// by name, the id is looked up first
+		template<typename T>
+		T get(const std::string& prop) const { return get<T>(getPropertyId(prop)); }
+
+		inline bool has(const std::string& prop) const { return has(getPropertyId(prop)); }
+
+		// NULL if the element doesn't have it
+		const PropertyValue* find(ThemeProperty::PropertyId prop) const;
+		void set(ThemeProperty::PropertyId prop, const PropertyValue& value);
 	};
 
 private:
@@ -117,6 +179,16 @@ private:
 		std::vector<std::string> orderedKeys;
 	};
 
+	// What a single file defines, without its includes. Parsed once per (path, mtime) and shared by
+	// every theme including the file, each theme then merges the fragments of its include chain.
+	class ThemeFragment
+	{
+	public:
+		float version; // -404 if the file doesn't say
+		std::vector< std::pair<std::string, std::string> > includes; // (as written, resolved path), in order
+		std::map<std::string, ThemeView> views;
+	};
+
 public:
 
 	ThemeData();
@@ -137,23 +209,39 @@ public:
 	// If expectedType is an empty string, will do no type checking.
 	const ThemeElement* getElement(const std::string& view, const std::string& element, const std::string& expectedType) const;
 
+	// every element of that type in every view, with its name
+	std::vector< std::pair<std::string, const ThemeElement*> > getElementsOfType(const std::string& type) const;
+
 	static std::vector<GuiComponent*> makeExtras(const std::shared_ptr<ThemeData>& theme, const std::string& view, Window* window);
 
 	static const std::shared_ptr<ThemeData>& getDefault();
 
+	// scanned once, refreshThemeSets() looks at the disk again
 	static std::map<std::string, ThemeSet> getThemeSets();
+	static void refreshThemeSets();
 	static boost::filesystem::path getThemeFromCurrentSet(const std::string& system);
 
 	bool getHasFavoritesInTheme();
 
+	// one line for the startup trace: files parsed, reused and parsed again, time spent loading
+	static void logCacheStats();
+
 private:
 	static std::map< std::string, std::map<std::string, ElementPropertyType> > sElementMap;
 
 	std::deque<boost::filesystem::path> mPaths;
 	float mVersion;
 
-	void parseIncludes(const pugi::xml_node& themeRoot);
-	void parseViews(const pugi::xml_node& themeRoot);
+	struct CachedFragment;
+	static boost::mutex sFragmentCacheMutex;
+	static std::map< std::string, std::shared_ptr<CachedFragment> > sFragmentCache;
+
+	// throw ThemeException, mPaths.back() must be the file
+	std::shared_ptr<const ThemeFragment> getFragment(const std::string& path);
+	std::shared_ptr<const ThemeFragment> parseFragment(const std::string& path);
+	void applyFragment(const ThemeFragment& fragment);
+
+	void parseViews(const pugi::xml_node& themeRoot, std::map<std::string, ThemeView>& views);
 	void parseView(const pugi::xml_node& viewNode, ThemeView& view);
 	void parseElement(const pugi::xml_node& elementNode, const std::map<std::string, ElementPropertyType>& typeMap, ThemeElement& element);
 
@@ -0,0 +1,39 @@
+#include "ThreadPool.h"
+#include <boost/bind.hpp>
+
+ThreadPool* ThreadPool::sInstance = NULL;
+
+ThreadPool* ThreadPool::getInstance()
+{
+	if(sInstance == NULL)
+	{
+		unsigned int cores = boost::thread::hardware_concurrency();
+		sInstance = new ThreadPool(cores > 1 ? cores - 1 : 1);
+	}
+
+	return sInstance;
+}
+
+void ThreadPool::shutdown()
+{
+	delete sInstance;
+	sInstance = NULL;
+}
+
+ThreadPool::ThreadPool(unsigned int threadCount) : mWork(new boost::asio::io_service::work(mService))
+{
+	for(unsigned int i = 0; i < threadCount; i++)
+		mThreads.create_thread(boost::bind(&boost::asio::io_service::run, &mService));
+}
+
+ThreadPool::~ThreadPool()
+{
+	// let queued jobs finish, then stop
+	mWork.reset();
+	mThreads.join_all();
+}
+
+void ThreadPool::post(const std::function<void()>& job)
+{
+	mService.post(job);
+}
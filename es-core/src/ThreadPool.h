@@ -0,0 +1,29 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <boost/asio/io_service.hpp>
+#include <boost/thread.hpp>
+
+// A fixed set of threads running posted jobs in FIFO order.
+// Jobs must not touch OpenGL or the UI, hand results back through state the UI polls.
+class ThreadPool
+{
+public:
+	// shared pool for CPU-bound background work, one thread less than there are cores
+	static ThreadPool* getInstance();
+	// lets queued jobs drain and joins the threads, call at quit once nothing posts anymore
+	static void shutdown();
+
+	ThreadPool(unsigned int threadCount);
+	~ThreadPool();
+
+	void post(const std::function<void()>& job);
+
+private:
+	static ThreadPool* sInstance;
+
+	boost::asio::io_service mService;
+	std::unique_ptr<boost::asio::io_service::work> mWork;
+	boost::thread_group mThreads;
+};
@@ -8,11 +8,17 @@
 #include <iomanip>
 #include "components/HelpComponent.h"
 #include "components/ImageComponent.h"
+#include "resources/TextureLoader.h"
 #include "guis/GuiMsgBox.h"
 #include "RecalboxSystem.h"
 #include "RecalboxConf.h"
 #include "Locale.h"
 
+// read every frame
+static Settings::Bool sDrawFramerate("DrawFramerate");
+static Settings::Int sScreenSaverTime("ScreenSaverTime");
+static Settings::String sScreenSaverBehavior("ScreenSaverBehavior");
+
 Window::Window() : mNormalizeNextUpdate(false), mFrameTimeElapsed(0), mFrameCountElapsed(0), mAverageDeltaTime(10),
 	mAllowSleep(true), mSleeping(false), mTimeSinceLastInput(0), launchKodi(false)
 {
@@ -141,6 +147,8 @@ void Window::input(InputConfig* config, Input input)
 
 void Window::update(int deltaTime)
 {
+	// upload textures decoded in the background
+	TextureLoader::getInstance()->update();
 
         if(!mMessages.empty()){
 		std::string message = mMessages.back();
@@ -160,7 +168,7 @@ void Window::update(int deltaTime)
 	{
 		mAverageDeltaTime = mFrameTimeElapsed / mFrameCountElapsed;
 
-		if(Settings::getInstance()->getBool("DrawFramerate"))
+		if(sDrawFramerate.get())
 		{
 			std::stringstream ss;
 
@@ -210,13 +218,13 @@ void Window::render()
 	if(!mRenderedHelpPrompts)
 		mHelp->render(transform);
 
-	if(Settings::getInstance()->getBool("DrawFramerate") && mFrameDataText)
+	if(sDrawFramerate.get() && mFrameDataText)
 	{
 		Renderer::setMatrix(Eigen::Affine3f::Identity());
 		mDefaultFonts.at(1)->renderTextCache(mFrameDataText.get());
 	}
 
-	unsigned int screensaverTime = (unsigned int)Settings::getInstance()->getInt("ScreenSaverTime");
+	unsigned int screensaverTime = (unsigned int)sScreenSaverTime.get();
 	if(mTimeSinceLastInput >= screensaverTime && screensaverTime != 0)
 	{
 		renderScreenSaver();
@@ -280,9 +288,6 @@ void Window::renderHelpPromptsEarly()
 
 void Window::setHelpPrompts(const std::vector<HelpPrompt>& prompts, const HelpStyle& style)
 {
-	mHelp->clearPrompts();
-	mHelp->setStyle(style);
-
 	std::vector<HelpPrompt> addPrompts;
 
 	std::map<std::string, bool> inputSeenMap;
@@ -344,7 +349,7 @@ void Window::setHelpPrompts(const std::vector<HelpPrompt>& prompts, const HelpSt
 		return aVal > bVal;
 	});
 
-	mHelp->setPrompts(addPrompts);
+	mHelp->setPrompts(addPrompts, style);
 }
 
 
@@ -371,6 +376,6 @@ bool Window::isProcessing()
 void Window::renderScreenSaver()
 {
 	Renderer::setMatrix(Eigen::Affine3f::Identity());
-	unsigned char opacity = Settings::getInstance()->getString("ScreenSaverBehavior") == "dim" ? 0xA0 : 0xFF;
+	unsigned char opacity = sScreenSaverBehavior.get() == "dim" ? 0xA0 : 0xFF;
 	Renderer::drawRect(0, 0, Renderer::getScreenWidth(), Renderer::getScreenHeight(), 0x00000000 | opacity);
 }
@@ -2,6 +2,7 @@
 #include "Renderer.h"
 #include "Settings.h"
 #include "Log.h"
+#include "Metrics.h"
 #include "Util.h"
 #include "components/ImageComponent.h"
 #include "components/TextComponent.h"
@@ -14,6 +15,8 @@
 #define ICON_TEXT_SPACING 8 // space between [icon] and [text] (px)
 #define ENTRY_SPACING 16 // space between [text] and next [icon] (px)
 
+#define MAX_CACHED_GRIDS 8
+
 using namespace Eigen;
 
 static const std::map<std::string, const char*> ICON_PATH_MAP = boost::assign::map_list_of
@@ -31,6 +34,12 @@ static const std::map<std::string, const char*> ICON_PATH_MAP = boost::assign::m
 
 HelpComponent::HelpComponent(Window* window) : GuiComponent(window)
 {
+	mSettingsListener = Settings::getInstance()->addListener("ShowHelpPrompts", [this] { updateGrid(); });
+}
+
+HelpComponent::~HelpComponent()
+{
+	Settings::getInstance()->removeListener(mSettingsListener);
 }
 
 void HelpComponent::clearPrompts()
@@ -45,6 +54,13 @@ void HelpComponent::setPrompts(const std::vector<HelpPrompt>& prompts)
 	updateGrid();
 }
 
+void HelpComponent::setPrompts(const std::vector<HelpPrompt>& prompts, const HelpStyle& style)
+{
+	mPrompts = prompts;
+	mStyle = style;
+	updateGrid();
+}
+
 void HelpComponent::setStyle(const HelpStyle& style)
 {
 	mStyle = style;
@@ -53,15 +69,45 @@ void HelpComponent::setStyle(const HelpStyle& style)
 
 void HelpComponent::updateGrid()
 {
-	if(!Settings::getInstance()->getBool("ShowHelpPrompts") || mPrompts.empty())
+	static Settings::Bool showHelpPrompts("ShowHelpPrompts");
+	static Metrics::Counter& built = Metrics::counter("help.grids_built");
+	static Metrics::Counter& reused = Metrics::counter("help.grids_reused");
+
+	if(!showHelpPrompts.get() || mPrompts.empty())
 	{
 		mGrid.reset();
 		return;
 	}
 
+	for(auto it = mGridCache.begin(); it != mGridCache.end(); it++)
+	{
+		if(it->prompts == mPrompts && it->style == mStyle)
+		{
+			mGridCache.splice(mGridCache.begin(), mGridCache, it);
+			mGrid = it->grid;
+			setOpacity(getOpacity()); // it may have been faded since
+			reused.add();
+			return;
+		}
+	}
+
+	mGrid = buildGrid();
+	built.add();
+
+	CachedGrid cached;
+	cached.prompts = mPrompts;
+	cached.style = mStyle;
+	cached.grid = mGrid;
+	mGridCache.push_front(cached);
+	if(mGridCache.size() > MAX_CACHED_GRIDS)
+		mGridCache.pop_back();
+}
+
+std::shared_ptr<ComponentGrid> HelpComponent::buildGrid()
+{
 	std::shared_ptr<Font>& font = mStyle.font;
 
-	mGrid = std::make_shared<ComponentGrid>(mWindow, Vector2i(mPrompts.size() * 4, 1));
+	std::shared_ptr<ComponentGrid> grid = std::make_shared<ComponentGrid>(mWindow, Vector2i(mPrompts.size() * 4, 1));
 	// [icon] [spacer1] [text] [spacer2]
 	
 	std::vector< std::shared_ptr<ImageComponent> > icons;
@@ -83,20 +129,21 @@ void HelpComponent::updateGrid()
 		width += icon->getSize().x() + lbl->getSize().x() + ICON_TEXT_SPACING + ENTRY_SPACING;
 	}
 
-	mGrid->setSize(width, height);
+	grid->setSize(width, height);
 	for(unsigned int i = 0; i < icons.size(); i++)
 	{
 		const int col = i*4;
-		mGrid->setColWidthPerc(col, icons.at(i)->getSize().x() / width);
-		mGrid->setColWidthPerc(col + 1, ICON_TEXT_SPACING / width);
-		mGrid->setColWidthPerc(col + 2, labels.at(i)->getSize().x() / width);
+		grid->setColWidthPerc(col, icons.at(i)->getSize().x() / width);
+		grid->setColWidthPerc(col + 1, ICON_TEXT_SPACING / width);
+		grid->setColWidthPerc(col + 2, labels.at(i)->getSize().x() / width);
 
-		mGrid->setEntry(icons.at(i), Vector2i(col, 0), false, false);
-		mGrid->setEntry(labels.at(i), Vector2i(col + 2, 0), false, false);
+		grid->setEntry(icons.at(i), Vector2i(col, 0), false, false);
+		grid->setEntry(labels.at(i), Vector2i(col + 2, 0), false, false);
 	}
 
-	mGrid->setPosition(Eigen::Vector3f(mStyle.position.x(), mStyle.position.y(), 0.0f));
-	//mGrid->setPosition(OFFSET_X, Renderer::getScreenHeight() - mGrid->getSize().y() - OFFSET_Y);
+	grid->setPosition(Eigen::Vector3f(mStyle.position.x(), mStyle.position.y(), 0.0f));
+	//grid->setPosition(OFFSET_X, Renderer::getScreenHeight() - grid->getSize().y() - OFFSET_Y);
+	return grid;
 }
 
 std::shared_ptr<TextureResource> HelpComponent::getIconTexture(const char* name)
@@ -126,6 +173,9 @@ void HelpComponent::setOpacity(unsigned char opacity)
 {
 	GuiComponent::setOpacity(opacity);
 
+	if(!mGrid)
+		return;
+
 	for(unsigned int i = 0; i < mGrid->getChildCount(); i++)
 	{
 		mGrid->getChild(i)->setOpacity(opacity);
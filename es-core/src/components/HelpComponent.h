@@ -2,6 +2,7 @@
 
 #include "GuiComponent.h"
 #include "HelpStyle.h"
+#include <list>
 
 class ImageComponent;
 class TextureResource;
@@ -11,9 +12,11 @@ class HelpComponent : public GuiComponent
 {
 public:
 	HelpComponent(Window* window);
+	~HelpComponent();
 
 	void clearPrompts();
 	void setPrompts(const std::vector<HelpPrompt>& prompts);
+	void setPrompts(const std::vector<HelpPrompt>& prompts, const HelpStyle& style);
 
 	void render(const Eigen::Affine3f& parent) override;
 	void setOpacity(unsigned char opacity) override;
@@ -26,7 +29,19 @@ private:
 
 	std::shared_ptr<ComponentGrid> mGrid;
 	void updateGrid();
+	std::shared_ptr<ComponentGrid> buildGrid();
+
+	// the bars built last, most recently used first: views and menus go back to the same few all the time
+	struct CachedGrid
+	{
+		std::vector<HelpPrompt> prompts;
+		HelpStyle style;
+		std::shared_ptr<ComponentGrid> grid;
+	};
+	std::list<CachedGrid> mGridCache;
 
 	std::vector<HelpPrompt> mPrompts;
 	HelpStyle mStyle;
+
+	int mSettingsListener;
 };
@@ -2,6 +2,8 @@
 
 #include <string>
 #include <vector>
+#include <map>
+#include <algorithm>
 #include <memory>
 #include "GuiComponent.h"
 #include "components/ImageComponent.h"
@@ -228,6 +230,74 @@ public:
 		return false;
 	}
 
+	// Replaces every entry with the given ones, keeping the data (e.g. text caches) of the entries
+	// whose object and name did not change. The cursor stays on the same object if it is still listed.
+	void replaceEntries(std::vector<Entry>& entries)
+	{
+		std::multimap<UserData, Entry*> previous;
+		for(auto it = mEntries.begin(); it != mEntries.end(); it++)
+			previous.insert(std::make_pair(it->object, &(*it)));
+
+		int cursor = -1;
+		const bool hadSelection = !mEntries.empty();
+		for(unsigned int i = 0; i < entries.size(); i++)
+		{
+			auto range = previous.equal_range(entries[i].object);
+			for(auto it = range.first; it != range.second; it++)
+			{
+				if(it->second->name == entries[i].name)
+				{
+					entries[i].data = it->second->data;
+					previous.erase(it);
+					break;
+				}
+			}
+
+			if(cursor == -1 && hadSelection && entries[i].object == getSelected())
+				cursor = i;
+		}
+
+		mEntries.swap(entries);
+
+		if(cursor == -1)
+			cursor = mCursor < size() ? mCursor : size() - 1;
+		mCursor = cursor < 0 ? 0 : cursor;
+		onCursorChanged(CURSOR_STOPPED);
+	}
+
+	// Moves the entry at index from to index to, the cursor stays on the entry it was on.
+	void moveEntry(int from, int to)
+	{
+		if(from == to)
+			return;
+
+		if(from < to)
+			std::rotate(mEntries.begin() + from, mEntries.begin() + from + 1, mEntries.begin() + to + 1);
+		else
+			std::rotate(mEntries.begin() + to, mEntries.begin() + from, mEntries.begin() + from + 1);
+
+		if(mCursor == from)
+			mCursor = to;
+		else if(from < mCursor && mCursor <= to)
+			mCursor--;
+		else if(to <= mCursor && mCursor < from)
+			mCursor++;
+	}
+
+	// indexes of every entry showing obj, in list order
+	std::vector<int> getIndexes(const UserData& obj) const
+	{
+		std::vector<int> indexes;
+		for(unsigned int i = 0; i < mEntries.size(); i++)
+		{
+			if(mEntries[i].object == obj)
+				indexes.push_back(i);
+		}
+		return indexes;
+	}
+
+	inline const std::string& getName(int index) const { return mEntries.at(index).name; }
+
 	inline int size() const { return mEntries.size(); }
 
 	inline bool isEmpty() const { return mEntries.empty(); }
@@ -3,11 +3,15 @@
 #include "GuiComponent.h"
 #include "components/IList.h"
 #include "components/ImageComponent.h"
+#include "resources/ResourceManager.h"
 #include "Log.h"
+#include <algorithm>
+#include <map>
 
 struct ImageGridData
 {
-	std::shared_ptr<TextureResource> texture;
+	// textures are only loaded while the entry is on screen (or close to it), see updateImages()
+	std::string texturePath;
 };
 
 template<typename T>
@@ -21,10 +25,10 @@ protected:
 	using IList<ImageGridData, T>::getTransform;
 	using IList<ImageGridData, T>::mSize;
 	using IList<ImageGridData, T>::mCursor;
-    using typename IList<ImageGridData, T>::Entry;
 	using IList<ImageGridData, T>::mWindow;
 
 public:
+	using typename IList<ImageGridData, T>::Entry;
 	using IList<ImageGridData, T>::size;
 	using IList<ImageGridData, T>::isScrolling;
 	using IList<ImageGridData, T>::stopScrolling;
@@ -32,7 +36,10 @@ public:
 	ImageGridComponent(Window* window);
 
 	void add(const std::string& name, const std::string& imagePath, const T& obj);
-	
+
+	// Replaces all entries at once, keeping the cursor on the same object if it is still there.
+	void replaceEntries(std::vector<Entry>& entries);
+
 	void onSizeChanged() override;
 
 	bool input(InputConfig* config, Input input) override;
@@ -40,43 +47,15 @@ public:
 	void render(const Eigen::Affine3f& parentTrans) override;
 
 private:
-	Eigen::Vector2f getSquareSize(std::shared_ptr<TextureResource> tex = nullptr) const
-	{
-		Eigen::Vector2f aspect(1, 1);
-
-		if(tex)
-		{
-			const Eigen::Vector2i& texSize = tex->getSize();
+	// rows kept loaded above and below the visible ones
+	static const int PREFETCH_ROWS = 2;
 
-			if(texSize.x() > texSize.y())
-				aspect[0] = (float)texSize.x() / texSize.y();
-			else
-				aspect[1] = (float)texSize.y() / texSize.x();
-		}
-
-		return Eigen::Vector2f(156 * aspect.x(), 156 * aspect.y());
-	};
-
-	Eigen::Vector2f getMaxSquareSize() const
-	{
-		Eigen::Vector2f squareSize(32, 32);
-
-		// calc biggest square size
-		for(auto it = mEntries.begin(); it != mEntries.end(); it++)
-		{
-			Eigen::Vector2f chkSize = getSquareSize(it->data.texture);
-			if(chkSize.x() > squareSize.x())
-				squareSize[0] = chkSize[0];
-			if(chkSize.y() > squareSize.y())
-				squareSize[1] = chkSize[1];
-		}
-
-		return squareSize;
-	};
+	// images are fit into fixed squares, so the layout never depends on a texture being loaded
+	Eigen::Vector2f getSquareSize() const { return Eigen::Vector2f(156, 156); }
 
 	Eigen::Vector2i getGridSize() const
 	{
-		Eigen::Vector2f squareSize = getMaxSquareSize();
+		Eigen::Vector2f squareSize = getSquareSize();
 		Eigen::Vector2i gridSize(mSize.x() / (squareSize.x() + getPadding().x()), mSize.y() / (squareSize.y() + getPadding().y()));
 		return gridSize;
 	};
@@ -86,11 +65,20 @@ private:
 	void buildImages();
 	void updateImages();
 
+	std::shared_ptr<TextureResource> getTexture(const std::string& path, std::map< std::string, std::shared_ptr<TextureResource> >& oldTextures);
+
 	virtual void onCursorChanged(const CursorState& state);
 
 	bool mEntriesDirty;
 
 	std::vector<ImageComponent> mImages;
+
+	// texture shown (or about to be shown) by each of mImages
+	std::vector< std::shared_ptr<TextureResource> > mImageTextures;
+
+	// textures of the visible entries plus the prefetch band, by path
+	// anything else is released as soon as it leaves the band
+	std::map< std::string, std::shared_ptr<TextureResource> > mBandTextures;
 };
 
 template<typename T>
@@ -105,11 +93,18 @@ void ImageGridComponent<T>::add(const std::string& name, const std::string& imag
 	typename IList<ImageGridData, T>::Entry entry;
 	entry.name = name;
 	entry.object = obj;
-	entry.data.texture = ResourceManager::getInstance()->fileExists(imagePath) ? TextureResource::get(imagePath) : TextureResource::get(":/button.png");
+	entry.data.texturePath = imagePath;
 	static_cast<IList< ImageGridData, T >*>(this)->add(entry);
 	mEntriesDirty = true;
 }
 
+template<typename T>
+void ImageGridComponent<T>::replaceEntries(std::vector<Entry>& entries)
+{
+	IList<ImageGridData, T>::replaceEntries(entries);
+	mEntriesDirty = true;
+}
+
 template<typename T>
 bool ImageGridComponent<T>::input(InputConfig* config, Input input)
 {
@@ -144,6 +139,19 @@ template<typename T>
 void ImageGridComponent<T>::update(int deltaTime)
 {
 	listUpdate(deltaTime);
+
+	// show textures that finished loading since the last frame
+	for(unsigned int i = 0; i < mImages.size() && i < mImageTextures.size(); i++)
+	{
+		std::shared_ptr<TextureResource>& tex = mImageTextures.at(i);
+
+		// could not be decoded, show the placeholder of entries without an image instead
+		if(tex && tex->isFailed())
+			tex = getTexture("", mBandTextures);
+
+		if(tex && tex->isInitialized() && !mImages.at(i).hasImage())
+			mImages.at(i).setImage(tex);
+	}
 }
 
 template<typename T>
@@ -184,9 +192,10 @@ template<typename T>
 void ImageGridComponent<T>::buildImages()
 {
 	mImages.clear();
+	mImageTextures.clear();
 
 	Eigen::Vector2i gridSize = getGridSize();
-	Eigen::Vector2f squareSize = getMaxSquareSize();
+	Eigen::Vector2f squareSize = getSquareSize();
 	Eigen::Vector2f padding = getPadding();
 
 	// attempt to center within our size
@@ -203,10 +212,25 @@ void ImageGridComponent<T>::buildImages()
 
 			image.setPosition((squareSize.x() + padding.x()) * (x + 0.5f) + offset.x(), (squareSize.y() + padding.y()) * (y + 0.5f) + offset.y());
 			image.setOrigin(0.5f, 0.5f);
-			image.setResize(squareSize.x(), squareSize.y());
+			image.setMaxSize(squareSize.x(), squareSize.y());
 			image.setImage("");
 		}
 	}
+
+	mImageTextures.resize(mImages.size());
+}
+
+template<typename T>
+std::shared_ptr<TextureResource> ImageGridComponent<T>::getTexture(const std::string& path, std::map< std::string, std::shared_ptr<TextureResource> >& oldTextures)
+{
+	auto it = oldTextures.find(path);
+	if(it != oldTextures.end())
+		return it->second;
+
+	if(!path.empty() && ResourceManager::getInstance()->fileExists(path))
+		return TextureResource::get(path, false, true);
+
+	return TextureResource::get(":/button.png", false, true);
 }
 
 template<typename T>
@@ -216,9 +240,10 @@ void ImageGridComponent<T>::updateImages()
 		buildImages();
 
 	Eigen::Vector2i gridSize = getGridSize();
+	if(gridSize.x() <= 0 || gridSize.y() <= 0)
+		return;
 
 	int cursorRow = mCursor / gridSize.x();
-	int cursorCol = mCursor % gridSize.x();
 
 	int start = (cursorRow - (gridSize.y() / 2)) * gridSize.x();
 
@@ -229,6 +254,24 @@ void ImageGridComponent<T>::updateImages()
 	if(start < 0)
 		start = 0;
 
+	// (re)load the visible entries first, then the prefetch band around them
+	std::map< std::string, std::shared_ptr<TextureResource> > bandTextures;
+	const int visibleEnd = std::min(start + (int)mImages.size(), (int)mEntries.size());
+	const int bandStart = std::max(start - PREFETCH_ROWS * gridSize.x(), 0);
+	const int bandEnd = std::min(visibleEnd + PREFETCH_ROWS * gridSize.x(), (int)mEntries.size());
+
+	for(int i = start; i < visibleEnd; i++)
+	{
+		const std::string& path = mEntries.at(i).data.texturePath;
+		bandTextures[path] = getTexture(path, mBandTextures);
+	}
+	for(int i = bandStart; i < bandEnd; i++)
+	{
+		const std::string& path = mEntries.at(i).data.texturePath;
+		if(bandTextures.find(path) == bandTextures.end())
+			bandTextures[path] = getTexture(path, mBandTextures);
+	}
+
 	unsigned int i = (unsigned int)start;
 	for(unsigned int img = 0; img < mImages.size(); img++)
 	{
@@ -236,20 +279,33 @@ void ImageGridComponent<T>::updateImages()
 		if(i >= (unsigned int)size())
 		{
 			image.setImage("");
+			mImageTextures.at(img).reset();
 			continue;
 		}
 
-		Eigen::Vector2f squareSize = getSquareSize(mEntries.at(i).data.texture);
+		Eigen::Vector2f squareSize = getSquareSize();
 		if(i == mCursor)
 		{
 			image.setColorShift(0xFFFFFFFF);
-			image.setResize(squareSize.x() + getPadding().x() * 0.95f, squareSize.y() + getPadding().y() * 0.95f);
+			image.setMaxSize(squareSize.x() + getPadding().x() * 0.95f, squareSize.y() + getPadding().y() * 0.95f);
 		}else{
 			image.setColorShift(0xAAAAAABB);
-			image.setResize(squareSize.x(), squareSize.y());
+			image.setMaxSize(squareSize.x(), squareSize.y());
 		}
 
-		image.setImage(mEntries.at(i).data.texture);
+		// not loaded yet, update() will pick it up once it is
+		std::shared_ptr<TextureResource> tex = bandTextures[mEntries.at(i).data.texturePath];
+		if(tex->isFailed())
+			tex = getTexture("", bandTextures);
+		mImageTextures.at(img) = tex;
+		if(tex->isInitialized())
+			image.setImage(tex);
+		else
+			image.setImage("");
+
 		i++;
 	}
+
+	// releases everything that left the band
+	mBandTextures.swap(bandTextures);
 }
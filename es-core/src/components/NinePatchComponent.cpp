@@ -143,7 +143,7 @@ void NinePatchComponent::render(const Eigen::Affine3f& parentTrans)
 {
 	Eigen::Affine3f trans = roundMatrix(parentTrans * getTransform());
 	
-	if(mTexture && mVertices != NULL)
+	if(mTexture && mTexture->isInitialized() && mVertices != NULL)
 	{
 		Renderer::setMatrix(trans);
 
@@ -222,6 +222,6 @@ void NinePatchComponent::applyTheme(const std::shared_ptr<ThemeData>& theme, con
 	if(!elem)
 		return;
 
-	if(properties & PATH && elem->has("path"))
-		setImagePath(elem->get<std::string>("path"));
+	if(properties & PATH && elem->has(ThemeProperty::PATH))
+		setImagePath(elem->get<std::string>(ThemeProperty::PATH));
 }
@@ -28,7 +28,7 @@ bool SliderComponent::input(InputConfig* config, Input input)
 	if(config->isMappedTo("left", input))
 	{
 		if(input.value)
-			setValue(mValue - mSingleIncrement);
+			slideTo(mValue - mSingleIncrement);
 
 		mMoveRate = input.value ? -mSingleIncrement : 0;
 		mMoveAccumulator = -MOVE_REPEAT_DELAY;
@@ -37,7 +37,7 @@ bool SliderComponent::input(InputConfig* config, Input input)
 	if(config->isMappedTo("right", input))
 	{
 		if(input.value)
-			setValue(mValue + mSingleIncrement);
+			slideTo(mValue + mSingleIncrement);
 
 		mMoveRate = input.value ? mSingleIncrement : 0;
 		mMoveAccumulator = -MOVE_REPEAT_DELAY;
@@ -54,7 +54,7 @@ void SliderComponent::update(int deltaTime)
 		mMoveAccumulator += deltaTime;
 		while(mMoveAccumulator >= MOVE_REPEAT_RATE)
 		{
-			setValue(mValue + mMoveRate);
+			slideTo(mValue + mMoveRate);
 			mMoveAccumulator -= MOVE_REPEAT_RATE;
 		}
 	}
@@ -99,6 +99,13 @@ float SliderComponent::getValue()
 	return mValue;
 }
 
+void SliderComponent::slideTo(float value)
+{
+	setValue(value);
+	if(mSlideCallback)
+		mSlideCallback(mValue);
+}
+
 void SliderComponent::onSizeChanged()
 {
 	if(!mSuffix.empty())
@@ -16,6 +16,9 @@ public:
 	void setValue(float val);
 	float getValue();
 
+	// called when the user moves the slider, not by setValue()
+	inline void setSlideCallback(const std::function<void(float)>& callback) { mSlideCallback = callback; }
+
 	bool input(InputConfig* config, Input input) override;
 	void update(int deltaTime) override;
 	void render(const Eigen::Affine3f& parentTrans) override;
@@ -26,6 +29,7 @@ public:
 
 private:
 	void onValueChanged();
+	void slideTo(float value);
 
 	float mMin, mMax;
 	float mValue;
@@ -38,4 +42,6 @@ private:
 	std::string mSuffix;
 	std::shared_ptr<Font> mFont;
 	std::shared_ptr<TextCache> mValueCache;
+
+	std::function<void(float)> mSlideCallback;
 };
@@ -1,11 +1,13 @@
 #include "resources/Font.h"
 #include <iostream>
+#include <string.h>
 #include <algorithm>
 #include <vector>
 #include <boost/filesystem.hpp>
 #include "Renderer.h"
 #include "Log.h"
 #include "Util.h"
+#include "resources/ResidentCache.h"
 
 FT_Library Font::sLibrary = NULL;
 
@@ -212,6 +214,7 @@ Font::Font(int size, const std::string& path) : mSize(size), mPath(path)
 Font::~Font()
 {
 	unload(ResourceManager::getInstance());
+	ResidentCache::getInstance()->removeAll(this);
 }
 
 void Font::reload(std::shared_ptr<ResourceManager>& rm)
@@ -221,6 +224,20 @@ void Font::reload(std::shared_ptr<ResourceManager>& rm)
 
 void Font::unload(std::shared_ptr<ResourceManager>& rm)
 {
+	// compressed while the textures are gone, rebuildTextures() gets them back
+	if(ResidentCache::isEnabled())
+	{
+		for(size_t i = 0; i < mTextures.size(); i++)
+		{
+			FontTexture& tex = mTextures[i];
+			if(tex.pixels.empty())
+				continue;
+
+			ResidentCache::getInstance()->store(ResidentCache::Key(this, i), tex.pixels.data(), tex.textureSize.x(), tex.textureSize.y(), 1);
+			std::vector<unsigned char>().swap(tex.pixels);
+		}
+	}
+
 	unloadTextures();
 }
 
@@ -309,7 +326,21 @@ void Font::FontTexture::initTexture()
 	glPixelStorei(GL_PACK_ALIGNMENT, 1);
 	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, textureSize.x(), textureSize.y(), 0, GL_ALPHA, GL_UNSIGNED_BYTE, NULL);
+	if(ResidentCache::isEnabled() && pixels.empty())
+		pixels.assign(textureSize.x() * textureSize.y(), 0);
+	else if(!ResidentCache::isEnabled())
+		std::vector<unsigned char>().swap(pixels);
+
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, textureSize.x(), textureSize.y(), 0, GL_ALPHA, GL_UNSIGNED_BYTE, pixels.empty() ? NULL : pixels.data());
+}
+
+void Font::FontTexture::copyGlyph(const Eigen::Vector2i& cursor, const Eigen::Vector2i& size, const unsigned char* bitmap)
+{
+	if(pixels.empty())
+		return;
+
+	for(int y = 0; y < size.y(); y++)
+		memcpy(&pixels[(cursor.y() + y) * textureSize.x() + cursor.x()], bitmap + y * size.x(), size.x());
 }
 
 void Font::FontTexture::deinitTexture()
@@ -484,6 +515,7 @@ Font::Glyph* Font::getGlyph(UnicodeChar id)
 	glBindTexture(GL_TEXTURE_2D, tex->textureId);
 	glTexSubImage2D(GL_TEXTURE_2D, 0, cursor.x(), cursor.y(), glyphSize.x(), glyphSize.y(), GL_ALPHA, GL_UNSIGNED_BYTE, g->bitmap.buffer);
 	glBindTexture(GL_TEXTURE_2D, 0);
+	tex->copyGlyph(cursor, glyphSize, g->bitmap.buffer);
 
 	// update max glyph height
 	if(glyphSize.y() > mMaxGlyphHeight)
@@ -496,6 +528,21 @@ Font::Glyph* Font::getGlyph(UnicodeChar id)
 // completely recreate the texture data for all textures based on mGlyphs information
 void Font::rebuildTextures()
 {
+	// if the ResidentCache kept every texture, uploading them is all there is to do
+	bool restored = !mTextures.empty();
+	for(size_t i = 0; i < mTextures.size(); i++)
+	{
+		size_t width, height;
+		FontTexture& tex = mTextures[i];
+		if(!ResidentCache::getInstance()->restore(ResidentCache::Key(this, i), tex.pixels, width, height) ||
+			(int)width != tex.textureSize.x() || (int)height != tex.textureSize.y())
+		{
+			std::vector<unsigned char>().swap(tex.pixels);
+			restored = false;
+		}
+	}
+	ResidentCache::getInstance()->removeAll(this);
+
 	// recreate OpenGL textures
 	for(auto it = mTextures.begin(); it != mTextures.end(); it++)
 	{
@@ -503,6 +550,9 @@ void Font::rebuildTextures()
 		it->initTexture();
 	}
 
+	if(restored)
+		return;
+
 	// reupload the texture data
 	for(auto it = mGlyphMap.begin(); it != mGlyphMap.end(); it++)
 	{
@@ -521,6 +571,7 @@ void Font::rebuildTextures()
 		// upload to texture
 		glBindTexture(GL_TEXTURE_2D, tex->textureId);
 		glTexSubImage2D(GL_TEXTURE_2D, 0, cursor.x(), cursor.y(), glyphSize.x(), glyphSize.y(), GL_ALPHA, GL_UNSIGNED_BYTE, glyphSlot->bitmap.buffer);
+		tex->copyGlyph(cursor, glyphSize, glyphSlot->bitmap.buffer);
 	}
 
 	glBindTexture(GL_TEXTURE_2D, 0);
@@ -842,10 +893,10 @@ std::shared_ptr<Font> Font::getFromTheme(const ThemeData::ThemeElement* elem, un
 	std::string path = (orig ? orig->mPath : getDefaultPath());
 
 	float sh = (float)Renderer::getScreenHeight();
-	if(properties & FONT_SIZE && elem->has("fontSize")) 
-		size = (int)(sh * elem->get<float>("fontSize"));
-	if(properties & FONT_PATH && elem->has("fontPath"))
-		path = elem->get<std::string>("fontPath");
+	if(properties & FONT_SIZE && elem->has(ThemeProperty::FONT_SIZE)) 
+		size = (int)(sh * elem->get<float>(ThemeProperty::FONT_SIZE));
+	if(properties & FONT_PATH && elem->has(ThemeProperty::FONT_PATH))
+		path = elem->get<std::string>(ThemeProperty::FONT_PATH);
 
 	return get(size, path);
 }
@@ -83,6 +83,9 @@ private:
 		Eigen::Vector2i writePos;
 		int rowHeight;
 
+		// a copy of the texture, only kept with the ResidentCache on so it can be handed over at unload
+		std::vector<unsigned char> pixels;
+
 		FontTexture();
 		~FontTexture();
 		bool findEmpty(const Eigen::Vector2i& size, Eigen::Vector2i& cursor_out);
@@ -90,6 +93,7 @@ private:
 		// you must call initTexture() after creating a FontTexture to get a textureId
 		void initTexture(); // initializes the OpenGL texture according to this FontTexture's settings, updating textureId
 		void deinitTexture(); // deinitializes the OpenGL texture if any exists, is automatically called in the destructor
+		void copyGlyph(const Eigen::Vector2i& cursor, const Eigen::Vector2i& size, const unsigned char* bitmap); // to pixels, if kept
 	};
 
 	struct FontFace
@@ -0,0 +1,214 @@
+#include "resources/ResidentCache.h"
+#include "Metrics.h"
+#include "Settings.h"
+#include <string.h>
+
+// a run header is followed by one pixel repeated (header - 127) + 1 times, or by header + 1 literal pixels
+#define MAX_RUN 128
+
+static size_t encode(const unsigned char* pixels, size_t count, size_t bpp, std::vector<unsigned char>& out)
+{
+	out.clear();
+	out.reserve(count * bpp / 2);
+
+	size_t i = 0;
+	while(i < count)
+	{
+		// length of the run of identical pixels starting here
+		size_t run = 1;
+		while(i + run < count && run < MAX_RUN && memcmp(pixels + i * bpp, pixels + (i + run) * bpp, bpp) == 0)
+			run++;
+
+		if(run > 1)
+		{
+			out.push_back((unsigned char)(127 + run - 1));
+			out.insert(out.end(), pixels + i * bpp, pixels + (i + 1) * bpp);
+			i += run;
+			continue;
+		}
+
+		// literals, up to the next pair of identical pixels
+		size_t literals = 1;
+		while(i + literals < count && literals < MAX_RUN &&
+			(i + literals + 1 >= count || memcmp(pixels + (i + literals) * bpp, pixels + (i + literals + 1) * bpp, bpp) != 0))
+			literals++;
+
+		out.push_back((unsigned char)(literals - 1));
+		out.insert(out.end(), pixels + i * bpp, pixels + (i + literals) * bpp);
+		i += literals;
+
+		// not worth it, the caller keeps the raw pixels
+		if(out.size() >= count * bpp)
+			return 0;
+	}
+
+	return out.size();
+}
+
+static bool decode(const std::vector<unsigned char>& in, size_t bpp, unsigned char* out, size_t size)
+{
+	const unsigned char* src = in.data();
+	const unsigned char* end = src + in.size();
+	unsigned char* dst = out;
+	unsigned char* dstEnd = out + size;
+
+	while(src < end)
+	{
+		const unsigned char header = *src++;
+		if(header > 127)
+		{
+			const size_t run = header - 127 + 1;
+			if(src + bpp > end || dst + run * bpp > dstEnd)
+				return false;
+
+			if(bpp == 4)
+			{
+				unsigned int pixel;
+				memcpy(&pixel, src, 4);
+				for(size_t i = 0; i < run; i++)
+					memcpy(dst + i * 4, &pixel, 4);
+			}else{
+				for(size_t i = 0; i < run; i++)
+					memcpy(dst + i * bpp, src, bpp);
+			}
+
+			src += bpp;
+			dst += run * bpp;
+		}else{
+			const size_t bytes = (header + 1) * bpp;
+			if(src + bytes > end || dst + bytes > dstEnd)
+				return false;
+
+			memcpy(dst, src, bytes);
+			src += bytes;
+			dst += bytes;
+		}
+	}
+
+	return dst == dstEnd;
+}
+
+ResidentCache* ResidentCache::sInstance = NULL;
+
+ResidentCache* ResidentCache::getInstance()
+{
+	if(sInstance == NULL)
+		sInstance = new ResidentCache();
+
+	return sInstance;
+}
+
+bool ResidentCache::isEnabled()
+{
+	return Settings::getInstance()->getBool("ResidentAssets");
+}
+
+ResidentCache::ResidentCache() : mSize(0)
+{
+}
+
+void ResidentCache::store(const Key& key, const unsigned char* pixels, size_t width, size_t height, size_t bytesPerPixel)
+{
+	static Metrics::Counter& evicted = Metrics::counter("resident.evicted");
+
+	const size_t budget = (size_t)Settings::getInstance()->getInt("ResidentAssetsBudget") * 1024 * 1024;
+	const size_t rawSize = width * height * bytesPerPixel;
+	if(rawSize == 0)
+		return;
+
+	Entry entry;
+	entry.width = width;
+	entry.height = height;
+	entry.bytesPerPixel = bytesPerPixel;
+	entry.compressed = encode(pixels, width * height, bytesPerPixel, entry.data) != 0;
+	if(!entry.compressed)
+		entry.data.assign(pixels, pixels + rawSize);
+	entry.data.shrink_to_fit();
+
+	boost::mutex::scoped_lock lock(mMutex);
+
+	auto found = mEntries.find(key);
+	if(found != mEntries.end())
+		erase(found);
+
+	if(entry.data.size() > budget)
+		return;
+
+	while(mSize + entry.data.size() > budget && !mLRU.empty())
+	{
+		erase(mEntries.find(mLRU.back()));
+		evicted.add();
+	}
+
+	mSize += entry.data.size();
+	mLRU.push_front(key);
+	entry.lru = mLRU.begin();
+	mEntries[key] = std::move(entry);
+}
+
+bool ResidentCache::contains(const Key& key)
+{
+	boost::mutex::scoped_lock lock(mMutex);
+	return mEntries.find(key) != mEntries.end();
+}
+
+bool ResidentCache::restore(const Key& key, std::vector<unsigned char>& pixels, size_t& width, size_t& height)
+{
+	static Metrics::Counter& restored = Metrics::counter("resident.restored_bytes");
+
+	boost::mutex::scoped_lock lock(mMutex);
+
+	auto found = mEntries.find(key);
+	if(found == mEntries.end())
+		return false;
+
+	Entry& entry = found->second;
+	mLRU.splice(mLRU.begin(), mLRU, entry.lru);
+
+	pixels.resize(entry.width * entry.height * entry.bytesPerPixel);
+	if(entry.compressed)
+	{
+		if(!decode(entry.data, entry.bytesPerPixel, pixels.data(), pixels.size()))
+		{
+			erase(found);
+			return false;
+		}
+	}else{
+		memcpy(pixels.data(), entry.data.data(), pixels.size());
+	}
+
+	width = entry.width;
+	height = entry.height;
+	restored.add(pixels.size());
+	return true;
+}
+
+void ResidentCache::remove(const Key& key)
+{
+	boost::mutex::scoped_lock lock(mMutex);
+
+	auto found = mEntries.find(key);
+	if(found != mEntries.end())
+		erase(found);
+}
+
+void ResidentCache::removeAll(const void* owner)
+{
+	boost::mutex::scoped_lock lock(mMutex);
+
+	auto it = mEntries.lower_bound(Key(owner, 0));
+	while(it != mEntries.end() && it->first.first == owner)
+	{
+		auto next = it;
+		next++;
+		erase(it);
+		it = next;
+	}
+}
+
+void ResidentCache::erase(std::map<Key, Entry>::iterator it)
+{
+	mSize -= it->second.data.size();
+	mLRU.erase(it->second.lru);
+	mEntries.erase(it);
+}
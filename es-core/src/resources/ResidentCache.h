@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stddef.h>
+#include <list>
+#include <map>
+#include <utility>
+#include <vector>
+#include <boost/thread/mutex.hpp>
+
+// Compressed copies of decoded pixels, so textures and glyph atlases can be uploaded again without
+// decoding or rendering anything when the renderer comes back after a game (see Window::init).
+// Only used if the "ResidentAssets" setting is on; past "ResidentAssetsBudget" MB the least recently
+// used copies are dropped and those assets are loaded the slow way.
+//
+// Pixels are run-length encoded a pixel at a time: UI art has long runs of transparent or flat
+// pixels and decoding it is about as fast as copying. Anything that doesn't shrink is kept as is.
+class ResidentCache
+{
+public:
+	static ResidentCache* getInstance();
+	static bool isEnabled();
+
+	// an owner can keep several images apart with slot
+	typedef std::pair<const void*, size_t> Key;
+
+	// replaces what was stored for key
+	void store(const Key& key, const unsigned char* pixels, size_t width, size_t height, size_t bytesPerPixel);
+	bool contains(const Key& key);
+
+	// false if nothing was stored or it was dropped, any thread
+	bool restore(const Key& key, std::vector<unsigned char>& pixels, size_t& width, size_t& height);
+
+	void remove(const Key& key);
+	void removeAll(const void* owner);
+
+private:
+	ResidentCache();
+
+	struct Entry
+	{
+		std::vector<unsigned char> data;
+		size_t width;
+		size_t height;
+		size_t bytesPerPixel;
+		bool compressed;
+		std::list<Key>::iterator lru;
+	};
+
+	static ResidentCache* sInstance;
+
+	void erase(std::map<Key, Entry>::iterator it);
+
+	boost::mutex mMutex;
+	std::map<Key, Entry> mEntries;
+	std::list<Key> mLRU; // most recently used first
+	size_t mSize; // compressed bytes
+};
@@ -2,6 +2,8 @@
 #include "Log.h"
 #include "../data/Resources.h"
 #include <fstream>
+#include <algorithm>
+#include <vector>
 #include <boost/filesystem.hpp>
 
 namespace fs = boost::filesystem;
@@ -93,17 +95,28 @@ void ResourceManager::unloadAll()
 
 void ResourceManager::reloadAll()
 {
+	std::vector< std::shared_ptr<IReloadable> > reloadables;
+	reloadables.reserve(mReloadables.size());
+
 	auto iter = mReloadables.begin();
 	while(iter != mReloadables.end())
 	{
 		if(!iter->expired())
 		{
-			iter->lock()->reload(sInstance);
+			reloadables.push_back(iter->lock());
 			iter++;
 		}else{
 			iter = mReloadables.erase(iter);
 		}
 	}
+
+	// most recently drawn first, the rest keeps its order
+	std::stable_sort(reloadables.begin(), reloadables.end(), [](const std::shared_ptr<IReloadable>& a, const std::shared_ptr<IReloadable>& b) {
+		return a->getLastUsed() > b->getLastUsed();
+	});
+
+	for(auto it = reloadables.begin(); it != reloadables.end(); it++)
+		(*it)->reload(sInstance);
 }
 
 void ResourceManager::addReloadable(std::weak_ptr<IReloadable> reloadable)
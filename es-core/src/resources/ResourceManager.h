@@ -22,6 +22,9 @@ class IReloadable
 public:
 	virtual void unload(std::shared_ptr<ResourceManager>& rm) = 0;
 	virtual void reload(std::shared_ptr<ResourceManager>& rm) = 0;
+
+	// SDL ticks when it was last drawn, reloadAll() brings back what was on screen first
+	virtual unsigned int getLastUsed() const { return 0; }
 };
 
 class ResourceManager
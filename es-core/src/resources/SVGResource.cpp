@@ -2,12 +2,87 @@
 #include "nanosvg/nanosvg.h"
 #include "nanosvg/nanosvgrast.h"
 #include "Log.h"
+#include "Metrics.h"
+#include "ThreadPool.h"
 #include "Util.h"
-#include "ImageIO.h"
+#include "resources/TextureLoader.h"
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include <boost/thread/mutex.hpp>
 
 #define DPI 96
 
-SVGResource::SVGResource(const std::string& path, bool tile) : TextureResource(path, tile), mSVGImage(NULL)
+// A rasterized size of an SVG, shared by every SVGResource showing that file at that size.
+class SVGRaster : public TextureResource
+{
+public:
+	SVGRaster(const std::string& path, bool tile, size_t width, size_t height) : TextureResource(path, tile),
+		width(width), height(height), queued(false)
+	{
+	}
+
+	// there is no image file to decode, SVGResource::reload queues it for rasterization again
+	virtual void reload(std::shared_ptr<ResourceManager>& rm) override {}
+
+	virtual void unload(std::shared_ptr<ResourceManager>& rm) override
+	{
+		TextureResource::unload(rm);
+		queued = false; // the pixels are gone, they have to be rasterized again
+	}
+
+	const size_t width;
+	const size_t height;
+	std::atomic<bool> queued; // from queue() until the texture is unloaded: rasterizing, waiting for upload or uploaded
+};
+
+// creating a rasterizer allocates its edge and scanline buffers, so they are kept around and reused
+static boost::mutex rasterizersMutex;
+static std::vector<NSVGrasterizer*> rasterizers;
+
+static NSVGrasterizer* acquireRasterizer()
+{
+	{
+		boost::mutex::scoped_lock lock(rasterizersMutex);
+		if(!rasterizers.empty())
+		{
+			NSVGrasterizer* rast = rasterizers.back();
+			rasterizers.pop_back();
+			return rast;
+		}
+	}
+
+	return nsvgCreateRasterizer();
+}
+
+static void releaseRasterizer(NSVGrasterizer* rast)
+{
+	boost::mutex::scoped_lock lock(rasterizersMutex);
+	rasterizers.push_back(rast);
+}
+
+// drops the entries nobody uses anymore, whenever the map has doubled in size since the last time
+template<typename Key, typename Value>
+static void prune(std::map< Key, std::weak_ptr<Value> >& map, size_t& mark)
+{
+	if(map.size() < mark)
+		return;
+
+	for(auto it = map.begin(); it != map.end(); )
+	{
+		if(it->second.expired())
+			it = map.erase(it);
+		else
+			it++;
+	}
+
+	mark = std::max((size_t)64, map.size() * 2);
+}
+
+std::map< std::string, std::weak_ptr<NSVGimage> > SVGResource::sDocuments;
+std::map< SVGResource::RasterKey, std::weak_ptr<SVGRaster> > SVGResource::sRasters;
+
+SVGResource::SVGResource(const std::string& path, bool tile) : TextureResource(path, tile)
 {
 	mLastWidth = 0;
 	mLastHeight = 0;
@@ -15,28 +90,55 @@ SVGResource::SVGResource(const std::string& path, bool tile) : TextureResource(p
 
 SVGResource::~SVGResource()
 {
-	deinitSVG();
 }
 
 void SVGResource::unload(std::shared_ptr<ResourceManager>& rm)
 {
-	deinitSVG();
+	// the parsed document is kept, only the textures go
+	if(mRaster)
+		mRaster->unload(rm);
+	if(mPending)
+		mPending->unload(rm);
+
 	TextureResource::unload(rm);
 }
 
-void SVGResource::initFromMemory(const char* file, size_t length)
+void SVGResource::reload(std::shared_ptr<ResourceManager>& rm)
 {
-	deinit();
-	deinitSVG();
+	if(!mSVGImage && !mPath.empty())
+	{
+		auto found = sDocuments.find(mPath);
+		if(found != sDocuments.end())
+			mSVGImage = found->second.lock();
 
-	// nsvgParse excepts a modifiable, null-terminated string
-	char* copy = (char*)malloc(length + 1);
-	assert(copy != NULL);
-	memcpy(copy, file, length);
-	copy[length] = '\0';
+		if(!mSVGImage)
+		{
+			const ResourceData& data = rm->getFileData(mPath);
+			mSVGImage = parse((const char*)data.ptr.get(), data.length);
+			if(!mSVGImage)
+			{
+				LOG(LogError) << "Error parsing SVG image \"" << mPath << "\".";
+				return;
+			}
 
-	mSVGImage = nsvgParse(copy, "px", DPI);
-	free(copy);
+			static size_t mark = 64;
+			prune(sDocuments, mark);
+			sDocuments[mPath] = mSVGImage;
+		}
+	}
+
+	if(mLastWidth && mLastHeight)
+		rasterizeAt(mLastWidth, mLastHeight);
+	else if(mSVGImage)
+		rasterizeAt((size_t)round(mSVGImage->width), (size_t)round(mSVGImage->height));
+}
+
+void SVGResource::initFromMemory(const char* file, size_t length)
+{
+	// not from a file, so not shared with anybody
+	mRaster.reset();
+	mPending.reset();
+	mSVGImage = parse(file, length);
 
 	if(!mSVGImage)
 	{
@@ -50,8 +152,26 @@ void SVGResource::initFromMemory(const char* file, size_t length)
 		rasterizeAt((size_t)round(mSVGImage->width), (size_t)round(mSVGImage->height));
 }
 
+std::shared_ptr<NSVGimage> SVGResource::parse(const char* file, size_t length)
+{
+	static Metrics::Counter& parsed = Metrics::counter("svg.documents_parsed");
+
+	// nsvgParse excepts a modifiable, null-terminated string
+	std::vector<char> copy(file, file + length);
+	copy.push_back('\0');
+
+	NSVGimage* image = nsvgParse(copy.data(), "px", DPI);
+	if(!image)
+		return NULL;
+
+	parsed.add();
+	return std::shared_ptr<NSVGimage>(image, nsvgDelete);
+}
+
 void SVGResource::rasterizeAt(size_t width, size_t height)
 {
+	static Metrics::Counter& reused = Metrics::counter("svg.rasters_reused");
+
 	if(!mSVGImage || (width == 0 && height == 0))
 		return;
 
@@ -71,31 +191,113 @@ void SVGResource::rasterizeAt(size_t width, size_t height)
 		mLastHeight = height;
 	}
 
-	unsigned char* imagePx = (unsigned char*)malloc(width * height * 4);
-	assert(imagePx != NULL);
+	if(width == 0 || height == 0)
+		return;
+
+	mTextureSize << (int)width, (int)height;
 
-	NSVGrasterizer* rast = nsvgCreateRasterizer();
-	nsvgRasterize(rast, mSVGImage, 0, 0, height / mSVGImage->height, imagePx, width, height, width * 4);
-	nsvgDeleteRasterizer(rast);
+	std::shared_ptr<SVGRaster> raster;
+	if(mRaster && mRaster->width == width && mRaster->height == height)
+		raster = mRaster;
+	else if(mPending && mPending->width == width && mPending->height == height)
+		raster = mPending;
+	else{
+		// documents from memory have no path to be shared by
+		const RasterKey key(mPath, mTile, width, height);
+		auto found = mPath.empty() ? sRasters.end() : sRasters.find(key);
+		if(found != sRasters.end())
+			raster = found->second.lock();
 
-	ImageIO::flipPixelsVert(imagePx, width, height);
+		if(raster)
+		{
+			reused.add();
+		}else{
+			raster = std::make_shared<SVGRaster>(mPath, mTile, width, height);
+			sTextureList.push_back(raster);
+
+			if(!mPath.empty())
+			{
+				static size_t mark = 64;
+				prune(sRasters, mark);
+				sRasters[key] = raster;
+			}
+		}
+	}
 
-	initFromPixels(imagePx, width, height);
-	free(imagePx);
+	if(!raster->isInitialized() && !raster->restoreResident())
+		queue(raster);
+
+	if(raster == mRaster)
+		mPending.reset();
+	else
+		mPending = raster;
 }
 
-Eigen::Vector2f SVGResource::getSourceImageSize() const
+void SVGResource::queue(const std::shared_ptr<SVGRaster>& raster)
 {
-	if(mSVGImage)
-		return Eigen::Vector2f(mSVGImage->width, mSVGImage->height);
+	if(raster->queued.exchange(true))
+		return;
 
-	return Eigen::Vector2f::Zero();
+	// the job doesn't keep the raster alive: if every handle moved on to another size, it is skipped
+	const std::weak_ptr<SVGRaster> weak = raster;
+	const std::shared_ptr<NSVGimage> image = mSVGImage;
+	const size_t width = raster->width;
+	const size_t height = raster->height;
+
+	ThreadPool::getInstance()->post([weak, image, width, height]
+	{
+		static Metrics::Counter& rasterized = Metrics::counter("svg.rasterized");
+
+		if(weak.expired())
+			return;
+
+		std::vector<unsigned char> pixels(width * height * 4);
+
+		// written bottom row first, the way OpenGL expects them, so they don't have to be flipped afterwards
+		NSVGrasterizer* rast = acquireRasterizer();
+		nsvgRasterize(rast, image.get(), 0, 0, height / image->height, pixels.data() + (height - 1) * width * 4, (int)width, (int)height, -(int)(width * 4));
+		releaseRasterizer(rast);
+
+		rasterized.add();
+		TextureLoader::getInstance()->upload(weak, std::move(pixels), width, height);
+	});
+}
+
+void SVGResource::promote() const
+{
+	if(mPending && mPending->isInitialized())
+	{
+		mRaster = mPending;
+		mPending.reset();
+	}
+}
+
+bool SVGResource::isInitialized() const
+{
+	promote();
+	return mRaster && mRaster->isInitialized();
 }
 
-void SVGResource::deinitSVG()
+bool SVGResource::isLoading() const
+{
+	return (mPending && !mPending->isInitialized()) || (mRaster && !mRaster->isInitialized());
+}
+
+void SVGResource::bind() const
+{
+	promote();
+	if(mRaster && mRaster->isInitialized())
+	{
+		mRaster->bind();
+		mLastUsed = mRaster->getLastUsed();
+	}else
+		LOG(LogError) << "Tried to bind uninitialized texture!";
+}
+
+Eigen::Vector2f SVGResource::getSourceImageSize() const
 {
 	if(mSVGImage)
-		nsvgDelete(mSVGImage);
+		return Eigen::Vector2f(mSVGImage->width, mSVGImage->height);
 
-	mSVGImage = NULL;
+	return Eigen::Vector2f::Zero();
 }
@@ -2,26 +2,52 @@
 
 #include "resources/TextureResource.h"
 
+#include <map>
+#include <tuple>
+
 struct NSVGimage;
+class SVGRaster;
 
+// Every SVGResource is a handle of its own, but the parsed document is shared by all the handles for
+// the same file and rasterized textures are shared by all the handles wanting the same pixel size.
+// Rasterization happens on the ThreadPool: until the new size is uploaded the previous one is drawn
+// stretched, or nothing at all (isLoading()) if there is none yet.
 class SVGResource : public TextureResource
 {
 public:
 	virtual ~SVGResource();
 
 	virtual void unload(std::shared_ptr<ResourceManager>& rm) override;
-	
+	virtual void reload(std::shared_ptr<ResourceManager>& rm) override;
+
 	virtual void initFromMemory(const char* image, size_t length) override;
 
+	virtual bool isInitialized() const override;
+	virtual bool isLoading() const override;
+	virtual void bind() const override;
+
 	void rasterizeAt(size_t width, size_t height);
 	Eigen::Vector2f getSourceImageSize() const;
 
 protected:
 	friend TextureResource;
 	SVGResource(const std::string& path, bool tile);
-	void deinitSVG();
 
-	NSVGimage* mSVGImage;
+	std::shared_ptr<NSVGimage> mSVGImage;
 	size_t mLastWidth;
 	size_t mLastHeight;
+
+private:
+	static std::shared_ptr<NSVGimage> parse(const char* file, size_t length);
+	void queue(const std::shared_ptr<SVGRaster>& raster);
+
+	// the pending raster replaces the drawn one once it is uploaded
+	void promote() const;
+
+	mutable std::shared_ptr<SVGRaster> mRaster;
+	mutable std::shared_ptr<SVGRaster> mPending;
+
+	typedef std::tuple<std::string, bool, size_t, size_t> RasterKey; // path, tile, width, height
+	static std::map< std::string, std::weak_ptr<NSVGimage> > sDocuments;
+	static std::map< RasterKey, std::weak_ptr<SVGRaster> > sRasters;
 };
@@ -0,0 +1,124 @@
+#include "resources/TextureLoader.h"
+#include "resources/TextureResource.h"
+#include "resources/ResidentCache.h"
+#include "resources/ResourceManager.h"
+#include "ImageIO.h"
+#include "Log.h"
+
+TextureLoader* TextureLoader::sInstance = NULL;
+
+TextureLoader* TextureLoader::getInstance()
+{
+	if(sInstance == NULL)
+		sInstance = new TextureLoader();
+
+	return sInstance;
+}
+
+TextureLoader::TextureLoader() : mRunning(true)
+{
+	mThread = boost::thread(&TextureLoader::run, this);
+}
+
+void TextureLoader::stop()
+{
+	{
+		boost::mutex::scoped_lock lock(mMutex);
+		mRunning = false;
+		mQueue.clear();
+	}
+	mCondition.notify_one();
+	mThread.join();
+}
+
+void TextureLoader::load(const std::shared_ptr<TextureResource>& texture, const std::string& path)
+{
+	Job job;
+	job.texture = texture;
+	job.key = texture.get();
+	job.path = path;
+	job.width = 0;
+	job.height = 0;
+
+	{
+		boost::mutex::scoped_lock lock(mMutex);
+		mQueue.push_back(std::move(job));
+	}
+	mCondition.notify_one();
+}
+
+void TextureLoader::upload(const std::weak_ptr<TextureResource>& texture, std::vector<unsigned char>&& pixels, size_t width, size_t height)
+{
+	Job job;
+	job.texture = texture;
+	job.key = NULL;
+	job.pixels = std::move(pixels);
+	job.width = width;
+	job.height = height;
+
+	boost::mutex::scoped_lock lock(mMutex);
+	mDone.push_back(std::move(job));
+}
+
+void TextureLoader::run()
+{
+	while(true)
+	{
+		Job job;
+		{
+			boost::mutex::scoped_lock lock(mMutex);
+			while(mRunning && mQueue.empty())
+				mCondition.wait(lock);
+
+			if(!mRunning)
+				return;
+
+			job = std::move(mQueue.front());
+			mQueue.pop_front();
+		}
+
+		// nobody wants it anymore (e.g. scrolled off screen)
+		if(job.texture.expired())
+			continue;
+
+		// kept from before a game was launched, no need to decode it again
+		if(!ResidentCache::getInstance()->restore(ResidentCache::Key(job.key, 0), job.pixels, job.width, job.height))
+		{
+			// goes through with no pixels, update() marks the texture failed
+			const ResourceData data = ResourceManager::getInstance()->getFileData(job.path);
+			if(data.length > 0)
+				job.pixels = ImageIO::loadFromMemoryRGBA32(data.ptr.get(), data.length, job.width, job.height);
+			if(job.pixels.empty())
+				LOG(LogError) << "Could not decode texture \"" << job.path << "\"";
+		}
+
+		boost::mutex::scoped_lock lock(mMutex);
+		mDone.push_back(std::move(job));
+	}
+}
+
+void TextureLoader::update()
+{
+	for(int i = 0; i < MAX_UPLOADS_PER_FRAME; i++)
+	{
+		Job job;
+		{
+			boost::mutex::scoped_lock lock(mMutex);
+			if(mDone.empty())
+				return;
+
+			job = std::move(mDone.front());
+			mDone.pop_front();
+		}
+
+		std::shared_ptr<TextureResource> texture = job.texture.lock();
+		if(texture && !texture->isInitialized() && !job.pixels.empty())
+		{
+			texture->initFromPixels(job.pixels.data(), job.width, job.height);
+		}else{
+			if(texture && !texture->isInitialized())
+				texture->setFailed();
+			i--; // nothing uploaded, doesn't count against the budget
+		}
+	}
+}
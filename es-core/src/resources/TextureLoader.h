@@ -0,0 +1,54 @@
+#pragma once
+
+#include <memory>
+#include <deque>
+#include <string>
+#include <vector>
+#include <boost/thread.hpp>
+
+class TextureResource;
+
+// Decodes image files into RGBA pixels on a background thread.
+// The OpenGL upload has to happen on the main thread, in update().
+// Requests only hold weak references: textures released before they are decoded are skipped.
+// Textures that can't be read or decoded are marked failed (see TextureResource::isFailed()).
+class TextureLoader
+{
+public:
+	static TextureLoader* getInstance();
+
+	void load(const std::shared_ptr<TextureResource>& texture, const std::string& path);
+
+	// queues pixels decoded somewhere else (e.g. rasterized SVGs) for upload, any thread
+	void upload(const std::weak_ptr<TextureResource>& texture, std::vector<unsigned char>&& pixels, size_t width, size_t height);
+
+	// uploads up to MAX_UPLOADS_PER_FRAME decoded textures, called once per frame
+	void update();
+
+	void stop();
+
+private:
+	TextureLoader();
+	void run();
+
+	struct Job
+	{
+		std::weak_ptr<TextureResource> texture;
+		const void* key; // the texture in the ResidentCache, without keeping it alive
+		std::string path;
+		std::vector<unsigned char> pixels; // empty once done: the decoding failed
+		size_t width;
+		size_t height;
+	};
+
+	static const int MAX_UPLOADS_PER_FRAME = 4;
+
+	static TextureLoader* sInstance;
+
+	std::deque<Job> mQueue;
+	std::deque<Job> mDone;
+	boost::mutex mMutex;
+	boost::condition_variable mCondition;
+	boost::thread mThread;
+	bool mRunning;
+};
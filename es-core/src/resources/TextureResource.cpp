@@ -5,19 +5,23 @@
 #include "ImageIO.h"
 #include "Renderer.h"
 #include "Util.h"
+#include "resources/ResidentCache.h"
 #include "resources/SVGResource.h"
+#include "resources/TextureLoader.h"
+#include <SDL_timer.h>
 
 std::map< TextureResource::TextureKeyType, std::weak_ptr<TextureResource> > TextureResource::sTextureMap;
 std::list< std::weak_ptr<TextureResource> > TextureResource::sTextureList;
 
 TextureResource::TextureResource(const std::string& path, bool tile) : 
-	mTextureID(0), mPath(path), mTextureSize(Eigen::Vector2i::Zero()), mTile(tile)
+	mTextureID(0), mPath(path), mTextureSize(Eigen::Vector2i::Zero()), mTile(tile), mLastUsed(0), mRestoring(false), mFailed(false)
 {
 }
 
 TextureResource::~TextureResource()
 {
 	deinit();
+	ResidentCache::getInstance()->removeAll(this);
 }
 
 void TextureResource::unload(std::shared_ptr<ResourceManager>& rm)
@@ -27,7 +31,7 @@ void TextureResource::unload(std::shared_ptr<ResourceManager>& rm)
 
 void TextureResource::reload(std::shared_ptr<ResourceManager>& rm)
 {
-	if(!mPath.empty())
+	if(!mPath.empty() && !restoreResident())
 	{
 		const ResourceData& data = rm->getFileData(mPath);
 		initFromMemory((const char*)data.ptr.get(), data.length);
@@ -54,6 +58,30 @@ void TextureResource::initFromPixels(const unsigned char* dataRGBA, size_t width
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapMode);
 
 	mTextureSize << width, height;
+	mRestoring = false;
+	mFailed = false;
+
+	// without a path it can't be reloaded anyway, and the pixels may be replaced at the same size
+	if(!mPath.empty() && ResidentCache::isEnabled() && !ResidentCache::getInstance()->contains(ResidentCache::Key(this, 0)))
+		ResidentCache::getInstance()->store(ResidentCache::Key(this, 0), dataRGBA, width, height, 4);
+}
+
+bool TextureResource::restoreResident()
+{
+	if(isLoading())
+		return true;
+
+	if(!ResidentCache::getInstance()->contains(ResidentCache::Key(this, 0)))
+		return false;
+
+	mRestoring = true;
+	TextureLoader::getInstance()->load(shared_from_this(), mPath);
+	return true;
+}
+
+unsigned int TextureResource::getLastUsed() const
+{
+	return mLastUsed;
 }
 
 void TextureResource::initFromMemory(const char* data, size_t length)
@@ -64,6 +92,7 @@ void TextureResource::initFromMemory(const char* data, size_t length)
 	if(imageRGBA.size() == 0)
 	{
 		LOG(LogError) << "Could not initialize texture from memory, invalid data!  (file path: " << mPath << ", data ptr: " << (size_t)data << ", reported size: " << length << ")";
+		mFailed = true;
 		return;
 	}
 
@@ -91,6 +120,8 @@ bool TextureResource::isTiled() const
 
 void TextureResource::bind() const
 {
+	mLastUsed = SDL_GetTicks();
+
 	if(mTextureID != 0)
 		glBindTexture(GL_TEXTURE_2D, mTextureID);
 	else
@@ -98,7 +129,7 @@ void TextureResource::bind() const
 }
 
 
-std::shared_ptr<TextureResource> TextureResource::get(const std::string& path, bool tile)
+std::shared_ptr<TextureResource> TextureResource::get(const std::string& path, bool tile, bool async)
 {
 	std::shared_ptr<ResourceManager>& rm = ResourceManager::getInstance();
 
@@ -116,7 +147,12 @@ std::shared_ptr<TextureResource> TextureResource::get(const std::string& path, b
 	if(foundTexture != sTextureMap.end())
 	{
         if(!foundTexture->second.expired()) {
-			return foundTexture->second.lock();
+			std::shared_ptr<TextureResource> tex = foundTexture->second.lock();
+			// still waiting on the TextureLoader, but the caller can't wait
+			// (unless it's coming back from the ResidentCache, that's quick and callers check isLoading())
+			if(!async && !tex->isInitialized() && !tex->isLoading() && !tex->isFailed())
+				tex->reload(rm);
+			return tex;
         }
 	}
 
@@ -127,9 +163,9 @@ std::shared_ptr<TextureResource> TextureResource::get(const std::string& path, b
 	if(key.first.substr(key.first.size() - 4, std::string::npos) == ".svg")
 	{
 		// probably
-		// don't add it to our map because 2 svgs might be rasterized at different sizes
+		// not in our map because 2 svgs might be rasterized at different sizes, SVGResource shares what it can itself
+		// not in our list either, its rasters are
 		tex = std::shared_ptr<SVGResource>(new SVGResource(key.first, tile));
-		sTextureList.push_back(tex); // add it to our list though
 		rm->addReloadable(tex);
 		tex->reload(rm);
 		return tex;
@@ -139,7 +175,10 @@ std::shared_ptr<TextureResource> TextureResource::get(const std::string& path, b
 		sTextureMap[key] = std::weak_ptr<TextureResource>(tex);
 		sTextureList.push_back(tex);
 		rm->addReloadable(tex);
-		tex->reload(ResourceManager::getInstance());
+		if(async)
+			TextureLoader::getInstance()->load(tex, key.first);
+		else
+			tex->reload(ResourceManager::getInstance());
 		return tex;
 	}
 }
@@ -149,6 +188,22 @@ bool TextureResource::isInitialized() const
 	return mTextureID != 0;
 }
 
+bool TextureResource::isLoading() const
+{
+	return mRestoring && mTextureID == 0;
+}
+
+bool TextureResource::isFailed() const
+{
+	return mFailed && mTextureID == 0;
+}
+
+void TextureResource::setFailed()
+{
+	mRestoring = false;
+	mFailed = true;
+}
+
 size_t TextureResource::getMemUsage() const
 {
 	if(!mTextureID || mTextureSize.x() == 0 || mTextureSize.y() == 0)
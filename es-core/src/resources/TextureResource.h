@@ -8,21 +8,32 @@
 #include "platform_gl.h"
 
 // An OpenGL texture.
-// Automatically recreates the texture with renderer deinit/reinit.
-class TextureResource : public IReloadable
+// Automatically recreates the texture with renderer deinit/reinit, from the ResidentCache if it kept the pixels.
+class TextureResource : public IReloadable, public std::enable_shared_from_this<TextureResource>
 {
 public:
-	static std::shared_ptr<TextureResource> get(const std::string& path, bool tile = false);
+	// If async is true, the image is decoded by the TextureLoader and the texture stays uninitialized
+	// (zero size) until it is uploaded, a few frames later. SVGs are always rasterized in the background.
+	static std::shared_ptr<TextureResource> get(const std::string& path, bool tile = false, bool async = false);
 
 	virtual ~TextureResource();
 
 	virtual void unload(std::shared_ptr<ResourceManager>& rm) override;
 	virtual void reload(std::shared_ptr<ResourceManager>& rm) override;
-	
-	bool isInitialized() const;
+	virtual unsigned int getLastUsed() const override;
+
+	// queues the pixels kept by the ResidentCache for upload by the TextureLoader, false if it has none
+	bool restoreResident();
+
+	virtual bool isInitialized() const;
+	// true while the pixels are still being prepared in the background, see SVGResource and restoreResident()
+	virtual bool isLoading() const;
+	// true once the image could not be decoded, the texture will never initialize: show a fallback instead
+	bool isFailed() const;
+	void setFailed();
 	bool isTiled() const;
 	const Eigen::Vector2i& getSize() const;
-	void bind() const;
+	virtual void bind() const;
 	
 	// Warning: will NOT correctly reinitialize when this texture is reloaded (e.g. ES starts/stops playing a game).
 	virtual void initFromMemory(const char* file, size_t length);
@@ -40,9 +51,14 @@ protected:
 	Eigen::Vector2i mTextureSize;
 	const std::string mPath;
 	const bool mTile;
+	mutable unsigned int mLastUsed;
 
 private:
+	friend class SVGResource; // tracks its rasters in sTextureList
+
 	GLuint mTextureID;
+	bool mRestoring;
+	bool mFailed;
 
 	typedef std::pair<std::string, bool> TextureKeyType;
 	static std::map< TextureKeyType, std::weak_ptr<TextureResource> > sTextureMap; // map of textures, used to prevent duplicate textures
@@ -0,0 +1,274 @@
+// Loopback harness for HttpReq and the HttpThread. A small HTTP/1.1 server runs on 127.0.0.1 in
+// this process and the requests go through the real network thread and HttpCache:
+// a 200 read into the preallocated buffer, a download saved to a file, a 304 revalidation
+// served from the cache, a refused connection, and a download cancelled mid-transfer.
+// HOME is pointed at a temporary directory, so the settings and the cache start out empty.
+// Exits with 0 when every check passed.
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+
+#include "HttpReq.h"
+#include "HttpThread.h"
+#include "Settings.h"
+
+#define BODY_SIZE 300001 // not a power of two, so a vector that grew by doubling can't end up exactly this big
+#define SLOW_SIZE (8 * 1024 * 1024)
+#define SLOW_CHUNK (64 * 1024)
+#define ETAG "\"v1\""
+
+static int sFailures = 0;
+
+static void check(bool ok, const std::string& what)
+{
+	printf("%s %s\n", ok ? "ok  " : "FAIL", what.c_str());
+	if(!ok)
+		sFailures++;
+}
+
+static std::string makeBody(size_t size, char seed)
+{
+	std::string body(size, ' ');
+	for(size_t i = 0; i < size; i++)
+		body[i] = (char)(seed + i % 61);
+	return body;
+}
+
+// One connection at a time, every response closes its connection.
+//   /body    200 with a Content-Length, and an ETag
+//   /cached  200 with an ETag, or 304 when asked If-None-Match with that ETag
+//   /slow    200 announcing SLOW_SIZE bytes, sent a chunk every 50 ms
+class LoopbackServer
+{
+public:
+	LoopbackServer() : mNotModified(0), mSlowAborted(false), mStopping(false)
+	{
+		mFd = socket(AF_INET, SOCK_STREAM, 0);
+		int reuse = 1;
+		setsockopt(mFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+		sockaddr_in addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		addr.sin_port = 0;
+		bind(mFd, (sockaddr*)&addr, sizeof(addr));
+		listen(mFd, 8);
+
+		socklen_t length = sizeof(addr);
+		getsockname(mFd, (sockaddr*)&addr, &length);
+		mPort = ntohs(addr.sin_port);
+
+		mThread = boost::thread(&LoopbackServer::run, this);
+	}
+
+	~LoopbackServer()
+	{
+		mStopping = true;
+		shutdown(mFd, SHUT_RDWR);
+		close(mFd);
+		mThread.join();
+	}
+
+	std::string url(const std::string& path) const
+	{
+		return "http://127.0.0.1:" + std::to_string(mPort) + path;
+	}
+
+	std::atomic<int> mNotModified;
+	std::atomic<bool> mSlowAborted; // the client went away before the slow body was complete
+
+private:
+	int mFd;
+	int mPort;
+	std::atomic<bool> mStopping;
+	boost::thread mThread;
+
+	static bool sendAll(int fd, const std::string& data)
+	{
+		size_t sent = 0;
+		while(sent < data.size())
+		{
+			ssize_t count = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+			if(count <= 0)
+				return false;
+			sent += count;
+		}
+		return true;
+	}
+
+	static std::string header(const std::string& status, size_t length)
+	{
+		return "HTTP/1.1 " + status + "\r\nContent-Length: " + std::to_string(length) + "\r\nETag: " ETAG "\r\nConnection: close\r\n\r\n";
+	}
+
+	void run()
+	{
+		while(!mStopping)
+		{
+			int client = accept(mFd, NULL, NULL);
+			if(client < 0)
+				continue;
+
+			std::string request;
+			char buffer[4096];
+			while(request.find("\r\n\r\n") == std::string::npos)
+			{
+				ssize_t count = recv(client, buffer, sizeof(buffer), 0);
+				if(count <= 0)
+					break;
+				request.append(buffer, count);
+			}
+			respond(client, request);
+			close(client);
+		}
+	}
+
+	void respond(int client, const std::string& request)
+	{
+		if(request.compare(0, 10, "GET /body ") == 0)
+		{
+			sendAll(client, header("200 OK", BODY_SIZE) + makeBody(BODY_SIZE, 'a'));
+		}else if(request.compare(0, 12, "GET /cached ") == 0)
+		{
+			if(request.find("If-None-Match: " ETAG) != std::string::npos)
+			{
+				mNotModified++;
+				sendAll(client, header("304 Not Modified", 0));
+			}else{
+				sendAll(client, header("200 OK", 1000) + makeBody(1000, 'c'));
+			}
+		}else if(request.compare(0, 10, "GET /slow ") == 0)
+		{
+			const std::string chunk = makeBody(SLOW_CHUNK, 's');
+			bool ok = sendAll(client, header("200 OK", SLOW_SIZE));
+			for(size_t sent = 0; ok && sent < SLOW_SIZE && !mStopping; sent += SLOW_CHUNK)
+			{
+				ok = sendAll(client, chunk);
+				boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+			}
+			mSlowAborted = !ok;
+		}else{
+			sendAll(client, "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+		}
+	}
+};
+
+// the UI polls status() once a frame, this does the same until the request is over or timeoutMs passed
+static HttpReq::Status waitFor(HttpReq& request, int timeoutMs)
+{
+	for(int elapsed = 0; elapsed < timeoutMs && request.status() == HttpReq::REQ_IN_PROGRESS; elapsed += 10)
+		boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+	return request.status();
+}
+
+static bool waitFor(std::function<bool()> pred, int timeoutMs)
+{
+	for(int elapsed = 0; elapsed < timeoutMs; elapsed += 10)
+	{
+		if(pred())
+			return true;
+		boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+	}
+	return pred();
+}
+
+static std::string readFile(const std::string& path)
+{
+	std::ifstream file(path.c_str(), std::ios::binary);
+	return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+int main(int argc, char* argv[])
+{
+	char home[] = "/tmp/es-http-loopback-XXXXXX";
+	if(mkdtemp(home) == NULL)
+	{
+		perror("mkdtemp");
+		return 1;
+	}
+	setenv("HOME", home, 1);
+	boost::filesystem::create_directories(std::string(home) + "/.emulationstation");
+
+	// revalidate on every request, before the network thread reads the settings
+	Settings::getInstance()->setBool("HttpCache", true);
+	Settings::getInstance()->setInt("HttpCacheMaxAge", 0);
+
+	{
+		LoopbackServer server;
+
+		{
+			HttpReq request(server.url("/body"));
+			check(waitFor(request, 5000) == HttpReq::REQ_SUCCESS, "200 succeeds");
+			std::vector<char> content = request.takeContent();
+			check(std::string(content.begin(), content.end()) == makeBody(BODY_SIZE, 'a'), "200 body is complete");
+			check(content.capacity() == BODY_SIZE, "200 body was allocated once, from Content-Length");
+		}
+
+		{
+			const std::string path = std::string(home) + "/saved.bin";
+			HttpReq request(server.url("/body"), path);
+			check(waitFor(request, 5000) == HttpReq::REQ_SUCCESS, "save to file succeeds");
+			check(request.getContent().empty(), "save to file keeps nothing in memory");
+			check(readFile(path) == makeBody(BODY_SIZE, 'a'), "saved file holds the body");
+		}
+
+		{
+			HttpReq first(server.url("/cached"));
+			check(waitFor(first, 5000) == HttpReq::REQ_SUCCESS, "first request of a cacheable url succeeds");
+
+			HttpReq second(server.url("/cached"));
+			check(waitFor(second, 5000) == HttpReq::REQ_SUCCESS, "revalidated request succeeds");
+			check(server.mNotModified == 1, "second request is answered 304");
+			check(second.getContent() == makeBody(1000, 'c'), "304 is served the cached body");
+		}
+
+		{
+			// a port nobody listens on
+			int fd = socket(AF_INET, SOCK_STREAM, 0);
+			sockaddr_in addr;
+			memset(&addr, 0, sizeof(addr));
+			addr.sin_family = AF_INET;
+			addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			bind(fd, (sockaddr*)&addr, sizeof(addr));
+			socklen_t length = sizeof(addr);
+			getsockname(fd, (sockaddr*)&addr, &length);
+			close(fd);
+
+			HttpReq request("http://127.0.0.1:" + std::to_string(ntohs(addr.sin_port)) + "/refused");
+			check(waitFor(request, 5000) == HttpReq::REQ_IO_ERROR, "refused connection is an IO error");
+			check(!request.getErrorMsg().empty(), "refused connection has an error message");
+		}
+
+		{
+			const std::string path = std::string(home) + "/cancelled.bin";
+			{
+				HttpReq request(server.url("/slow"), path);
+				check(waitFor([&path]() { return boost::filesystem::exists(path) && boost::filesystem::file_size(path) > 0; }, 5000),
+					"slow download has started");
+				check(request.status() == HttpReq::REQ_IN_PROGRESS, "slow download is still running");
+			}
+			check(waitFor([&server]() { return server.mSlowAborted.load(); }, 5000), "cancel closes the connection");
+			check(waitFor([&path]() { return !boost::filesystem::exists(path); }, 5000), "cancel removes the partial file");
+		}
+
+		HttpThread::shutdown();
+	}
+
+	boost::filesystem::remove_all(home);
+
+	printf("%s\n", sFailures == 0 ? "all checks passed" : "some checks failed");
+	return sFailures == 0 ? 0 : 1;
+}
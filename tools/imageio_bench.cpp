@@ -0,0 +1,121 @@
+// ImageIO::swizzleRows32 kernels (BGRA <-> RGBA, see ImageIO.cpp): scalar, SSE2, AVX2 and NEON,
+// each with and without the vertical flip, at 256x256, 1920x1080 and 3840x2160. Source rows are
+// padded like FreeImage's pitch, and an odd width runs the scalar tail of every kernel.
+// Every kernel's output is compared to the scalar one, kernels the build or CPU lacks are skipped.
+//   imageio_bench [megapixels per measurement]    default: 64
+// Exits with 0 when every kernel matched the scalar output, timings are only reported.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "ImageIO.h"
+
+#define PITCH_PADDING 12
+
+static int sFailures = 0;
+
+static void check(bool ok, const std::string& what)
+{
+	printf("%s %s\n", ok ? "ok  " : "FAIL", what.c_str());
+	if(!ok)
+		sFailures++;
+}
+
+struct Kernel
+{
+	ImageIO::SwizzleKernel kernel;
+	const char* name;
+};
+
+static const Kernel sKernels[] = {
+	{ ImageIO::SWIZZLE_SCALAR, "scalar" },
+	{ ImageIO::SWIZZLE_SSE2, "sse2" },
+	{ ImageIO::SWIZZLE_AVX2, "avx2" },
+	{ ImageIO::SWIZZLE_NEON, "neon" },
+	{ ImageIO::SWIZZLE_AUTO, "auto" },
+};
+
+struct Size
+{
+	size_t width;
+	size_t height;
+	bool timed;
+};
+
+static const Size sSizes[] = {
+	{ 256, 256, true },
+	{ 1920, 1080, true },
+	{ 3840, 2160, true },
+	{ 1283, 7, false }, // not a multiple of any kernel's width
+};
+
+int main(int argc, char* argv[])
+{
+	const double megapixels = argc > 1 ? atof(argv[1]) : 64;
+
+	for(size_t s = 0; s < sizeof(sSizes) / sizeof(sSizes[0]); s++)
+	{
+		const Size& size = sSizes[s];
+		const size_t srcPitch = size.width * 4 + PITCH_PADDING;
+		const size_t dstPitch = size.width * 4;
+
+		std::vector<unsigned char> src(srcPitch * size.height);
+		unsigned int seed = 12345;
+		for(size_t i = 0; i < src.size(); i++)
+		{
+			seed = seed * 1103515245 + 12345;
+			src[i] = (unsigned char)(seed >> 16);
+		}
+
+		const int repeats = (int)(megapixels * 1000000 / (size.width * size.height)) + 1;
+		if(size.timed)
+			printf("%zux%zu, best of %d\n", size.width, size.height, repeats);
+
+		for(int flip = 0; flip < 2; flip++)
+		{
+			std::vector<unsigned char> expected(dstPitch * size.height);
+			ImageIO::swizzleRows32Using(ImageIO::SWIZZLE_SCALAR, src.data(), srcPitch, expected.data(), dstPitch, size.width, size.height, flip != 0);
+
+			double scalarNs = 0;
+			for(size_t k = 0; k < sizeof(sKernels) / sizeof(sKernels[0]); k++)
+			{
+				const Kernel& kernel = sKernels[k];
+				std::vector<unsigned char> dst(dstPitch * size.height);
+
+				char what[128];
+				snprintf(what, sizeof(what), "%-6s %s %zux%zu", kernel.name, flip ? "flip  " : "noflip", size.width, size.height);
+
+				if(!ImageIO::swizzleRows32Using(kernel.kernel, src.data(), srcPitch, dst.data(), dstPitch, size.width, size.height, flip != 0))
+				{
+					printf("skip %s, not available\n", what);
+					continue;
+				}
+				check(memcmp(dst.data(), expected.data(), dst.size()) == 0, std::string(what) + " matches scalar");
+
+				if(!size.timed)
+					continue;
+
+				double bestNs = 0;
+				for(int r = 0; r < repeats; r++)
+				{
+					const auto start = std::chrono::steady_clock::now();
+					ImageIO::swizzleRows32Using(kernel.kernel, src.data(), srcPitch, dst.data(), dstPitch, size.width, size.height, flip != 0);
+					const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+					if(r == 0 || ns < bestNs)
+						bestNs = ns;
+				}
+				if(kernel.kernel == ImageIO::SWIZZLE_SCALAR)
+					scalarNs = bestNs;
+
+				printf("     %-6s %s %9.1f us  %6.2f GB/s  %5.2fx scalar\n", kernel.name, flip ? "flip  " : "noflip",
+					bestNs / 1000, dst.size() / bestNs, scalarNs / bestNs);
+			}
+		}
+	}
+
+	return sFailures == 0 ? 0 : 1;
+}
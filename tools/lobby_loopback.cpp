@@ -0,0 +1,202 @@
+// Loopback harness for the lobby protocol (see Lobby.cpp for the packet format).
+// Two LobbyThread instances run in this process, next to 100 simulated peers that announce
+// through a plain socket: a burst of starts, a replay, garbage, stops, and TTL expiry.
+// Needs a multicast route, e.g. on a machine without network:
+//   ip route add 224.0.0.0/4 dev lo
+// Exits with 0 when every check passed.
+
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <set>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <boost/thread.hpp>
+
+#include "Lobby.h"
+#include "Metrics.h"
+
+#define PEERS 100
+#define PEER_TTL 3
+#define GARBAGE 10
+
+static int sFailures = 0;
+
+static void check(bool ok, const std::string& what)
+{
+	printf("%s %s\n", ok ? "ok  " : "FAIL", what.c_str());
+	if(!ok)
+		sFailures++;
+}
+
+static std::string hashOf(int peer, int game)
+{
+	char hash[33];
+	snprintf(hash, sizeof(hash), "%08x%08x%016x", peer, game, 0x5eed);
+	return hash;
+}
+
+struct Counts
+{
+	int started;
+	int stopped;
+};
+
+static void subscribe(LobbyThread& lobby, Counts& counts)
+{
+	counts.started = counts.stopped = 0;
+	lobby.subscribeStartedPlaying([&counts](const std::shared_ptr<const Session>&) { counts.started++; });
+	lobby.subscribeStoppedPlaying([&counts](const std::shared_ptr<const Session>&) { counts.stopped++; });
+}
+
+// runs the UI side of both lobbies until pred holds or timeoutMs is over
+static bool waitFor(LobbyThread& a, LobbyThread& b, std::function<bool()> pred, int timeoutMs)
+{
+	for(int elapsed = 0; elapsed < timeoutMs; elapsed += 10)
+	{
+		a.processEvents();
+		b.processEvents();
+		if(pred())
+			return true;
+		boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+	}
+	return pred();
+}
+
+static size_t sessionCount(LobbyThread& lobby)
+{
+	return lobby.getSessions()->size();
+}
+
+static bool hasGame(LobbyThread& lobby, const std::string& hash)
+{
+	std::shared_ptr<const SessionList> sessions = lobby.getSessions();
+	for(auto it = sessions->begin(); it != sessions->end(); it++)
+	{
+		if(!(*it)->gameHashes.empty() && (*it)->gameHashes.front() == hash)
+			return true;
+	}
+	return false;
+}
+
+// same layout as LobbyThread::sendAnnouncement
+static std::vector<unsigned char> announcement(uint64_t hostId, uint32_t sequence, uint8_t ttl, const std::vector<std::string>& hashes)
+{
+	std::vector<unsigned char> packet(24 + hashes.size() * 16, 0);
+	memcpy(packet.data(), "ESLB", 4);
+	packet[4] = 1;
+	packet[5] = ttl;
+	uint16_t count = htons((uint16_t)hashes.size());
+	memcpy(packet.data() + 6, &count, 2);
+	memcpy(packet.data() + 8, &hostId, 8);
+	uint32_t seq = htonl(sequence);
+	memcpy(packet.data() + 16, &seq, 4);
+	for(unsigned int h = 0; h < hashes.size(); h++)
+	{
+		for(int i = 0; i < 16; i++)
+			packet[24 + h * 16 + i] = (unsigned char)strtoul(hashes[h].substr(i * 2, 2).c_str(), NULL, 16);
+	}
+	return packet;
+}
+
+static int sSocket = -1;
+
+static void send(const std::vector<unsigned char>& packet)
+{
+	struct sockaddr_in dst;
+	memset(&dst, 0, sizeof(dst));
+	dst.sin_family = AF_INET;
+	dst.sin_port = htons(5601);
+	dst.sin_addr.s_addr = inet_addr("239.255.56.1");
+	if(sendto(sSocket, packet.data(), packet.size(), 0, (struct sockaddr*)&dst, sizeof(dst)) < 0)
+		perror("sendto");
+}
+
+static void sendPeers(uint32_t sequence, uint8_t ttl, int first, int last)
+{
+	for(int peer = first; peer < last; peer++)
+	{
+		std::vector<std::string> hashes;
+		for(int game = 0; game <= peer % 3; game++)
+			hashes.push_back(hashOf(peer, game));
+		send(announcement(0xabcd000000000000ULL + peer, sequence, ttl, hashes));
+	}
+}
+
+static unsigned long long counter(const char* name)
+{
+	return Metrics::counter(name).get();
+}
+
+int main(int argc, char* argv[])
+{
+	sSocket = socket(AF_INET, SOCK_DGRAM, 0);
+	unsigned char ttl = 1;
+	setsockopt(sSocket, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+
+	LobbyThread* a = new LobbyThread();
+	LobbyThread* b = new LobbyThread();
+	Counts countsA, countsB;
+	subscribe(*a, countsA);
+	subscribe(*b, countsB);
+
+	// two instances on one machine see each other
+	const std::string gameA = hashOf(1000, 0);
+	a->startBroadcast(gameA);
+	check(waitFor(*a, *b, [&] { return hasGame(*b, gameA); }, 3000), "second instance sees the first one");
+	check(sessionCount(*a) == 0, "an instance ignores its own announcements");
+
+	// a burst of 100 peers
+	sendPeers(1, PEER_TTL, 0, PEERS);
+	check(waitFor(*a, *b, [&] { return sessionCount(*b) == PEERS + 1; }, 3000), "100 peers seen at once");
+	check(sessionCount(*a) == PEERS, "100 peers seen by the other instance");
+
+	// a replay changes nothing
+	const unsigned long long stale = counter("lobby.packets_stale");
+	sendPeers(1, PEER_TTL, 0, PEERS);
+	check(waitFor(*a, *b, [&] { return counter("lobby.packets_stale") >= stale + PEERS * 2; }, 3000), "replayed announcements are stale");
+	check(countsB.started == PEERS + 1, "no session restarted by the replay");
+
+	// garbage is counted and dropped
+	const unsigned long long invalid = counter("lobby.packets_invalid");
+	for(int i = 0; i < GARBAGE; i++)
+	{
+		std::vector<unsigned char> packet = announcement(0xdead000000000000ULL + i, 1, PEER_TTL, std::vector<std::string>(1, hashOf(i, 0)));
+		if(i % 3 == 0)
+			packet[0] = 'X'; // bad magic
+		else if(i % 3 == 1)
+			packet.resize(20); // truncated header
+		else
+			packet.resize(30); // hash count does not match the length
+		send(packet);
+	}
+	check(waitFor(*a, *b, [&] { return counter("lobby.packets_invalid") >= invalid + GARBAGE * 2; }, 3000), "garbage counted as invalid");
+	check(sessionCount(*b) == PEERS + 1, "garbage starts no session");
+
+	// half the peers stop, the other half keep announcing
+	sendPeers(2, 0, 0, PEERS / 2);
+	sendPeers(2, PEER_TTL, PEERS / 2, PEERS);
+	check(waitFor(*a, *b, [&] { return sessionCount(*b) == PEERS / 2 + 1; }, 3000), "stop announcements end sessions");
+
+	// the first instance stops, its peers drop it right away
+	a->stopBroadcast();
+	check(waitFor(*a, *b, [&] { return !hasGame(*b, gameA); }, 1000), "stopBroadcast ends the session at once");
+	boost::this_thread::sleep(boost::posix_time::milliseconds(1500));
+	b->processEvents();
+	check(!hasGame(*b, gameA), "no announcement after stopBroadcast brings it back");
+
+	// the rest expire with their TTL
+	check(waitFor(*a, *b, [&] { return sessionCount(*b) == 0 && sessionCount(*a) == 0; }, (PEER_TTL + 3) * 1000), "silent peers expire");
+	check(countsB.started == PEERS + 1 && countsB.stopped == PEERS + 1, "every start has its stop");
+
+	printf("%s\n", Metrics::toString().c_str());
+	printf("%d failure(s)\n", sFailures);
+
+	// the lobby threads never return, don't wait for them
+	fflush(stdout);
+	_exit(sFailures == 0 ? 0 : 1);
+}
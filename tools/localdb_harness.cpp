@@ -0,0 +1,162 @@
+// Harness for the local database scraper (see LocalDatabaseScraper.h). It writes a Logiqx DAT
+// fixture and lets LocalDatabase import it into its .idx file. Then it checks:
+// MD5 hits, the CRC fallback for CRC only entries, misses by MD5 and by CRC, and a broken dump.
+// It also times a bulk lookup over every game of the fixture.
+// HOME is pointed at a temporary directory, so the settings start out empty.
+//   localdb_harness [games]    default: 20000
+// Exits with 0 when every check passed, timings are only reported.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <boost/crc.hpp>
+#include <boost/filesystem.hpp>
+
+#include "MetaData.h"
+#include "Settings.h"
+#include "scrapers/LocalDatabaseScraper.h"
+
+namespace fs = boost::filesystem;
+
+static int sFailures = 0;
+
+static void check(bool ok, const std::string& what)
+{
+	printf("%s %s\n", ok ? "ok  " : "FAIL", what.c_str());
+	if(!ok)
+		sFailures++;
+}
+
+// every game gets a distinct, made up MD5, the lookup never hashes anything itself
+static std::string md5Of(int game)
+{
+	char md5[33];
+	snprintf(md5, sizeof(md5), "%08x%08x%08x%08x", game, game * 2654435761u, 0xd00df00du, game ^ 0x5a5a5a5a);
+	return md5;
+}
+
+static std::string nameOf(int game)
+{
+	return "Game " + std::to_string(game) + " (Europe)";
+}
+
+static uint32_t writeRom(const std::string& path, const std::string& content)
+{
+	std::ofstream rom(path.c_str(), std::ios_base::out | std::ios_base::binary);
+	rom << content;
+
+	boost::crc_32_type crc;
+	crc.process_bytes(content.data(), content.size());
+	return crc.checksum();
+}
+
+static std::string hex(uint32_t crc)
+{
+	char text[9];
+	snprintf(text, sizeof(text), "%08x", crc);
+	return text;
+}
+
+int main(int argc, char* argv[])
+{
+	const int games = argc > 1 ? atoi(argv[1]) : 20000;
+
+	char home[] = "/tmp/es-localdb-harness-XXXXXX";
+	if(mkdtemp(home) == NULL)
+	{
+		perror("mkdtemp");
+		return 1;
+	}
+	setenv("HOME", home, 1);
+	fs::create_directories(std::string(home) + "/.emulationstation");
+	initMetadata();
+
+	const std::string dat = std::string(home) + "/nointro.dat";
+	const std::string index = std::string(home) + "/nointro.idx";
+	Settings::getInstance()->setString("ScraperDatabase", dat);
+
+	// roms for the CRC fallback, one listed by CRC only and one that isn't listed at all
+	const std::string crcRom = std::string(home) + "/crc_only.bin";
+	const std::string unknownRom = std::string(home) + "/unknown.bin";
+	const uint32_t crcOnly = writeRom(crcRom, "a rom only known by its CRC");
+	writeRom(unknownRom, "a rom nobody dumped");
+
+	{
+		std::ofstream file(dat.c_str());
+		file << "<?xml version=\"1.0\"?>\n<datafile>\n\t<header><name>fixture</name></header>\n";
+		for(int i = 0; i < games; i++)
+		{
+			file << "\t<game name=\"" << nameOf(i) << "\">\n"
+				<< "\t\t<description>" << nameOf(i) << "</description>\n"
+				<< "\t\t<year>1994</year>\n"
+				<< "\t\t<manufacturer>Studio " << i % 17 << "</manufacturer>\n"
+				<< "\t\t<rom name=\"game" << i << ".bin\" size=\"1024\" crc=\"" << hex(0x10000000u + i) << "\" md5=\"" << md5Of(i) << "\"/>\n"
+				<< "\t</game>\n";
+		}
+		file << "\t<game name=\"CRC only\">\n\t\t<rom name=\"crc_only.bin\" crc=\"" << hex(crcOnly) << "\"/>\n\t</game>\n";
+		file << "</datafile>\n";
+	}
+
+	LocalDatabase* database = LocalDatabase::getInstance();
+
+	const auto importStart = std::chrono::steady_clock::now();
+	ScraperSearchResult first;
+	check(database->find(md5Of(0), crcRom, first), "first lookup imports the DAT and finds the game");
+	const double importMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - importStart).count();
+	check(fs::exists(index), "the index is written next to the DAT");
+	check(first.mdl.get("name") == nameOf(0), "name comes from the description");
+	check(first.mdl.get("developer") == "Studio 0", "developer comes from the manufacturer");
+	check(first.mdl.get("releasedate") == "19940101T000000", "release date comes from the year");
+	check(first.imageUrl.empty(), "no image for a DAT entry");
+
+	{
+		ScraperSearchResult result;
+		check(database->find(md5Of(games - 1), unknownRom, result) && result.mdl.get("name") == nameOf(games - 1), "MD5 hit on the last game");
+	}
+	{
+		ScraperSearchResult result;
+		check(database->find("", crcRom, result) && result.mdl.get("name") == "CRC only", "CRC fallback without an MD5");
+	}
+	{
+		ScraperSearchResult result;
+		check(database->find(md5Of(games), crcRom, result) && result.mdl.get("name") == "CRC only", "CRC fallback after an MD5 miss");
+	}
+	{
+		ScraperSearchResult result;
+		check(!database->find(md5Of(games), unknownRom, result), "miss by MD5 and by CRC");
+	}
+	{
+		ScraperSearchResult result;
+		check(!database->find("not an md5", std::string(home) + "/missing.bin", result), "miss on a malformed MD5 and a missing rom");
+	}
+	{
+		const std::string broken = std::string(home) + "/broken.xml";
+		std::ofstream(broken.c_str()) << "<datafile><game name=\"unterminated\">";
+		std::string error;
+		check(!LocalDatabase::import(broken, std::string(home) + "/broken.idx", error) && !error.empty(), "a broken dump fails with an error");
+		check(!fs::exists(std::string(home) + "/broken.idx"), "a broken dump leaves no index behind");
+	}
+
+	// what a bulk scrape of the whole set costs, without the rom reads of the CRC fallback
+	unsigned int hits = 0;
+	const auto start = std::chrono::steady_clock::now();
+	for(int i = 0; i < games; i++)
+	{
+		ScraperSearchResult result;
+		if(database->find(md5Of(i), "", result))
+			hits++;
+	}
+	const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	check(hits == (unsigned int)games, "bulk lookup finds every game");
+
+	printf("import:  %8.1f ms for %d games (%llu bytes of index)\n", importMs, games, (unsigned long long)fs::file_size(index));
+	printf("lookup:  %8.1f us per game, MD5 hit and record read\n", ns / games / 1000);
+
+	fs::remove_all(home);
+
+	printf("%s\n", sFailures == 0 ? "all checks passed" : "some checks failed");
+	return sFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,180 @@
+// Input-to-audio latency of UI sound effects, measured with SDL's dummy audio driver (no sound card needed).
+// For every buffer size, key presses are pushed into the SDL event queue, polled like the UI does and
+// answered with Sound::play(), through AudioManager and the effect channels it reserves. A post-mix hook
+// notes when the first samples of the effect are mixed. The dummy driver takes buffers in real time like
+// a device, the effect is heard once that buffer has played: after mixed + one buffer.
+// The UI frame (up to 16ms before an event is polled) and the device's own output delay come on top.
+//   sound_latency [presses] [buffer size...]    defaults: 50 presses, 4096 and 1024 samples
+// Exits with 1 if a press was never heard.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include <SDL.h>
+#include "SDL_mixer.h"
+
+#include "AudioManager.h"
+#include "Settings.h"
+#include "Sound.h"
+
+#define EFFECT_MS 20
+#define TIMEOUT_MS 1000
+
+static std::atomic<Uint64> sPressedAt(0);
+static std::atomic<Uint64> sMixedAt(0);
+
+// audio thread: the first non silent buffer after a press
+static void postMix(void* udata, Uint8* stream, int len)
+{
+	if(sPressedAt.load() == 0 || sMixedAt.load() != 0)
+		return;
+
+	for(int i = 0; i < len; i++)
+	{
+		if(stream[i] != 0)
+		{
+			sMixedAt.store(SDL_GetPerformanceCounter());
+			return;
+		}
+	}
+}
+
+// a short 1kHz square, 16 bit stereo
+static bool writeEffect(const std::string& path)
+{
+	const int frequency = 44100;
+	const int frames = frequency * EFFECT_MS / 1000;
+	std::vector<short> samples(frames * 2);
+	for(int i = 0; i < frames; i++)
+		samples[i * 2] = samples[i * 2 + 1] = ((i * 2000 / frequency) % 2) ? 8000 : -8000;
+
+	const int dataSize = (int)(samples.size() * sizeof(short));
+	std::ofstream wav(path.c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+	auto u32 = [&wav](unsigned int v) { wav.write((const char*)&v, 4); };
+	auto u16 = [&wav](unsigned short v) { wav.write((const char*)&v, 2); };
+	wav.write("RIFF", 4); u32(36 + dataSize); wav.write("WAVE", 4);
+	wav.write("fmt ", 4); u32(16); u16(1); u16(2); u32(frequency); u32(frequency * 4); u16(4); u16(16);
+	wav.write("data", 4); u32(dataSize);
+	wav.write((const char*)samples.data(), dataSize);
+	return wav.good();
+}
+
+static double toMs(Uint64 ticks)
+{
+	return ticks * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+int main(int argc, char* argv[])
+{
+	const int presses = argc > 1 ? atoi(argv[1]) : 50;
+	std::vector<int> buffers;
+	for(int i = 2; i < argc; i++)
+		buffers.push_back(atoi(argv[i]));
+	if(buffers.empty())
+	{
+		buffers.push_back(4096);
+		buffers.push_back(1024);
+	}
+
+	setenv("SDL_AUDIODRIVER", "dummy", 1);
+	if(SDL_Init(SDL_INIT_EVENTS | SDL_INIT_TIMER) != 0)
+	{
+		fprintf(stderr, "SDL_Init: %s\n", SDL_GetError());
+		return 1;
+	}
+
+	const std::string effectPath = "/tmp/sound_latency_effect.wav";
+	if(!writeEffect(effectPath))
+	{
+		fprintf(stderr, "could not write %s\n", effectPath.c_str());
+		return 1;
+	}
+
+	std::mt19937 random(1234);
+	int missed = 0;
+
+	for(auto buffer = buffers.begin(); buffer != buffers.end(); buffer++)
+	{
+		// reopen the device with this buffer, like a change of the setting followed by a game launch
+		Settings::getInstance()->setInt("AudioBufferSize", *buffer);
+		AudioManager::getInstance()->deinit();
+		AudioManager::getInstance()->init();
+		Mix_SetPostMix(postMix, NULL);
+
+		int frequency = 0;
+		Uint16 format = 0;
+		int channels = 0;
+		Mix_QuerySpec(&frequency, &format, &channels);
+		if(frequency == 0)
+		{
+			fprintf(stderr, "could not open the dummy audio device: %s\n", SDL_GetError());
+			return 1;
+		}
+
+		std::shared_ptr<Sound> effect = Sound::get(effectPath);
+		const double bufferMs = *buffer * 1000.0 / frequency;
+		std::uniform_int_distribution<int> phase(0, (int)bufferMs);
+
+		std::vector<double> heard;
+		for(int i = 0; i < presses; i++)
+		{
+			// presses land anywhere in the current buffer
+			SDL_Delay(phase(random));
+
+			sMixedAt.store(0);
+			SDL_Event press;
+			SDL_zero(press);
+			press.type = SDL_KEYDOWN;
+			press.key.keysym.sym = SDLK_DOWN;
+			sPressedAt.store(SDL_GetPerformanceCounter());
+			SDL_PushEvent(&press);
+
+			// the UI side
+			SDL_Event event;
+			while(SDL_PollEvent(&event))
+			{
+				if(event.type == SDL_KEYDOWN)
+					effect->play();
+			}
+
+			const Uint32 start = SDL_GetTicks();
+			while(sMixedAt.load() == 0 && SDL_GetTicks() - start < TIMEOUT_MS)
+				SDL_Delay(1);
+
+			if(sMixedAt.load() == 0)
+				missed++;
+			else
+				heard.push_back(toMs(sMixedAt.load() - sPressedAt.load()) + bufferMs);
+			sPressedAt.store(0);
+
+			// silence again before the next press
+			Mix_HaltGroup(AudioManager::EFFECTS_GROUP);
+			SDL_Delay((Uint32)(bufferMs * 2) + EFFECT_MS);
+		}
+
+		std::sort(heard.begin(), heard.end());
+		double sum = 0;
+		for(auto it = heard.begin(); it != heard.end(); it++)
+			sum += *it;
+
+		if(heard.empty())
+			printf("buffer %5d (%5.1fms): never heard\n", *buffer, bufferMs);
+		else
+			printf("buffer %5d (%5.1fms): heard after min %5.1fms, mean %5.1fms, p95 %5.1fms, max %5.1fms (%d presses)\n",
+				*buffer, bufferMs, heard.front(), sum / heard.size(), heard[std::min(heard.size() - 1, heard.size() * 95 / 100)],
+				heard.back(), (int)heard.size());
+	}
+
+	Mix_SetPostMix(NULL, NULL);
+	AudioManager::getInstance()->deinit();
+	SDL_Quit();
+
+	if(missed > 0)
+		printf("%d press(es) never heard\n", missed);
+	return missed == 0 ? 0 : 1;
+}
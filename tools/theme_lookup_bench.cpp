@@ -0,0 +1,281 @@
+// Theme lookups as the gamelist views do them when a theme is applied: a real theme.xml is loaded
+// with ThemeData::loadFile, then every round looks up each element of the basic and detailed views
+// with getElement() and runs the has()/get() sequence of the component's applyTheme on it,
+// GuiComponent's pos/size included, misses included.
+// The same reads go through the std::map keyed by property name that ThemeElement replaced.
+// Without a theme.xml argument a two file fixture (theme.xml including common.xml) is written to /tmp.
+//   theme_lookup_bench [rounds] [theme.xml]    default: 100000
+// Exits with 1 if the theme doesn't load or the two representations read different values,
+// timings are only reported.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+#include "ThemeData.h"
+
+typedef ThemeData::PropertyValue Value;
+using namespace ThemeProperty;
+
+// the representation before interning
+struct MapElement
+{
+	std::string type;
+	std::map<std::string, Value> properties;
+
+	bool has(const std::string& prop) const { return properties.find(prop) != properties.end(); }
+};
+
+struct Lookup
+{
+	std::string view;
+	std::string element;
+	std::string type; // what the component asks getElement() for, empty for a plain GuiComponent
+	bool base; // calls GuiComponent::applyTheme first, which reads pos and size
+	std::vector<PropertyId> reads; // in applyTheme order
+};
+
+static std::vector<PropertyId> readsOf(const std::string& type)
+{
+	if(type == "image")
+		return { POS, SIZE, MAX_SIZE, ORIGIN, PATH, TILE, COLOR };
+	if(type == "text")
+		return { COLOR, ALIGNMENT, TEXT, FORCE_UPPERCASE, LINE_SPACING, FONT_PATH, FONT_SIZE };
+	if(type == "textlist")
+		return { SELECTOR_COLOR, SELECTED_COLOR, PRIMARY_COLOR, SECONDARY_COLOR, FONT_PATH, FONT_SIZE,
+			SCROLL_SOUND, ALIGNMENT, HORIZONTAL_MARGIN, FORCE_UPPERCASE, LINE_SPACING };
+	if(type == "datetime")
+		return { SIZE, COLOR, FORCE_UPPERCASE, FONT_PATH, FONT_SIZE };
+	if(type == "rating")
+		return { FILLED_PATH, UNFILLED_PATH };
+	return {};
+}
+
+// ISimpleGameListView, BasicGameListView and DetailedGameListView::onThemeChanged
+static std::vector<Lookup> makeLookups()
+{
+	std::vector< std::pair<std::string, std::string> > basic = {
+		{ "background", "image" }, { "logo", "image" }, { "logoText", "text" }, { "gamelist", "textlist" } };
+
+	std::vector< std::pair<std::string, std::string> > detailed = basic;
+	detailed.push_back({ "md_image", "image" });
+	const char* labels[] = { "rating", "releasedate", "developer", "publisher", "genre", "players", "lastplayed", "playcount", "favorite" };
+	for(size_t i = 0; i < sizeof(labels) / sizeof(labels[0]); i++)
+		detailed.push_back({ std::string("md_lbl_") + labels[i], "text" });
+	for(size_t i = 0; i < sizeof(labels) / sizeof(labels[0]); i++)
+	{
+		const std::string name = labels[i];
+		const std::string type = name == "rating" ? "rating" : (name == "releasedate" || name == "lastplayed") ? "datetime" : "text";
+		detailed.push_back({ "md_" + name, type });
+	}
+	detailed.push_back({ "md_description", "" }); // the scrollable container around the text
+	detailed.push_back({ "md_description", "text" });
+
+	std::vector<Lookup> lookups;
+	for(auto it = basic.begin(); it != basic.end(); it++)
+		lookups.push_back({ "basic", it->first, it->second, it->second != "image", readsOf(it->second) });
+	for(auto it = detailed.begin(); it != detailed.end(); it++)
+		lookups.push_back({ "detailed", it->first, it->second, it->second != "image", readsOf(it->second) });
+	return lookups;
+}
+
+static void writeFile(const boost::filesystem::path& path, const std::string& content)
+{
+	boost::filesystem::create_directories(path.parent_path());
+	std::ofstream(path.string().c_str()) << content;
+}
+
+// a typical theme set: the shared views in an included file, the system's theme.xml on top
+static std::string writeFixture(const boost::filesystem::path& dir)
+{
+	const char* art[] = { "art/bg.png", "art/logo.svg", "art/font.ttf", "art/scroll.wav", "art/star_filled.svg", "art/star_unfilled.svg" };
+	for(size_t i = 0; i < sizeof(art) / sizeof(art[0]); i++)
+		writeFile(dir / art[i], "");
+
+	writeFile(dir / "common.xml",
+		"<theme>\n"
+		"	<formatVersion>4</formatVersion>\n"
+		"	<view name=\"basic, detailed\">\n"
+		"		<image name=\"background\" extra=\"false\"><pos>0 0</pos><size>1 1</size><path>./art/bg.png</path><tile>true</tile></image>\n"
+		"		<image name=\"logo\"><pos>0.5 0.02</pos><maxSize>0.4 0.12</maxSize><origin>0.5 0</origin><path>./art/logo.svg</path></image>\n"
+		"		<text name=\"logoText\"><fontPath>./art/font.ttf</fontPath><color>777777</color><forceUppercase>true</forceUppercase></text>\n"
+		"		<textlist name=\"gamelist\">\n"
+		"			<pos>0.05 0.2</pos><size>0.45 0.7</size>\n"
+		"			<selectorColor>000000</selectorColor><selectedColor>FFFFFF</selectedColor>\n"
+		"			<primaryColor>0000FF</primaryColor><secondaryColor>00FF00</secondaryColor>\n"
+		"			<fontPath>./art/font.ttf</fontPath><fontSize>0.035</fontSize><scrollSound>./art/scroll.wav</scrollSound>\n"
+		"			<alignment>left</alignment><horizontalMargin>0.01</horizontalMargin><lineSpacing>1.5</lineSpacing>\n"
+		"		</textlist>\n"
+		"	</view>\n"
+		"</theme>\n");
+
+	std::string detailed =
+		"<theme>\n"
+		"	<formatVersion>4</formatVersion>\n"
+		"	<include>./common.xml</include>\n"
+		"	<view name=\"detailed\">\n"
+		"		<textlist name=\"gamelist\"><size>0.45 0.8</size><alignment>center</alignment></textlist>\n"
+		"		<image name=\"md_image\"><pos>0.75 0.2</pos><maxSize>0.4 0.4</maxSize><origin>0.5 0</origin></image>\n"
+		"		<text name=\"md_lbl_rating, md_lbl_releasedate, md_lbl_developer, md_lbl_publisher, md_lbl_genre, md_lbl_players, md_lbl_lastplayed, md_lbl_playcount\">\n"
+		"			<fontPath>./art/font.ttf</fontPath><fontSize>0.025</fontSize><color>AAAAAA</color>\n"
+		"		</text>\n"
+		"		<rating name=\"md_rating\"><filledPath>./art/star_filled.svg</filledPath><unfilledPath>./art/star_unfilled.svg</unfilledPath></rating>\n"
+		"		<datetime name=\"md_releasedate, md_lastplayed\"><color>FFFFFF</color><fontPath>./art/font.ttf</fontPath><fontSize>0.025</fontSize></datetime>\n"
+		"		<text name=\"md_developer, md_publisher, md_genre, md_players, md_playcount\"><color>FFFFFF</color><forceUppercase>true</forceUppercase></text>\n"
+		"		<text name=\"md_description\"><pos>0.55 0.65</pos><size>0.4 0.3</size><fontSize>0.02</fontSize><lineSpacing>1.2</lineSpacing></text>\n"
+		"	</view>\n"
+		"</theme>\n";
+	writeFile(dir / "theme.xml", detailed);
+
+	return (dir / "theme.xml").string();
+}
+
+// touches the value like applyTheme does, so the lookup can't be optimized away
+static unsigned long long use(const Value& value)
+{
+	unsigned long long sum = value.which() + 1;
+	switch(value.which())
+	{
+	case 0: sum += (unsigned long long)(boost::get<Eigen::Vector2f>(value).x() * 1000) * 31 + (unsigned long long)(boost::get<Eigen::Vector2f>(value).y() * 1000); break;
+	case 1: sum += boost::get<std::string>(value).size(); break;
+	case 2: sum += boost::get<unsigned int>(value); break;
+	case 3: sum += (unsigned long long)(boost::get<float>(value) * 1000); break;
+	case 4: sum += boost::get<bool>(value) ? 1 : 0; break;
+	}
+	return sum;
+}
+
+template<typename Run>
+static double measure(int rounds, unsigned long long& reads, unsigned long long& checksum, Run run)
+{
+	reads = 0;
+	checksum = 0;
+	const auto start = std::chrono::steady_clock::now();
+	for(int r = 0; r < rounds; r++)
+		run(reads, checksum);
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[])
+{
+	const int rounds = argc > 1 ? atoi(argv[1]) : 100000;
+
+	boost::filesystem::path fixture;
+	std::string path;
+	if(argc > 2)
+	{
+		path = argv[2];
+	}else{
+		fixture = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("es-theme-bench-%%%%%%");
+		path = writeFixture(fixture);
+	}
+
+	ThemeData theme;
+	try
+	{
+		theme.loadFile(path);
+	}catch(const ThemeException& e)
+	{
+		printf("could not load %s:\n%s\n", path.c_str(), e.what());
+		return 1;
+	}
+
+	const std::vector<Lookup> lookups = makeLookups();
+
+	// the map representation, built from what was loaded
+	std::map<std::string, std::map<std::string, MapElement> > mapViews;
+	unsigned int found = 0;
+	for(auto lookup = lookups.begin(); lookup != lookups.end(); lookup++)
+	{
+		const ThemeData::ThemeElement* elem = theme.getElement(lookup->view, lookup->element, "");
+		if(elem == NULL)
+			continue;
+
+		found++;
+		MapElement& mapElement = mapViews[lookup->view][lookup->element];
+		mapElement.type = elem->type;
+		for(auto prop = elem->properties.begin(); prop != elem->properties.end(); prop++)
+			mapElement.properties[ThemeData::getPropertyName(prop->first)] = prop->second;
+	}
+	printf("%s: %u of %u elements the gamelist views ask for\n", path.c_str(), found, (unsigned int)lookups.size());
+
+	// the names applyTheme used to pass, built once like the string literals were
+	std::vector<std::string> names;
+	for(int i = 0; i < COUNT; i++)
+		names.push_back(ThemeData::getPropertyName((PropertyId)i));
+
+	unsigned long long flatReads, flatChecksum, mapReads, mapChecksum;
+	const double flatNs = measure(rounds, flatReads, flatChecksum, [&](unsigned long long& reads, unsigned long long& checksum) {
+		for(auto lookup = lookups.begin(); lookup != lookups.end(); lookup++)
+		{
+			const ThemeData::ThemeElement* base = lookup->base ? theme.getElement(lookup->view, lookup->element, "") : NULL;
+			if(base != NULL)
+			{
+				checksum += base->has(POS) ? use(*base->find(POS)) : 0;
+				checksum += base->has(SIZE) ? use(*base->find(SIZE)) : 0;
+				reads += 2;
+			}
+
+			if(lookup->type.empty())
+				continue;
+
+			const ThemeData::ThemeElement* elem = theme.getElement(lookup->view, lookup->element, lookup->type);
+			if(elem == NULL)
+				continue;
+
+			for(auto prop = lookup->reads.begin(); prop != lookup->reads.end(); prop++)
+			{
+				checksum += elem->has(*prop) ? use(*elem->find(*prop)) : 0;
+				reads++;
+			}
+		}
+	});
+	const double mapNs = measure(rounds, mapReads, mapChecksum, [&](unsigned long long& reads, unsigned long long& checksum) {
+		for(auto lookup = lookups.begin(); lookup != lookups.end(); lookup++)
+		{
+			auto view = mapViews.find(lookup->view);
+			if(view == mapViews.end())
+				continue;
+			auto elem = view->second.find(lookup->element);
+			if(elem == view->second.end())
+				continue;
+
+			const MapElement& element = elem->second;
+			if(lookup->base)
+			{
+				checksum += element.has(names[POS]) ? use(element.properties.at(names[POS])) : 0;
+				checksum += element.has(names[SIZE]) ? use(element.properties.at(names[SIZE])) : 0;
+				reads += 2;
+			}
+
+			if(lookup->type.empty() || lookup->type != element.type)
+				continue;
+
+			for(auto prop = lookup->reads.begin(); prop != lookup->reads.end(); prop++)
+			{
+				const std::string& name = names[*prop];
+				checksum += element.has(name) ? use(element.properties.at(name)) : 0;
+				reads++;
+			}
+		}
+	});
+
+	printf("getElement + vector by id:  %8.2f us per theme application, %6.2f ns per read\n", flatNs / rounds / 1000, flatNs / flatReads);
+	printf("map by name:                %8.2f us per theme application, %6.2f ns per read\n", mapNs / rounds / 1000, mapNs / mapReads);
+	printf("speedup:                    %8.2fx over %llu reads\n", mapNs / flatNs, flatReads);
+
+	if(!fixture.empty())
+		boost::filesystem::remove_all(fixture);
+
+	if(flatChecksum != mapChecksum || flatReads != mapReads)
+	{
+		printf("the two representations disagree\n");
+		return 1;
+	}
+	return 0;
+}